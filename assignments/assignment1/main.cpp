@@ -11,16 +11,25 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 
+#include <joey/renderTargetPool.h>
+#include <joey/renderThread.h>
+
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <memory>
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 GLFWwindow* initWindow(const char* title, int width, int height);
 void drawUI();
 
+// Screen sized targets, owned by the render thread during the loop
+joey::RenderTargetPool renderTargets;
+joey::Framebuffer framebuffer;
+
 //Global state
 int screenWidth = 1080;
 int screenHeight = 720;
@@ -44,6 +53,43 @@ struct ColorCorrect {
 	glm::vec3 colorFilter = glm::vec3(1);
 }colorCorrect;
 
+// What rendering needs from one frame. Copied into the frame's render command,
+// so the main thread can move on to the next frame while this one renders
+struct FrameState {
+	glm::mat4 monkeyModel;
+	glm::mat4 viewProjection;
+	glm::vec3 eyePosition;
+	Material material;
+	ColorCorrect colorCorrect;
+	int width;
+	int height;
+};
+
+// ImGui reuses its draw lists on the next NewFrame, the render thread draws a copy
+struct UIDrawData {
+	ImDrawData data;
+	ImVector<ImDrawList*> lists;
+	~UIDrawData()
+	{
+		for (ImDrawList* list : lists)
+		{
+			IM_DELETE(list);
+		}
+	}
+};
+
+static std::shared_ptr<UIDrawData> cloneDrawData(const ImDrawData* source)
+{
+	std::shared_ptr<UIDrawData> clone(new UIDrawData());
+	clone->data = *source;
+	for (int i = 0; i < source->CmdListsCount; i++)
+	{
+		clone->lists.push_back(source->CmdLists[i]->CloneOutput());
+	}
+	clone->data.CmdLists = clone->lists.Data;
+	return clone;
+}
+
 
 int main() {
 	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
@@ -64,36 +110,13 @@ int main() {
 	camera.fov = 60.0f;
 
 	// FBO Creation
-	unsigned int fbo;
-	glCreateFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-	// Color Buffer Creation
-	unsigned int frameBufferTexture;
-	glGenTextures(1, &frameBufferTexture);
-	glBindTexture(GL_TEXTURE_2D, frameBufferTexture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16, screenWidth, screenHeight);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Depth Buffer Creation
-	unsigned int depth_texture;
-	glGenTextures(1, &depth_texture);
-	glBindTexture(GL_TEXTURE_2D, depth_texture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, screenWidth, screenHeight);
-
-	// Assigning
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, frameBufferTexture, 0);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture, 0);
+	const int colorFormat = GL_RGBA16;
+	framebuffer = renderTargets.acquireFramebuffer(screenWidth, screenHeight, &colorFormat, 1, GL_DEPTH_COMPONENT16);
 
 	// Dummy VAO
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	// Draw Buffer Setup (Just in case of multiple render textures)
-	static const GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, draw_buffers);
-
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 	glEnable(GL_DEPTH_TEST);
@@ -102,33 +125,29 @@ int main() {
 
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	// Render Loop
-	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
-
-		float time = (float)glfwGetTime();
-		deltaTime = time - prevFrameTime;
-		prevFrameTime = time;
-
-		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
-		cameraController.move(window, &camera, deltaTime);
+	// Runs on the render thread, which owns the context for the whole loop. Only reads frame and
+	// objects created above
+	auto renderFrame = [&](const FrameState& frame, UIDrawData& ui) {
+		//The main thread only records new window sizes, targets are reallocated here
+		if (frame.width > 0 && frame.height > 0 && (framebuffer.width != (unsigned int)frame.width || framebuffer.height != (unsigned int)frame.height))
+			renderTargets.resizeFramebuffer(&framebuffer, frame.width, frame.height);
 
 		// FIRST PASS (Custom Framebuffer Pass)
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-		glViewport(0, 0, screenWidth, screenHeight);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+		glViewport(0, 0, frame.width, frame.height);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Draw Scene General Scene
 		glBindTextureUnit(0, brickTexture);
 		sceneShader.use();
 		sceneShader.setInt("_MainTex", 0);
-		sceneShader.setFloat("_Material.AmbientCo", material.AmbientCo);
-		sceneShader.setFloat("_Material.DiffuseCo", material.DiffuseCo);
-		sceneShader.setFloat("_Material.SpecualarCo", material.SpecualarCo);
-		sceneShader.setFloat("_Material.Shininess", material.Shininess);
-		sceneShader.setVec3("_EyePos", camera.position);
-		sceneShader.setMat4("_Model", monkeyTransform.modelMatrix());
-		sceneShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+		sceneShader.setFloat("_Material.AmbientCo", frame.material.AmbientCo);
+		sceneShader.setFloat("_Material.DiffuseCo", frame.material.DiffuseCo);
+		sceneShader.setFloat("_Material.SpecualarCo", frame.material.SpecualarCo);
+		sceneShader.setFloat("_Material.Shininess", frame.material.Shininess);
+		sceneShader.setVec3("_EyePos", frame.eyePosition);
+		sceneShader.setMat4("_Model", frame.monkeyModel);
+		sceneShader.setMat4("_ViewProjection", frame.viewProjection);
 		monkeyModel.draw();
 		planeMesh.draw();
 
@@ -138,23 +157,56 @@ int main() {
 
 		// Apply Color Correction + Tonemapping
 		postProcessShader.use();
-		postProcessShader.setFloat("_Exposure", colorCorrect.Exposure);
-		postProcessShader.setFloat("_Contrast", colorCorrect.Contrast);
-		postProcessShader.setFloat("_Brightness", colorCorrect.Brightness);
-		postProcessShader.setVec3("_ColorFiltering", colorCorrect.colorFilter);
+		postProcessShader.setFloat("_Exposure", frame.colorCorrect.Exposure);
+		postProcessShader.setFloat("_Contrast", frame.colorCorrect.Contrast);
+		postProcessShader.setFloat("_Brightness", frame.colorCorrect.Brightness);
+		postProcessShader.setVec3("_ColorFiltering", frame.colorCorrect.colorFilter);
 
 		// Fullscreen Quad
-		glBindTextureUnit(0, frameBufferTexture);
+		glBindTextureUnit(0, framebuffer.colorBuffer[0]);
 		glBindVertexArray(dummyVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 
-		drawUI();
+		ImGui_ImplOpenGL3_RenderDrawData(&ui.data);
+
+		renderTargets.endFrame();
 
 		glfwSwapBuffers(window);
+	};
+
+	//The backend builds its font texture and program on its first NewFrame, while the context is still here
+	ImGui_ImplOpenGL3_NewFrame();
+	//The context moves to the render thread for the loop and back for shutdown. The main thread
+	//polls input, simulates and records frame N+1 while the render thread submits frame N
+	glfwMakeContextCurrent(nullptr);
+	joey::RenderThread* renderThread = new joey::RenderThread([window]() { glfwMakeContextCurrent(window); }, []() { glfwMakeContextCurrent(nullptr); });
+
+	// Render Loop
+	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
+
+		float time = (float)glfwGetTime();
+		deltaTime = time - prevFrameTime;
+		prevFrameTime = time;
+
+		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
+		cameraController.move(window, &camera, deltaTime);
+
+		drawUI();
+
+		FrameState frame = { monkeyTransform.modelMatrix(), camera.projectionMatrix() * camera.viewMatrix(), camera.position,
+			material, colorCorrect, screenWidth, screenHeight };
+		std::shared_ptr<UIDrawData> ui = cloneDrawData(ImGui::GetDrawData());
+		renderThread->submit([&renderFrame, frame, ui]() { renderFrame(frame, *ui); });
+		renderThread->endFrame();
 	}
 
-	glDeleteFramebuffers(1, &fbo);
+	//Renders whatever is still queued
+	delete renderThread;
+	glfwMakeContextCurrent(window);
+
+	renderTargets.releaseFramebuffer(&framebuffer);
+	renderTargets.trim();
 
 	printf("Shutting down...");
 }
@@ -166,8 +218,8 @@ void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
 }
 
 void drawUI() {
+	//No GL here, this runs on the main thread. The render thread draws a copy of the result
 	ImGui_ImplGlfw_NewFrame();
-	ImGui_ImplOpenGL3_NewFrame();
 	ImGui::NewFrame();
 
 	ImGui::Begin("Settings");
@@ -199,14 +251,18 @@ void drawUI() {
 	ImGui::End();
 
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	//Main thread, no context. The render thread resizes the targets when a frame with the new size arrives
 	screenWidth = width;
 	screenHeight = height;
+
+	//Minimized windows report 0x0, keep the old targets until restored
+	if (width == 0 || height == 0)
+		return;
+	camera.aspectRatio = (float)width / height;
 }
 
 /// <summary>
@@ -11,6 +11,11 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 
+#include <joey/shadow.h>
+#include <joey/shaderVariants.h>
+#include <joey/renderTargetPool.h>
+#include <joey/renderStats.h>
+
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -20,6 +25,10 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 GLFWwindow* initWindow(const char* title, int width, int height);
 void drawUI(unsigned int shadowMap);
 
+// Screen sized targets are reallocated by framebufferSizeCallback
+joey::RenderTargetPool renderTargets;
+joey::Framebuffer framebuffer;
+
 //Global state
 int screenWidth = 1080;
 int screenHeight = 720;
@@ -53,13 +62,16 @@ struct Light {
 struct Shadow {
 	float minBias = 0.02;
 	float maxBias = 0.2;
+	joey::ShadowFilter filter = joey::ShadowFilter::MANUAL_3X3;
+	float filterRadius = 1.5;
 }shadow;
 
 int main() {
 	GLFWwindow* window = initWindow("Assignment 2", screenWidth, screenHeight);
 
 	// Shader and Model Setup
-	ew::Shader sceneShader = ew::Shader("assets/lit.vert", "assets/lit.frag");
+	//One variant per shadow filter, built the first time the filter is picked
+	joey::ShaderVariants sceneShaders("assets/lit.vert", "assets/lit.frag");
 	ew::Shader postProcessShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag");
 	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag");
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
@@ -85,56 +97,26 @@ int main() {
 	lightCamera.farPlane = 25.0f;
 	lightCamera.aspectRatio = 1;
 
-	unsigned int fbo;
-	glCreateFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-	// Color Buffer Creation
-	unsigned int frameBufferTexture;
-	glGenTextures(1, &frameBufferTexture);
-	glBindTexture(GL_TEXTURE_2D, frameBufferTexture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16, screenWidth, screenHeight);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Depth Buffer Creation
-	unsigned int depth_texture;
-	glGenTextures(1, &depth_texture);
-	glBindTexture(GL_TEXTURE_2D, depth_texture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, screenWidth, screenHeight);
-
-	// Assigning
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, frameBufferTexture, 0);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture, 0);
+	// FBO Creation
+	const int colorFormat = GL_RGBA16;
+	framebuffer = renderTargets.acquireFramebuffer(screenWidth, screenHeight, &colorFormat, 1, GL_DEPTH_COMPONENT16);
 
 	// Shadow Map and Buffer Creation
-	unsigned int shadowFBO, shadowMap;
-	glCreateFramebuffers(1, &shadowFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-
-	glGenTextures(1, &shadowMap);
-	glBindTexture(GL_TEXTURE_2D, shadowMap);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, 2048, 2048);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	joey::Framebuffer shadowBuffer = renderTargets.acquireFramebuffer(2048, 2048, nullptr, 0, GL_DEPTH_COMPONENT16, GL_NEAREST);
+	unsigned int shadowFBO = shadowBuffer.fbo;
+	unsigned int shadowMap = shadowBuffer.depthBuffer;
 
 	//Pixels outside of frustum should have max distance (white)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(shadowMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(shadowMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0);
+	glTextureParameterfv(shadowMap, GL_TEXTURE_BORDER_COLOR, borderColor);
+	unsigned int shadowCompareSampler = joey::createShadowCompareSampler();
 
 	// Dummy VAO
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	// Draw Buffer Setup (Just in case of multiple render textures)
-	static const GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, draw_buffers);
-
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
 	glEnable(GL_CULL_FACE);
 	glEnable(GL_DEPTH_TEST);
 
@@ -150,6 +132,8 @@ int main() {
 		float time = (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
+		//Also invalidates the state cache, ImGui rebinds behind its back
+		joey::renderStatsBeginFrame();
 
 		//monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
 		cameraController.move(window, &camera, deltaTime);
@@ -174,18 +158,19 @@ int main() {
 		planeMesh.draw();
 
 		// SECOND PASS (Custom Framebuffer Pass)
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
 		glViewport(0, 0, screenWidth, screenHeight);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glCullFace(GL_BACK);
 
 		// Draw Scene General Scene
-		glBindTextureUnit(0, shadowMap);
-		glBindTextureUnit(1, monkeyTexture);
-		glBindTextureUnit(2, floorTexture);
+		joey::bindShadowMap(shadowMap, shadowCompareSampler, 0, 3);
+		joey::bindTextureUnit(1, monkeyTexture);
+		joey::bindTextureUnit(2, floorTexture);
 
+		const ew::Shader& sceneShader = sceneShaders.get({ joey::shadowFilterDefine(shadow.filter) });
 		sceneShader.use();
-		sceneShader.setInt("_ShadowMap", 0);
+		joey::setShadowUniforms(sceneShader, 0, 3, shadow.filterRadius);
 		sceneShader.setMat4("_LightViewProjection", lightMatrix);
 		sceneShader.setVec3("_LightDirection", light.lightDirection);
 		sceneShader.setVec3("_LightColor", light.lightColor);
@@ -215,17 +200,21 @@ int main() {
 		postProcessShader.setFloat("_Brightness", colorCorrect.Brightness);
 
 		// Fullscreen Quad
-		glBindTextureUnit(0, frameBufferTexture);
-		glBindVertexArray(dummyVAO);
+		joey::bindTextureUnit(0, framebuffer.colorBuffer[0]);
+		joey::bindVertexArray(dummyVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 
 		drawUI(shadowMap);
 
+		renderTargets.endFrame();
+
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
-	glDeleteFramebuffers(1, &fbo);
+	renderTargets.releaseFramebuffer(&framebuffer);
+	renderTargets.releaseFramebuffer(&shadowBuffer);
+	renderTargets.trim();
 
 	printf("Shutting down...");
 }
@@ -264,6 +253,18 @@ void drawUI(unsigned int shadowMap) {
 		{
 			ImGui::SliderFloat("Min Bias", &shadow.minBias, 0.0f, 1.0f);
 			ImGui::SliderFloat("Max Bias", &shadow.maxBias, 0.0f, 1.0f);
+
+			if (ImGui::BeginCombo("Filter", joey::shadowFilterName(shadow.filter)))
+			{
+				for (int i = 0; i < (int)joey::ShadowFilter::COUNT; i++)
+				{
+					joey::ShadowFilter filter = (joey::ShadowFilter)i;
+					if (ImGui::Selectable(joey::shadowFilterName(filter), filter == shadow.filter))
+						shadow.filter = filter;
+				}
+				ImGui::EndCombo();
+			}
+			ImGui::SliderFloat("Filter Radius", &shadow.filterRadius, 0.5f, 4.0f);
 		}
 	}
 
@@ -303,6 +304,12 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 	screenWidth = width;
 	screenHeight = height;
+
+	//Minimized windows report 0x0, keep the old targets until restored
+	if (width == 0 || height == 0)
+		return;
+	camera.aspectRatio = (float)width / height;
+	renderTargets.resizeFramebuffer(&framebuffer, width, height);
 }
 
 /// <summary>
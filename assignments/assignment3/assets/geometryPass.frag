@@ -10,11 +10,13 @@ in Surface{
 }fs_in;
 
 
-uniform sampler2D _MainTex;
+//Every material's texture, layer = the draw's material (joey::MaterialTextures)
+uniform sampler2DArray _MaterialTextures;
+flat in int MaterialIndex;
 
 void main()
 {
 	gWorldPos = fs_in.WorldPos;
 	gWorldNormal = normalize(fs_in.WorldNormal);
-	gAlbedo = texture(_MainTex, fs_in.TexCoord).rgb;
+	gAlbedo = texture(_MaterialTextures, vec3(fs_in.TexCoord, MaterialIndex)).rgb;
 }
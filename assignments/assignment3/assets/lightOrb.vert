@@ -1,11 +1,15 @@
 #version 450 core
+#include "core/drawData.glsl"
+#include "core/procedural.glsl"
 
-layout(location = 0) in vec3 vPos;
-
-uniform mat4 _Model; 
 uniform mat4 _ViewProjection;
+uniform int _Subdivisions = 8;
+
+flat out vec3 Color;
 
 void main(){
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+	//No vertex buffers, the sphere comes from gl_VertexID and the light from the instance
+	ProceduralVertex v = proceduralSphere(gl_VertexID, _Subdivisions);
+	Color = CURRENT_INSTANCE.color.rgb;
+	gl_Position = _ViewProjection * CURRENT_INSTANCE.model * vec4(v.position,1.0);
 }
-
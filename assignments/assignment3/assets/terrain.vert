@@ -0,0 +1,30 @@
+#version 450
+#include "core/terrain.glsl"
+
+//Same positions in the depth pre-pass and the G-buffer pass, for GL_EQUAL
+invariant gl_Position;
+
+layout(location = 0) in vec3 vPos;
+
+uniform mat4 _ViewProjection;
+uniform int _TerrainMaterial;
+
+out Surface{
+	vec3 WorldPos;
+	vec3 WorldNormal;
+	vec2 TexCoord;
+}vs_out;
+
+flat out int MaterialIndex;
+
+void main()
+{
+	//vPos is the shared patch grid, the patch is the instance
+	TerrainVertex v = terrainVertex(vPos, gl_InstanceID);
+	vs_out.WorldPos = v.position;
+	vs_out.WorldNormal = v.normal;
+	//Repeats every 10 units like the floor tiles
+	vs_out.TexCoord = v.position.xz / 10.0;
+	MaterialIndex = _TerrainMaterial;
+	gl_Position = _ViewProjection * vec4(v.position, 1.0);
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <math.h>
+#include <algorithm>
 
 #include <ew/external/glad.h>
 
@@ -11,6 +12,25 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 
+#include <joey/shadow.h>
+#include <joey/pointShadowAtlas.h>
+#include <joey/renderGraph.h>
+#include <joey/gpuProfiler.h>
+#include <joey/cpuProfiler.h>
+#include <joey/renderStats.h>
+#include <joey/jobSystem.h>
+#include <joey/streamBuffer.h>
+#include <joey/geometryPool.h>
+#include <joey/renderQueue.h>
+#include <joey/materialTextures.h>
+#include <joey/shaderCache.h>
+#include <joey/shaderVariants.h>
+#include <joey/proceduralPrimitive.h>
+#include <joey/staticBatch.h>
+#include <joey/terrain.h>
+#include <joey/pointCloud.h>
+#include <joey/renderThread.h>
+
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -56,123 +76,193 @@ struct PointLight {
 	glm::vec4 color;
 };
 const int MAX_POINT_LIGHTS = 64;
+const int ORB_SUBDIVISIONS = 8; //Light orb spheres, generated in lightOrb.vert
 PointLight pointLights[MAX_POINT_LIGHTS];
 
 struct Shadow {
 	float minBias = 0.007;
 	float maxBias = 0.2;
+	joey::ShadowFilter filter = joey::ShadowFilter::MANUAL_3X3;
+	float filterRadius = 1.5;
+	bool runBenchmark = false;
+	std::vector<joey::ShadowFilterTiming> timings;
 }shadow;
 
-struct Framebuffer {
-	unsigned int fbo;
-	unsigned int colorTexture[8];
-	unsigned int depthTexture;
-	unsigned int width;
-	unsigned int height;
-}framebuffer;
-
-void drawUI(Framebuffer& gBuffer, unsigned int shadowMap);
-
-Framebuffer createFrameBuffer(unsigned int width, unsigned int height, int colorFormat)
-{
-	Framebuffer buffer;
-
-	buffer.width = width;
-	buffer.height = height;
+struct PointShadows {
+	bool enabled = true;
+	int faceBudget = 24; //Cube faces re-rendered per frame at most
+	float bias = 0.02;
+}pointShadows;
+
+joey::PointShadowAtlas* pointShadowAtlas;
+
+struct DepthPrepass {
+	bool enabled = true;
+	int framesSinceToggle = 0;
+	float overdraw[2] = {}; //G-buffer fragments per pixel, [0] without the pre-pass and [1] with it
+	bool positionStream = true; //Depth only passes read the pool's packed positions instead of whole vertices
+}depthPrepass;
+
+struct StaticBatching {
+	bool enabled = true; //Floor tiles drawn as a few merged chunks instead of one draw each
+	int chunks = 0;
+	int floorDraws = 0; //G-buffer draws of the floor last frame, chunks that passed culling when batched
+}staticBatching;
+
+struct TerrainLod {
+	bool enabled = false; //Kilometre of heightmap around the scene, drawn in the pre-pass and G-buffer
+	float pixelError = 2.0f;
+}terrainLod;
+
+joey::Terrain* terrain;
+
+struct PointCloudView {
+	bool enabled = true; //Only with a cloud given on the command line
+	int pointBudget = 5 * 1000 * 1000;
+	float pointSize = 2.0f;
+	glm::vec3 offset = glm::vec3(0); //Sets the cloud's bounds on the floor in the middle of the scene
+}pointCloudView;
+
+joey::PointCloud* pointCloud;
+
+struct RenderGraphDebug {
+	int view = 0; //0 = Lit, 1-3 = G-buffer target straight to post process
+	bool showTargets = true;
+}renderGraphDebug;
+
+struct Profiling {
+	bool showTimings = true;
+	bool showFlameView = true;
+	bool showRenderStats = true;
+	float zoneOverheadNs = 0.0f;
+}profiling;
+
+// What rendering needs from one frame. Copied into the frame's render command,
+// so the main thread can take input for the next frame while this one renders
+struct FrameState {
+	ew::Camera camera;
+	ew::Camera lightCamera;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	Material material;
+	ColorCorrect colorCorrect;
+	Light light;
+	Shadow shadow;
+	PointShadows pointShadows;
+	DepthPrepass depthPrepass;
+	StaticBatching staticBatching;
+	TerrainLod terrainLod;
+	PointCloudView pointCloudView;
+	RenderGraphDebug renderGraphDebug;
+	int width;
+	int height;
+};
 
-	glCreateFramebuffers(1, &buffer.fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, buffer.fbo);
+joey::GpuProfiler* gpuProfiler;
+joey::JobSystem* jobSystem;
 
-	// Color Buffer Creation
-	glGenTextures(1, &buffer.colorTexture[0]);
-	glBindTexture(GL_TEXTURE_2D, buffer.colorTexture[0]);
-	glTexStorage2D(GL_TEXTURE_2D, 1, colorFormat, buffer.width, buffer.height);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+//Per draw model matrices, colors and materials, indexed by draw in the shaders
+joey::StreamBuffer* drawStream;
 
-	// Depth Buffer Creation
-	glGenTextures(1, &buffer.depthTexture);
-	glBindTexture(GL_TEXTURE_2D, buffer.depthTexture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, screenWidth, screenHeight);
+//8x8 grid of monkeys on planes. Their draw data is recomposed on the job system each frame,
+//monkey i is draw i and the floor follows, chunk c as GRID_SIZE^2 + c or unbatched tile i as GRID_SIZE^2 + i
+const int GRID_SIZE = 8;
+const int MONKEY_DRAWS = GRID_SIZE * GRID_SIZE;
 
-	// Assigning
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, buffer.colorTexture[0], 0);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, buffer.depthTexture, 0);
+// Backs the render graph's transient targets, which follow the window size every frame
+joey::RenderTargetPool renderTargets;
 
-	return buffer;
-}
+void drawUI(const unsigned int* previews, const joey::RenderGraph& frameGraph);
 
-Framebuffer createGBuffer(unsigned int width, unsigned int height)
-{
-	Framebuffer buffer;
-	buffer.width = width;
-	buffer.height = height;
+// assignment3 [cloud.ply|cloud.xyz|cloud.octree], a PLY or XYZ file is sorted into <file>.octree the first time
+int main(int argc, char** argv) {
+	GLFWwindow* window = initWindow("Assignment 3", screenWidth, screenHeight);
 
-	glCreateFramebuffers(1, &buffer.fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, buffer.fbo);
+	// Shader and Model Setup. The driver compiles while models and textures load,
+	// warm starts load every program from the cache instead
+	joey::ShaderCache shaderCache;
+	ew::Shader sceneShader = ew::Shader("assets/lit.vert", "assets/lit.frag", &shaderCache);
+	//Specialized per shadow filter and point shadow toggle, the light count comes from MAX_POINT_LIGHTS
+	joey::ShaderVariants deferredShaders("assets/postprocess.vert", "assets/deferredLit.frag", &shaderCache);
+	deferredShaders.setDefine("MAX_POINT_LIGHTS", MAX_POINT_LIGHTS);
+	deferredShaders.prepare({ joey::shadowFilterDefine(shadow.filter), { "POINT_SHADOWS", (int)pointShadows.enabled } });
+	ew::Shader geometryShader = ew::Shader("assets/lit.vert", "assets/geometryPass.frag", &shaderCache);
+	ew::Shader postProcessShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag", &shaderCache);
+	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag", &shaderCache);
+	ew::Shader lightOrbShader = ew::Shader("assets/lightOrb.vert", "assets/lightOrb.frag", &shaderCache);
+	ew::Shader terrainShader = ew::Shader("assets/terrain.vert", "assets/geometryPass.frag", &shaderCache);
+	ew::Shader terrainDepthShader = ew::Shader("assets/terrain.vert", "assets/depthOnly.frag", &shaderCache);
+	jobSystem = new joey::JobSystem();
+	//Every mesh shares the pool's buffers, so each pass below is a single multi draw
+	joey::GeometryPool geometryPool(64 * 1024, 128 * 1024, true);
+	ew::Model monkeyModel = ew::Model("assets/suzanne.obj", jobSystem, &geometryPool);
+	ew::MeshData planeData = ew::createPlane(10, 10, 5);
+	int planeMesh = geometryPool.add(planeData);
+
+	// Texture Loading, each texture is a layer of one array and draws pick theirs by material
+	joey::MaterialTextures materialTextures(2048, 2048);
+	std::vector<int> materials = materialTextures.load({ "assets/Floor_Color.jpg", "assets/Monkey_Color.jpg" }, jobSystem);
+	int floorMaterial = materials[0];
+	int monkeyMaterial = materials[1];
 
-	glEnable(GL_DEPTH_TEST);
+	planeTransform.position = glm::vec3(0.0f, -1.0f, 0.0f);
 
-	int inputs[3]
+	//The floor never moves, its tiles are baked into world space chunks of 4x4 tiles
+	joey::StaticBatch floorBatch(20.0f);
+	for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
 	{
-		GL_RGB32F, // World Pos
-		GL_RGB16F, // World Normal
-		GL_RGB16F // Albedo Color
-	};
-
-	for (size_t i = 0; i < 3; i++)
+		ew::Transform plane = planeTransform;
+		plane.position = glm::vec3(i / GRID_SIZE * 5, -1, i % GRID_SIZE * 5);
+		floorBatch.add(planeData, plane.modelMatrix(), floorMaterial);
+	}
+	floorBatch.build(geometryPool);
+	staticBatching.chunks = floorBatch.getChunkCount();
+
+	//Hills around the scene, flattened under the floor tiles
+	joey::TerrainSettings terrainSettings;
+	terrainSettings.center = glm::vec3(17.5f, -1.5f, 17.5f);
+	terrainSettings.size = 1024.0f;
+	terrainSettings.heightScale = 120.0f;
+	const int HEIGHTMAP_SIZE = 1024;
+	std::vector<float> heights = joey::Terrain::generateHeightmap(HEIGHTMAP_SIZE, 7, jobSystem);
+	for (int z = 0; z < HEIGHTMAP_SIZE; z++)
 	{
-		glGenTextures(1, &buffer.colorTexture[i]);
-		glBindTexture(GL_TEXTURE_2D, buffer.colorTexture[i]);
-		glTexStorage2D(GL_TEXTURE_2D, 1, inputs[i], width, height);
-		//Clamp to border so we don't wrap when sampling for post processing
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		//Attach each texture to a different slot.
-	//GL_COLOR_ATTACHMENT0 + 1 = GL_COLOR_ATTACHMENT1, etc
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, buffer.colorTexture[i], 0);
+		for (int x = 0; x < HEIGHTMAP_SIZE; x++)
+		{
+			glm::vec2 offset = (glm::vec2(x, z) / (float)(HEIGHTMAP_SIZE - 1) - 0.5f) * terrainSettings.size;
+			heights[z * HEIGHTMAP_SIZE + x] *= glm::smoothstep(40.0f, 160.0f, glm::length(offset));
+		}
 	}
+	terrain = new joey::Terrain(terrainSettings, heights.data(), HEIGHTMAP_SIZE);
 
-	const GLenum drawBuffers[3] = {
-		GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2
-	};
-
-	glDrawBuffers(3, drawBuffers);
-
-
-	glGenTextures(1, &buffer.depthTexture);
-	glBindTexture(GL_TEXTURE_2D, buffer.depthTexture);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, screenWidth, screenHeight);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, buffer.depthTexture, 0);
-
-	// Add depth buffer?
-	// Check for bugs
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	return buffer;
-}
+	if (argc > 1)
+	{
+		std::string cloudPath = argv[1];
+		std::string octreePath = cloudPath.size() > 7 && cloudPath.compare(cloudPath.size() - 7, 7, ".octree") == 0 ? cloudPath : cloudPath + ".octree";
+		FILE* octreeFile = fopen(octreePath.c_str(), "rb");
+		if (octreeFile)
+			fclose(octreeFile);
+		joey::PointCloudBuildStats buildStats;
+		if (octreeFile || joey::buildPointCloudOctree(cloudPath, octreePath, joey::PointCloudBuildSettings(), &buildStats)) {
+			if (!octreeFile)
+				printf("Point cloud: sorted %llu points into %d nodes in %.1f s\n", (unsigned long long)buildStats.points, buildStats.nodes, buildStats.seconds);
+			pointCloud = new joey::PointCloud(octreePath, joey::PointCloudSettings(), jobSystem, &shaderCache);
+			glm::vec3 boundsMin = pointCloud->getBoundsMin();
+			glm::vec3 boundsMax = pointCloud->getBoundsMax();
+			pointCloudView.offset = glm::vec3(17.5f, -1.0f, 17.5f) - glm::vec3((boundsMin.x + boundsMax.x) * 0.5f, boundsMin.y, (boundsMin.z + boundsMax.z) * 0.5f);
+		}
+	}
 
-int main() {
-	GLFWwindow* window = initWindow("Assignment 3", screenWidth, screenHeight);
+	//Draw indices match the draw data written each frame, rebuilt when batching is toggled
+	joey::DrawList casterList;
+	bool casterListBatched = !staticBatching.enabled;
 
-	// Shader and Model Setup
-	ew::Shader sceneShader = ew::Shader("assets/lit.vert", "assets/lit.frag");
-	ew::Shader deferredShader = ew::Shader("assets/postprocess.vert", "assets/deferredLit.frag");
-	ew::Shader geometryShader = ew::Shader("assets/lit.vert", "assets/geometryPass.frag");
-	ew::Shader postProcessShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag");
-	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag");
-	ew::Shader lightOrbShader = ew::Shader("assets/lightOrb.vert", "assets/lightOrb.frag");
-	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
-	ew::Mesh planeMesh = ew::Mesh(ew::createPlane(10, 10, 5));
-	ew::Mesh sphereMesh = ew::Mesh(ew::createSphere(1.0f, 8));
-
-	// Texture Loading
-	GLuint floorTexture = ew::loadTexture("assets/Floor_Color.jpg");
-	GLuint monkeyTexture = ew::loadTexture("assets/Monkey_Color.jpg");
+	//G-buffer draws go through the render queue, sorted by material then front to back every frame
+	joey::RenderQueue renderQueue;
+	const int QUEUE_PASS_GBUFFER = 0;
+	joey::RenderState gBufferState;
+	gBufferState.shader = &geometryShader;
+	gBufferState.textures[1] = materialTextures.getTexture();
+	int gBufferStateIndex = renderQueue.addState(gBufferState);
 
 	// Camera Setup
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
@@ -180,8 +270,6 @@ int main() {
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
 
-	planeTransform.position = glm::vec3(0.0f, -1.0f, 0.0f);
-
 	lightCamera.target = glm::vec3(17.5f, 0.0f, 17.5f);
 	lightCamera.position = lightCamera.target - light.lightDirection * 10.0f;
 	lightCamera.orthographic = true;
@@ -190,35 +278,18 @@ int main() {
 	lightCamera.farPlane = 50.0f;
 	lightCamera.aspectRatio = 1;
 
-	
-	Framebuffer ppFBO = createFrameBuffer(screenWidth, screenHeight, GL_RGBA16);
-	Framebuffer lightOrbs = createFrameBuffer(screenWidth, screenHeight, GL_RGBA16);
-	Framebuffer GBuffer = createGBuffer(screenWidth, screenHeight);
-
-	// Shadow Map and Buffer Creation
-	unsigned int shadowFBO, shadowMap;
-	glCreateFramebuffers(1, &shadowFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-
-	glGenTextures(1, &shadowMap);
-	glBindTexture(GL_TEXTURE_2D, shadowMap);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, 2048, 2048);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	//Pixels outside of frustum should have max distance (white)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0);
+
+	joey::RenderGraph frameGraph(&renderTargets);
+	gpuProfiler = new joey::GpuProfiler();
+	drawStream = new joey::StreamBuffer(64 * 1024);
+	frameGraph.setProfiler(gpuProfiler);
+
+	unsigned int shadowCompareSampler = joey::createShadowCompareSampler();
 
 	// Dummy VAO
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
 	glEnable(GL_CULL_FACE);
 
 	glEnable(GL_DEPTH_TEST);
@@ -227,7 +298,6 @@ int main() {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	deferredShader.use();
 	int index = 0;
 	for (int x = 0; x < 8; x++)
 	{
@@ -241,163 +311,445 @@ int main() {
 	}
 
 
-	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+	// 256x256 faces, slots for half of all faces. The least important lights get evicted
+	pointShadowAtlas = new joey::PointShadowAtlas(MAX_POINT_LIGHTS, 256, MAX_POINT_LIGHTS * 3, &shaderCache);
 
-	// Render Loop
-	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+	shaderCache.finish();
+	printf("Shaders: %d built, %d from cache in %.1f ms%s\n", shaderCache.getMissCount(), shaderCache.getHitCount(),
+		shaderCache.getBuildMs(), shaderCache.hasParallelCompile() ? " (parallel compile)" : "");
 
-		float time = (float)glfwGetTime();
-		deltaTime = time - prevFrameTime;
-		prevFrameTime = time;
+	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-		//monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
-		cameraController.move(window, &camera, deltaTime);
+	// Runs on the render thread, which owns the context for the whole loop. Reads frame instead of the
+	// globals the main thread keeps editing. What it measures (timings, stats, previews) is only read
+	// by the UI while this thread is idle
+	unsigned int previews[4] = {};
+	auto renderFrame = [&](const FrameState& frame, ImDrawData* ui) {
+		gpuProfiler->beginFrame();
+		joey::renderStatsBeginFrame();
 
-		lightCamera.position = lightCamera.target - light.lightDirection * 10.0f;
+		bool batched = frame.staticBatching.enabled;
+		if (casterListBatched != batched)
+		{
+			casterListBatched = batched;
+			casterList.clear();
+			for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+			{
+				monkeyModel.addDraws(casterList, i);
+			}
+			if (batched) {
+				floorBatch.addDraws(casterList, MONKEY_DRAWS);
+			}
+			else {
+				for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+				{
+					casterList.add(planeMesh, MONKEY_DRAWS + i);
+				}
+			}
+		}
+		int casterDrawCount = MONKEY_DRAWS + (batched ? floorBatch.getChunkCount() : GRID_SIZE * GRID_SIZE);
 
-		glm::mat4 lightView = lightCamera.viewMatrix();
-		glm::mat4 lightProj = lightCamera.projectionMatrix();
+		drawStream->beginFrame();
+		if (frame.terrainLod.enabled)
+		{
+			terrain->setPixelError(frame.terrainLod.pixelError);
+			terrain->select(frame.camera, (float)frame.height);
+			terrain->upload(*drawStream);
+		}
+		if (pointCloud && frame.pointCloudView.enabled)
+		{
+			//The cloud keeps its own coordinates, the frame.camera moves into them instead
+			ew::Camera cloudCamera = frame.camera;
+			cloudCamera.position -= frame.pointCloudView.offset;
+			cloudCamera.target -= frame.pointCloudView.offset;
+			pointCloud->getSettings().pointBudget = frame.pointCloudView.pointBudget;
+			pointCloud->getSettings().pointSize = frame.pointCloudView.pointSize;
+			pointCloud->update(cloudCamera, (float)frame.height);
+		}
+		size_t casterDrawOffset = 0;
+		joey::GPUDrawData* casterDraws = drawStream->allocate<joey::GPUDrawData>(casterDrawCount, &casterDrawOffset);
+		//Without draw data the scene's meshes are skipped this frame, the passes still run
+		if (casterDraws)
+		{
+			JOEY_CPU_ZONE("Scene Update");
+			//Straight into mapped memory
+			jobSystem->parallelFor(GRID_SIZE * GRID_SIZE, GRID_SIZE, [casterDraws, monkeyMaterial, floorMaterial, batched](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					ew::Transform monkey = monkeyTransform, plane = planeTransform;
+					int x = i / GRID_SIZE, y = i % GRID_SIZE;
+					plane.position = glm::vec3(x * 5, -1, y * 5);
+					monkey.position = glm::vec3(x * 5, 0, y * 5);
+					casterDraws[i] = { monkey.modelMatrix(), glm::vec4(1), monkeyMaterial };
+					if (!batched)
+						casterDraws[MONKEY_DRAWS + i] = { plane.modelMatrix(), glm::vec4(1), floorMaterial };
+				}
+			});
+			if (batched)
+				floorBatch.writeDrawData(casterDraws + MONKEY_DRAWS);
+		}
+		{
+			JOEY_CPU_ZONE("Render Queue");
+			renderQueue.clear();
+			glm::vec3 forward = glm::normalize(frame.camera.target - frame.camera.position);
+			float depthRange = frame.camera.farPlane - frame.camera.nearPlane;
+			for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+			{
+				glm::vec3 position = glm::vec3(i / GRID_SIZE * 5, 0, i % GRID_SIZE * 5);
+				float depth = (glm::dot(position - frame.camera.position, forward) - frame.camera.nearPlane) / depthRange;
+				for (int mesh : monkeyModel.getPoolMeshes())
+				{
+					renderQueue.submit(joey::RenderQueue::makeKey(QUEUE_PASS_GBUFFER, gBufferStateIndex, monkeyMaterial, mesh, depth), mesh, i);
+				}
+				if (!batched)
+					renderQueue.submit(joey::RenderQueue::makeKey(QUEUE_PASS_GBUFFER, gBufferStateIndex, floorMaterial, planeMesh, depth), planeMesh, MONKEY_DRAWS + i);
+			}
+			if (batched)
+			{
+				//Chunks outside the view are skipped entirely
+				std::vector<int> visibleChunks;
+				floorBatch.cull(joey::Frustum::fromMatrix(frame.camera.projectionMatrix() * frame.camera.viewMatrix()), visibleChunks);
+				for (int c : visibleChunks)
+				{
+					const joey::StaticChunk& chunk = floorBatch.getChunks()[c];
+					glm::vec3 center = (chunk.boundsMin + chunk.boundsMax) * 0.5f;
+					float depth = (glm::dot(center - frame.camera.position, forward) - frame.camera.nearPlane) / depthRange;
+					renderQueue.submit(joey::RenderQueue::makeKey(QUEUE_PASS_GBUFFER, gBufferStateIndex, chunk.material, chunk.mesh, depth), chunk.mesh, MONKEY_DRAWS + c);
+				}
+				staticBatching.floorDraws = (int)visibleChunks.size();
+			}
+			else
+				staticBatching.floorDraws = GRID_SIZE * GRID_SIZE;
+			renderQueue.sort();
+		}
+		auto bindCasterDraws = [&]() {
+			drawStream->bindRange(GL_SHADER_STORAGE_BUFFER, joey::StreamBuffer::DRAW_DATA_BINDING, casterDrawOffset, sizeof(joey::GPUDrawData) * casterDrawCount);
+		};
+		//Shadow, point shadow and pre-pass only need positions
+		auto drawDepthCasters = [&]() {
+			if (!casterDraws)
+				return;
+			bindCasterDraws();
+			if (frame.depthPrepass.positionStream)
+				casterList.submitPositions(geometryPool);
+			else
+				casterList.submit(geometryPool);
+		};
+
+		glm::mat4 lightView = frame.lightCamera.viewMatrix();
+		glm::mat4 lightProj = frame.lightCamera.projectionMatrix();
 		glm::mat4 lightMatrix = lightProj * lightView;
 
+		// Passes are declared in frame order, the graph drops whatever the backbuffer doesn't need
+		frameGraph.reset();
+		joey::RGHandle backbuffer = frameGraph.importBackbuffer(frame.width, frame.height);
+		joey::RGHandle shadowMap = frameGraph.createTexture("Shadow Map", 2048, 2048, GL_DEPTH_COMPONENT16, GL_NEAREST);
+		joey::RGHandle gPosition = frameGraph.createTexture("GBuffer Position", frame.width, frame.height, GL_RGB32F, GL_NEAREST);
+		joey::RGHandle gNormal = frameGraph.createTexture("GBuffer Normal", frame.width, frame.height, GL_RGB16F, GL_NEAREST);
+		joey::RGHandle gAlbedo = frameGraph.createTexture("GBuffer Albedo", frame.width, frame.height, GL_RGB16F, GL_NEAREST);
+		joey::RGHandle gDepth = frameGraph.createTexture("GBuffer Depth", frame.width, frame.height, GL_DEPTH_COMPONENT16, GL_NEAREST);
+		joey::RGHandle hdr = frameGraph.createTexture("HDR", frame.width, frame.height, GL_RGBA16);
+
 		// FIRST PASS SHADOW BUFFER
-		glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-		glViewport(0, 0, 2048, 2048);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glCullFace(GL_FRONT);
-		//glDepthFunc(GL_LESS);
-
-		shadowShader.use();
-		for (int x = 0; x < 8; x++)
+		joey::RGPass& shadowPass = frameGraph.addPass("Shadow", [&](joey::RenderGraph& graph) {
+			//Pixels outside of frustum should have max distance (white)
+			unsigned int shadowTexture = graph.getTexture(shadowMap);
+			float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			glTextureParameteri(shadowTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(shadowTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTextureParameterfv(shadowTexture, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+			glCullFace(GL_FRONT);
+			//glDepthFunc(GL_LESS);
+
+			shadowShader.use();
+			shadowShader.setMat4("_ViewProjection", lightMatrix);
+			drawDepthCasters();
+		});
+		shadowMap = shadowPass.writeDepth(shadowMap, true);
+
+		// POINT LIGHT SHADOW ATLAS
+		joey::RGHandle atlas = frameGraph.importTexture("Point Shadow Atlas", pointShadowAtlas->getTexture(), pointShadowAtlas->getFaceSize(), pointShadowAtlas->getFaceSize());
+		if (frame.pointShadows.enabled)
 		{
-			for (int y = 0; y < 8; y++)
-			{
-				planeTransform.position = glm::vec3(x * 5, -1, y * 5);
-				monkeyTransform.position = glm::vec3(x * 5, 0, y * 5);
-				shadowShader.setMat4("_ViewProjection", lightMatrix);
-				shadowShader.setMat4("_Model", monkeyTransform.modelMatrix());
-				monkeyModel.draw();
-				shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-				planeMesh.draw();
-			}
+			joey::RGPass& atlasPass = frameGraph.addPass("Point Shadow Atlas", [&](joey::RenderGraph& graph) {
+				joey::PointShadowLight shadowLights[MAX_POINT_LIGHTS];
+				for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+				{
+					shadowLights[i].position = frame.pointLights[i].position;
+					shadowLights[i].radius = frame.pointLights[i].radius;
+					shadowLights[i].importance = glm::dot(glm::vec3(frame.pointLights[i].color), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+				}
+				pointShadowAtlas->update(shadowLights, MAX_POINT_LIGHTS, frame.camera, frame.pointShadows.faceBudget);
+				pointShadowAtlas->render([&](const ew::Shader& shader) {
+					drawDepthCasters();
+				});
+			});
+			atlas = atlasPass.write(atlas);
 		}
 
-		shadowShader.setMat4("_Model", monkeyTransform.modelMatrix());
-		monkeyModel.draw();
-		shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-		planeMesh.draw();
+		// DEPTH PRE-PASS, positions only. The G-buffer then shades each pixel's front surface once
+		if (frame.depthPrepass.enabled)
+		{
+			joey::RGPass& prepass = frameGraph.addPass("Depth Pre-pass", [&](joey::RenderGraph& graph) {
+				glCullFace(GL_BACK);
+				shadowShader.use();
+				shadowShader.setMat4("_ViewProjection", frame.camera.projectionMatrix() * frame.camera.viewMatrix());
+				drawDepthCasters();
+				if (frame.terrainLod.enabled) {
+					terrainDepthShader.use();
+					terrainDepthShader.setMat4("_ViewProjection", frame.camera.projectionMatrix() * frame.camera.viewMatrix());
+					terrain->draw(terrainDepthShader, 6);
+				}
+			});
+			gDepth = prepass.writeDepth(gDepth, true);
+		}
 
-		//glDepthFunc(GL_EQUAL);
-		glBindFramebuffer(GL_FRAMEBUFFER, GBuffer.fbo);
-		glViewport(0, 0, GBuffer.width, GBuffer.height);
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		joey::RGPass& gBufferPass = frameGraph.addPass("GBuffer", [&](joey::RenderGraph& graph) {
+			if (frame.depthPrepass.enabled) {
+				//Depth is final, only the fragments that wrote it pass
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+			}
+			glCullFace(GL_BACK);
 
-		glCullFace(GL_BACK);
+			geometryShader.use();
+			//geometryShader.setMat4("_LightViewProjection", lightMatrix);
+			geometryShader.setMat4("_ViewProjection", frame.camera.projectionMatrix() * frame.camera.viewMatrix());
 
-		glBindTextureUnit(0, shadowMap);
-		glBindTextureUnit(1, monkeyTexture);
-		glBindTextureUnit(2, floorTexture);
+			geometryShader.setInt("_MaterialTextures", 1);
+			if (casterDraws) {
+				bindCasterDraws();
+				renderQueue.execute(QUEUE_PASS_GBUFFER, geometryPool, *drawStream);
+			}
+			if (frame.terrainLod.enabled) {
+				//Floor texture, its patches come from the heightmap instead of the pool
+				terrainShader.use();
+				terrainShader.setMat4("_ViewProjection", frame.camera.projectionMatrix() * frame.camera.viewMatrix());
+				terrainShader.setInt("_MaterialTextures", 1);
+				terrainShader.setInt("_TerrainMaterial", floorMaterial);
+				joey::bindTextureUnit(1, materialTextures.getTexture());
+				terrain->draw(terrainShader, 6);
+			}
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_TRUE);
+		});
+		gPosition = gBufferPass.writeColor(gPosition, true, glm::vec4(0, 0, 0, 1));
+		gNormal = gBufferPass.writeColor(gNormal, true, glm::vec4(0, 0, 0, 1));
+		gAlbedo = gBufferPass.writeColor(gAlbedo, true, glm::vec4(0, 0, 0, 1));
+		gDepth = gBufferPass.writeDepth(gDepth, !frame.depthPrepass.enabled);
 
-		geometryShader.use();
-		//geometryShader.setMat4("_LightViewProjection", lightMatrix);
-		geometryShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+		// SECOND PASS (Custom Framebuffer Pass)
+		joey::RGPass& lightingPass = frameGraph.addPass("Deferred Lighting", [&](joey::RenderGraph& graph) {
+			//Each variant is its own program with its own uniforms, the benchmark below sets them per filter
+			auto useDeferredShader = [&](joey::ShadowFilter filter) {
+				const ew::Shader& deferredShader = deferredShaders.get({ joey::shadowFilterDefine(filter), { "POINT_SHADOWS", (int)frame.pointShadows.enabled } });
+				deferredShader.use();
+				joey::setShadowUniforms(deferredShader, 3, 4, frame.shadow.filterRadius);
+
+				deferredShader.setInt("_PointShadowAtlas", 5);
+				deferredShader.setFloat("_PointShadowBias", frame.pointShadows.bias);
+				deferredShader.setMat4("_LightViewProjection", lightMatrix);
+				deferredShader.setVec3("_LightDirection", frame.light.lightDirection);
+				deferredShader.setVec3("_LightColor", frame.light.lightColor);
+				deferredShader.setFloat("_MinBias", frame.shadow.minBias);
+				deferredShader.setFloat("_MaxBias", frame.shadow.maxBias);
+				deferredShader.setFloat("_Material.AmbientCo", frame.material.AmbientCo);
+				deferredShader.setFloat("_Material.DiffuseCo", frame.material.DiffuseCo);
+				deferredShader.setFloat("_Material.SpecualarCo", frame.material.SpecualarCo);
+				deferredShader.setFloat("_Material.Shininess", frame.material.Shininess);
+				deferredShader.setVec3("_EyePos", frame.camera.position);
+
+
+				for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+					//Creates prefix "_PointLights[0]." etc
+					std::string prefix = "_PointLights[" + std::to_string(i) + "].";
+					deferredShader.setVec3(prefix + "position", frame.pointLights[i].position);
+					deferredShader.setFloat(prefix + "radius", frame.pointLights[i].radius);
+					deferredShader.setVec4(prefix + "color", frame.pointLights[i].color);
+				}
+			};
+
+			// Draw Scene General Scene
+			{
+				JOEY_CPU_ZONE("Uniform Setup");
+				joey::bindTextureUnit(0, graph.getTexture(gPosition));
+				joey::bindTextureUnit(1, graph.getTexture(gNormal));
+				joey::bindTextureUnit(2, graph.getTexture(gAlbedo));
+				joey::bindShadowMap(graph.getTexture(shadowMap), shadowCompareSampler, 3, 4);
+				pointShadowAtlas->bind(5);
+				useDeferredShader(frame.shadow.filter);
+			}
 
-		for (int x = 0; x < 8; x++)
-		{
-			for (int y = 0; y < 8; y++)
+			joey::bindVertexArray(dummyVAO);
+			joey::drawArrays(GL_TRIANGLES, 0, 6);
+
+			// Time the lighting pass with every shadow filter at 1080p
+			if (frame.shadow.runBenchmark)
 			{
-				planeTransform.position = glm::vec3(x * 5, -1, y * 5);
-				monkeyTransform.position = glm::vec3(x * 5, 0, y * 5);
-				geometryShader.setInt("_MainTex", 1);
-				geometryShader.setMat4("_Model", monkeyTransform.modelMatrix());
-				monkeyModel.draw();
-				geometryShader.setMat4("_Model", planeTransform.modelMatrix());
-				geometryShader.setInt("_MainTex", 2);
-				planeMesh.draw();
+				//The benchmark has its own timer queries, which can't nest inside this pass's
+				gpuProfiler->endPass();
+				shadow.timings = joey::benchmarkShadowFilters([&](joey::ShadowFilter filter) {
+					useDeferredShader(filter);
+					glDrawArrays(GL_TRIANGLES, 0, 6);
+				});
 			}
+		});
+		lightingPass.read(gPosition);
+		lightingPass.read(gNormal);
+		lightingPass.read(gAlbedo);
+		lightingPass.read(shadowMap);
+		lightingPass.read(atlas);
+		hdr = lightingPass.writeColor(hdr, true, glm::vec4(0, 0, 0, 1));
+
+		//Orbs depth test against the G-buffer depth directly instead of a copy of it
+		joey::RGPass& orbPass = frameGraph.addPass("Light Orbs", [&](joey::RenderGraph& graph) {
+			//Draw all light orbs
+			lightOrbShader.use();
+			lightOrbShader.setMat4("_ViewProjection", frame.camera.projectionMatrix() * frame.camera.viewMatrix());
+			lightOrbShader.setInt("_Subdivisions", ORB_SUBDIVISIONS);
+			size_t orbDrawOffset = 0;
+			joey::GPUDrawData* orbDraws = drawStream->allocate<joey::GPUDrawData>(MAX_POINT_LIGHTS, &orbDrawOffset);
+			if (!orbDraws)
+				return;
+			for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+			{
+				glm::mat4 m = glm::mat4(1.0f);
+				m = glm::translate(m, frame.pointLights[i].position);
+				m = glm::scale(m, glm::vec3(0.2f)); 
+				orbDraws[i] = { m, frame.pointLights[i].color, 0 };
+			}
+			drawStream->bindRange(GL_SHADER_STORAGE_BUFFER, joey::StreamBuffer::DRAW_DATA_BINDING, orbDrawOffset, sizeof(joey::GPUDrawData) * MAX_POINT_LIGHTS);
+			//Spheres built in the vertex shader, one instanced draw and no geometry in the pool
+			joey::drawProcedural(joey::ProceduralShape::SPHERE, ORB_SUBDIVISIONS, MAX_POINT_LIGHTS);
+		});
+		hdr = orbPass.writeColor(hdr);
+		gDepth = orbPass.writeDepth(gDepth);
+
+		//Unlit, straight into the lit image like the orbs
+		if (pointCloud && frame.pointCloudView.enabled)
+		{
+			joey::RGPass& cloudPass = frameGraph.addPass("Point Cloud", [&](joey::RenderGraph& graph) {
+				pointCloud->draw(frame.camera.projectionMatrix() * frame.camera.viewMatrix() * glm::translate(glm::mat4(1.0f), frame.pointCloudView.offset));
+			});
+			hdr = cloudPass.writeColor(hdr);
+			gDepth = cloudPass.writeDepth(gDepth);
 		}
 
-		// SECOND PASS (Custom Framebuffer Pass)
-		glBindFramebuffer(GL_FRAMEBUFFER, ppFBO.fbo);
-		glViewport(0, 0, screenWidth, screenHeight);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// Draw Scene General Scene
-		deferredShader.use();
-
-		glBindTextureUnit(0, GBuffer.colorTexture[0]);
-		glBindTextureUnit(1, GBuffer.colorTexture[1]);
-		glBindTextureUnit(2, GBuffer.colorTexture[2]);
-		glBindTextureUnit(3, shadowMap);
-
-		deferredShader.setInt("_ShadowMap", 3);
-		deferredShader.setMat4("_LightViewProjection", lightMatrix);
-		deferredShader.setVec3("_LightDirection", light.lightDirection);
-		deferredShader.setVec3("_LightColor", light.lightColor);
-		deferredShader.setFloat("_MinBias", shadow.minBias);
-		deferredShader.setFloat("_MaxBias", shadow.maxBias);
-		deferredShader.setFloat("_Material.AmbientCo", material.AmbientCo);
-		deferredShader.setFloat("_Material.DiffuseCo", material.DiffuseCo);
-		deferredShader.setFloat("_Material.SpecualarCo", material.SpecualarCo);
-		deferredShader.setFloat("_Material.Shininess", material.Shininess);
-		deferredShader.setVec3("_EyePos", camera.position);
-
-
-		for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
-			//Creates prefix "_PointLights[0]." etc
-			std::string prefix = "_PointLights[" + std::to_string(i) + "].";
-			deferredShader.setVec3(prefix + "position", pointLights[i].position);
-			deferredShader.setFloat(prefix + "radius", pointLights[i].radius);
-			deferredShader.setVec4(prefix + "color", pointLights[i].color);
+		// SECOND PASS (Back to Base Backbuffer)
+		joey::RGHandle postInput = hdr;
+		if (frame.renderGraphDebug.view == 1) postInput = gPosition;
+		if (frame.renderGraphDebug.view == 2) postInput = gNormal;
+		if (frame.renderGraphDebug.view == 3) postInput = gAlbedo;
+		joey::RGPass& postPass = frameGraph.addPass("Post Process", [&](joey::RenderGraph& graph) {
+			// Apply Color Correction + Tonemapping
+			postProcessShader.use();
+			postProcessShader.setFloat("_Exposure", frame.colorCorrect.Exposure);
+			postProcessShader.setFloat("_Contrast", frame.colorCorrect.Contrast);
+			postProcessShader.setFloat("_Brightness", frame.colorCorrect.Brightness);
+
+			// Fullscreen Quad
+			joey::bindTextureUnit(0, graph.getTexture(postInput));
+			joey::bindVertexArray(dummyVAO);
+			joey::drawArrays(GL_TRIANGLES, 0, 6);
+		});
+		postPass.read(postInput);
+		postPass.writeColor(backbuffer, true, glm::vec4(0, 0, 0, 1));
+
+		//Previews keep their producers alive and their textures valid for the UI
+		if (frame.renderGraphDebug.showTargets)
+		{
+			frameGraph.markOutput(shadowMap);
+			frameGraph.markOutput(gPosition);
+			frameGraph.markOutput(gNormal);
+			frameGraph.markOutput(gAlbedo);
 		}
 
-		glBindVertexArray(dummyVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		frameGraph.execute();
+		drawStream->endFrame();
 
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, GBuffer.fbo); //Read from gBuffer 
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ppFBO.fbo); //Write to current fbo
-		glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
-		//Draw all light orbs
-		lightOrbShader.use();
-		lightOrbShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		if (frame.renderGraphDebug.showTargets)
 		{
-			glm::mat4 m = glm::mat4(1.0f);
-			m = glm::translate(m, pointLights[i].position);
-			m = glm::scale(m, glm::vec3(0.2f)); 
-
-			lightOrbShader.setMat4("_Model", m);
-			lightOrbShader.setVec3("_Color", pointLights[i].color);
-			sphereMesh.draw();
+			previews[0] = frameGraph.getTexture(shadowMap);
+			previews[1] = frameGraph.getTexture(gPosition);
+			previews[2] = frameGraph.getTexture(gNormal);
+			previews[3] = frameGraph.getTexture(gAlbedo);
 		}
 
+		gpuProfiler->beginPass("UI");
+		ImGui_ImplOpenGL3_RenderDrawData(ui);
+		gpuProfiler->endFrame();
+		//Results lag FRAME_LATENCY frames, the ones before that were rendered with the other setting
+		if (++depthPrepass.framesSinceToggle > joey::GpuProfiler::FRAME_LATENCY)
+			depthPrepass.overdraw[frame.depthPrepass.enabled] = (float)gpuProfiler->getLastFragments("GBuffer") / (frame.width * frame.height);
 
+		renderTargets.endFrame();
 
-		// SECOND PASS (Back to Base Backbuffer)
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glfwSwapBuffers(window);
+	};
 
-		// Apply Color Correction + Tonemapping
-		postProcessShader.use();
-		postProcessShader.setFloat("_Exposure", colorCorrect.Exposure);
-		postProcessShader.setFloat("_Contrast", colorCorrect.Contrast);
-		postProcessShader.setFloat("_Brightness", colorCorrect.Brightness);
+	//The backend builds its font texture and program on its first NewFrame, while the context is still here
+	ImGui_ImplOpenGL3_NewFrame();
+	//The context moves to the render thread for the loop and back for shutdown
+	glfwMakeContextCurrent(nullptr);
+	joey::RenderThread* renderThread = new joey::RenderThread([window]() { glfwMakeContextCurrent(window); }, []() { glfwMakeContextCurrent(nullptr); });
 
-		// Fullscreen Quad
-		glBindTextureUnit(0, ppFBO.colorTexture[0]);
-		glBindVertexArray(dummyVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	// Render Loop
+	while (!glfwWindowShouldClose(window)) {
+		glfwPollEvents();
 
+		float time = (float)glfwGetTime();
+		deltaTime = time - prevFrameTime;
+		prevFrameTime = time;
 
-		drawUI(GBuffer, shadowMap);
+		JOEY_CPU_FRAME();
+		JOEY_CPU_ZONE("Frame");
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		//monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
+		cameraController.move(window, &camera, deltaTime);
+
+		lightCamera.position = lightCamera.target - light.lightDirection * 10.0f;
+
+		//The UI reads what the render thread measured, so it waits for the previous frame here. That
+		//frame renders while this one takes input above. ImGui reuses its draw data on the next NewFrame,
+		//which this wait also covers
+		renderThread->flush();
+		drawUI(previews, frameGraph);
+
+		FrameState frame = { camera, lightCamera };
+		std::copy(pointLights, pointLights + MAX_POINT_LIGHTS, frame.pointLights);
+		frame.material = material;
+		frame.colorCorrect = colorCorrect;
+		frame.light = light;
+		frame.shadow = shadow;
+		frame.pointShadows = pointShadows;
+		frame.depthPrepass = depthPrepass;
+		frame.staticBatching = staticBatching;
+		frame.terrainLod = terrainLod;
+		frame.pointCloudView = pointCloudView;
+		frame.renderGraphDebug = renderGraphDebug;
+		frame.width = screenWidth;
+		frame.height = screenHeight;
+		//Runs once, in this frame
+		shadow.runBenchmark = false;
+		ImDrawData* ui = ImGui::GetDrawData();
+		renderThread->submit([&renderFrame, frame, ui]() { renderFrame(frame, ui); });
+		renderThread->endFrame();
 	}
 
-	glDeleteFramebuffers(1, &ppFBO.fbo);
+	//Renders whatever is still queued
+	delete renderThread;
+	glfwMakeContextCurrent(window);
+
+	frameGraph.reset();
+	renderTargets.trim();
+	delete gpuProfiler;
+	//Waits on its loads through the job system
+	delete pointCloud;
+	delete terrain;
+	delete jobSystem;
+	delete drawStream;
+	delete pointShadowAtlas;
 
 	printf("Shutting down...");
 }
@@ -408,9 +760,10 @@ void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
 	controller->yaw = controller->pitch = 0;
 }
 
-void drawUI(Framebuffer& gBuffer, unsigned int shadowMap) {
+void drawUI(const unsigned int* previews, const joey::RenderGraph& frameGraph) {
+	JOEY_CPU_ZONE("drawUI");
+	//No GL here, this runs on the main thread while the render thread is idle. It draws the result
 	ImGui_ImplGlfw_NewFrame();
-	ImGui_ImplOpenGL3_NewFrame();
 	ImGui::NewFrame();
 
 	ImGui::Begin("Settings");
@@ -436,6 +789,133 @@ void drawUI(Framebuffer& gBuffer, unsigned int shadowMap) {
 		{
 			ImGui::SliderFloat("Min Bias", &shadow.minBias, 0.0f, 1.0f);
 			ImGui::SliderFloat("Max Bias", &shadow.maxBias, 0.0f, 1.0f);
+
+			if (ImGui::BeginCombo("Filter", joey::shadowFilterName(shadow.filter)))
+			{
+				for (int i = 0; i < (int)joey::ShadowFilter::COUNT; i++)
+				{
+					joey::ShadowFilter filter = (joey::ShadowFilter)i;
+					if (ImGui::Selectable(joey::shadowFilterName(filter), filter == shadow.filter))
+						shadow.filter = filter;
+				}
+				ImGui::EndCombo();
+			}
+			ImGui::SliderFloat("Filter Radius", &shadow.filterRadius, 0.5f, 4.0f);
+
+			if (ImGui::Button("Benchmark Filters"))
+				shadow.runBenchmark = true;
+			for (const joey::ShadowFilterTiming& timing : shadow.timings)
+			{
+				ImGui::Text("%s: %.3f ms", joey::shadowFilterName(timing.filter), timing.gpuMs);
+			}
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Point Shadows"))
+	{
+		ImGui::Checkbox("Enabled", &pointShadows.enabled);
+		ImGui::SliderInt("Face Budget", &pointShadows.faceBudget, 0, 96);
+		ImGui::SliderFloat("Bias", &pointShadows.bias, 0.0f, 0.1f);
+		ImGui::Text("Faces rendered: %d", pointShadowAtlas->getFacesRendered());
+		ImGui::Text("Faces stale: %d", pointShadowAtlas->getDirtyFaces());
+		ImGui::Text("Slots used: %d / %d", pointShadowAtlas->getResidentFaces(), pointShadowAtlas->getSlotCount());
+		ImGui::Text("Atlas memory: %.1f MB", pointShadowAtlas->getMemoryBytes() / (1024.0f * 1024.0f));
+	}
+
+	if (ImGui::CollapsingHeader("Early Z"))
+	{
+		if (ImGui::Checkbox("Depth Pre-pass", &depthPrepass.enabled))
+			depthPrepass.framesSinceToggle = 0;
+		ImGui::Text("G-buffer overdraw: %.2f without, %.2f with", depthPrepass.overdraw[0], depthPrepass.overdraw[1]);
+		ImGui::TextDisabled("Fragments shaded per pixel, toggle to measure both");
+		ImGui::Checkbox("Position Only Depth", &depthPrepass.positionStream);
+		ImGui::TextDisabled("Compare the Shadow pass in GPU Timings");
+	}
+
+	if (ImGui::CollapsingHeader("Static Batching"))
+	{
+		ImGui::Checkbox("Batch Floor Tiles", &staticBatching.enabled);
+		ImGui::Text("%d tiles in %d chunks", GRID_SIZE * GRID_SIZE, staticBatching.chunks);
+		ImGui::Text("Floor draws: %d", staticBatching.floorDraws);
+	}
+
+	if (ImGui::CollapsingHeader("Terrain"))
+	{
+		ImGui::Checkbox("Draw Terrain", &terrainLod.enabled);
+		ImGui::SliderFloat("Pixel Error", &terrainLod.pixelError, 0.5f, 16.0f);
+		const joey::TerrainStats& stats = terrain->getStats();
+		ImGui::Text("Patches: %d of %d  Triangles: %u", stats.patches, terrain->getSettings().maxPatches, stats.triangles);
+		ImGui::Text("Nodes visited: %d  culled: %d", stats.nodesVisited, stats.nodesCulled);
+		ImGui::Text("Error used: %.1f px", stats.pixelError);
+	}
+
+	if (pointCloud && ImGui::CollapsingHeader("Point Cloud"))
+	{
+		ImGui::Checkbox("Draw Point Cloud", &pointCloudView.enabled);
+		ImGui::SliderInt("Point Budget", &pointCloudView.pointBudget, 100000, 20000000);
+		ImGui::SliderFloat("Point Size", &pointCloudView.pointSize, 1.0f, 8.0f);
+		const joey::PointCloudStats& stats = pointCloud->getStats();
+		ImGui::Text("Points: %d of %llu%s", stats.drawnPoints, (unsigned long long)pointCloud->getPointCount(), stats.budgetReached ? " (budget)" : "");
+		ImGui::Text("Nodes drawn: %d  resident: %d of %d", stats.visibleNodes, stats.residentNodes, pointCloud->getSlotCount());
+		ImGui::Text("Loading: %d  uploaded: %d (%.1f MB)", stats.loadsInFlight, stats.nodesUploaded, stats.bytesUploaded / (1024.0f * 1024.0f));
+		ImGui::Text("Evictions: %d", stats.evictions);
+	}
+
+	if (ImGui::CollapsingHeader("Render Targets"))
+	{
+		ImGui::Text("Textures: %d", renderTargets.getTextureCount());
+		ImGui::Text("Allocated: %.1f MB", renderTargets.getAllocatedBytes() / (1024.0f * 1024.0f));
+		ImGui::Text("In use: %.1f MB", renderTargets.getInUseBytes() / (1024.0f * 1024.0f));
+	}
+
+	if (ImGui::CollapsingHeader("GPU Timings"))
+	{
+		ImGui::Checkbox("Show Timings", &profiling.showTimings);
+		if (ImGui::Button("Export CSV"))
+			gpuProfiler->exportCSV("gpu_timings.csv");
+		ImGui::SameLine();
+		if (ImGui::Button("Export JSON"))
+			gpuProfiler->exportJSON("gpu_timings.json");
+		if (ImGui::Button("Reset Timings"))
+			gpuProfiler->clear();
+	}
+
+	if (ImGui::CollapsingHeader("CPU Profiler"))
+	{
+		ImGui::Checkbox("Show Flame View", &profiling.showFlameView);
+		if (ImGui::Button("Export Trace"))
+			joey::cpuProfilerExportTrace("cpu_trace.json");
+		if (ImGui::Button("Measure Zone Overhead"))
+			profiling.zoneOverheadNs = joey::cpuProfilerMeasureOverhead();
+		ImGui::Text("Zone overhead: %.1f ns", profiling.zoneOverheadNs);
+	}
+
+	if (ImGui::CollapsingHeader("Render Stats"))
+	{
+		ImGui::Checkbox("Show Render Stats", &profiling.showRenderStats);
+		const joey::RenderCounters& counters = joey::getFrameRenderCounters();
+		ImGui::Text("Draws: %d  Redundant uniforms: %d", counters.drawCalls, counters.redundantUniformUploads);
+		bool stateCache = joey::isStateCacheEnabled();
+		if (ImGui::Checkbox("State Cache", &stateCache))
+			joey::setStateCacheEnabled(stateCache);
+		ImGui::Text("State changes skipped: %d", counters.skippedStateChanges);
+		ImGui::Text("Draw data: %.1f of %.1f KB, %d stalls (last %.2f ms)", drawStream->getLastBytesUsed() / 1024.0f,
+			drawStream->getBytesPerFrame() / 1024.0f, drawStream->getStallCount(), drawStream->getLastStallMs());
+	}
+
+	if (ImGui::CollapsingHeader("Render Graph"))
+	{
+		const char* views[] = { "Lit", "Position", "Normal", "Albedo" };
+		ImGui::Combo("View", &renderGraphDebug.view, views, 4);
+		ImGui::Checkbox("Preview Targets", &renderGraphDebug.showTargets);
+
+		const joey::RenderGraphStats& stats = frameGraph.getStats();
+		ImGui::Text("Passes: %d (%d culled)", stats.passesDeclared, stats.passesCulled);
+		ImGui::Text("Textures: %d on %d physical", stats.transientTextures, stats.physicalTextures);
+		ImGui::Text("Memory: %.1f MB (%.1f MB unaliased)", stats.physicalBytes / (1024.0f * 1024.0f), stats.unaliasedBytes / (1024.0f * 1024.0f));
+		for (const std::string& pass : frameGraph.getPassLog())
+		{
+			ImGui::BulletText("%s", pass.c_str());
 		}
 	}
 
@@ -454,34 +934,47 @@ void drawUI(Framebuffer& gBuffer, unsigned int shadowMap) {
 	}
 	ImGui::End();
 
-	ImGui::Begin("Shadow Map");
-	ImGui::BeginChild("Shadow Map");
-	//Stretch image to be window size
-	ImVec2 windowSize = ImGui::GetWindowSize();
-	//Invert 0-1 V to flip vertically for ImGui display
-	//shadowMap is the texture2D handle
-	ImGui::Image((ImTextureID)shadowMap, windowSize, ImVec2(0, 1), ImVec2(1, 0));
-	ImGui::EndChild();
+	if (profiling.showTimings)
+		gpuProfiler->drawUI();
+	if (profiling.showFlameView)
+		joey::cpuProfilerDrawFlameView();
+	if (profiling.showRenderStats)
+		joey::drawRenderStatsUI();
 
-	ImGui::End();
-
-	ImGui::Begin("GBuffers");
-	ImVec2 texSize = ImVec2(gBuffer.width / 4, gBuffer.height / 4);
-	for (size_t i = 0; i < 3; i++)
+	if (renderGraphDebug.showTargets)
 	{
-		ImGui::Image((ImTextureID)gBuffer.colorTexture[i], texSize, ImVec2(0, 1), ImVec2(1, 0));
+		ImGui::Begin("Shadow Map");
+		ImGui::BeginChild("Shadow Map");
+		//Stretch image to be window size
+		ImVec2 windowSize = ImGui::GetWindowSize();
+		//Invert 0-1 V to flip vertically for ImGui display
+		//previews[0] is the shadow map's texture2D handle
+		ImGui::Image((ImTextureID)previews[0], windowSize, ImVec2(0, 1), ImVec2(1, 0));
+		ImGui::EndChild();
+
+		ImGui::End();
+
+		ImGui::Begin("GBuffers");
+		ImVec2 texSize = ImVec2(screenWidth / 4, screenHeight / 4);
+		for (size_t i = 1; i < 4; i++)
+		{
+			ImGui::Image((ImTextureID)previews[i], texSize, ImVec2(0, 1), ImVec2(1, 0));
+		}
+		ImGui::End();
 	}
-	ImGui::End();
 
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	//Minimized windows report 0x0, keep rendering at the old size until restored
+	if (width == 0 || height == 0)
+		return;
+	//Main thread, no context. Frames carry the size, the render graph sets viewports from it
 	screenWidth = width;
 	screenHeight = height;
+	camera.aspectRatio = (float)width / height;
 }
 
 /// <summary>
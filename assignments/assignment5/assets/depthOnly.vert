@@ -1,11 +1,13 @@
 #version 450
+#include "core/drawData.glsl"
+
+//Same positions in the depth pre-pass (depthOnly.vert) and the G-buffer pass (lit.vert), for GL_EQUAL
+invariant gl_Position;
 layout (location = 0) in vec3 vPos;
 
 uniform mat4 _ViewProjection;
 
-uniform mat4 _Model;
-
 void main()
 {
-	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+	gl_Position = _ViewProjection * CURRENT_DRAW.model * vec4(vPos, 1.0);
 }
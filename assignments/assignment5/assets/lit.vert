@@ -1,10 +1,13 @@
 #version 450
+#include "core/drawData.glsl"
+
+//Same positions in the depth pre-pass (depthOnly.vert) and the G-buffer pass (lit.vert), for GL_EQUAL
+invariant gl_Position;
 
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
 
-uniform mat4 _Model;
 uniform mat4 _ViewProjection;
 uniform mat4 _LightViewProjection;
 
@@ -15,12 +18,15 @@ out Surface{
 }vs_out;
 
 out vec4 LightSpacePos;
+flat out int MaterialIndex;
 
 void main()
 {
-	vs_out.WorldPos = vec3(_Model * vec4(vPos, 1.0));
-	vs_out.WorldNormal = transpose(inverse(mat3(_Model))) * vNormal;
+	mat4 model = CURRENT_DRAW.model;
+	vs_out.WorldPos = vec3(model * vec4(vPos, 1.0));
+	vs_out.WorldNormal = transpose(inverse(mat3(model))) * vNormal;
 	vs_out.TexCoord = vTexCoord;
-	LightSpacePos = _LightViewProjection * _Model * vec4(vPos, 1);
-	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
-}
\ No newline at end of file
+	LightSpacePos = _LightViewProjection * model * vec4(vPos, 1);
+	MaterialIndex = CURRENT_DRAW.material.x;
+	gl_Position = _ViewProjection * model * vec4(vPos, 1.0);
+}
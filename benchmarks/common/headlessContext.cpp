@@ -0,0 +1,126 @@
+#include "headlessContext.h"
+#include <stdio.h>
+
+#if BENCH_HEADLESS_EGL
+//Before glad, its bundled khrplatform.h lacks KHRONOS_APIENTRY
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <ew/external/glad.h>
+
+static EGLDisplay s_display = EGL_NO_DISPLAY;
+static EGLContext s_context = EGL_NO_CONTEXT;
+
+bool createHeadlessContext()
+{
+	//Prefer the surfaceless platform so no X11/Wayland connection is attempted
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		s_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (s_display == EGL_NO_DISPLAY)
+		s_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (s_display == EGL_NO_DISPLAY || !eglInitialize(s_display, &major, &minor)) {
+		printf("EGL failed to initialize\n");
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		printf("EGL has no desktop OpenGL\n");
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	eglChooseConfig(s_display, configAttribs, &config, 1, &numConfigs);
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	s_context = eglCreateContext(s_display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (s_context == EGL_NO_CONTEXT) {
+		printf("EGL failed to create an OpenGL 4.5 core context\n");
+		return false;
+	}
+	//EGL_KHR_surfaceless_context, everything renders to FBOs
+	if (!eglMakeCurrent(s_display, EGL_NO_SURFACE, EGL_NO_SURFACE, s_context)) {
+		printf("EGL failed to make the context current without a surface\n");
+		return false;
+	}
+	if (!gladLoadGL((GLADloadfunc)eglGetProcAddress)) {
+		printf("GLAD Failed to load GL headers\n");
+		return false;
+	}
+	return true;
+}
+
+void destroyHeadlessContext()
+{
+	eglMakeCurrent(s_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(s_display, s_context);
+	eglTerminate(s_display);
+}
+
+bool makeHeadlessContextCurrent(bool current)
+{
+	return eglMakeCurrent(s_display, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? s_context : EGL_NO_CONTEXT);
+}
+
+const char* headlessContextApi()
+{
+	return "EGL";
+}
+#else
+#include <ew/external/glad.h>
+#include <GLFW/glfw3.h>
+
+static GLFWwindow* s_window = nullptr;
+
+bool createHeadlessContext()
+{
+	if (!glfwInit()) {
+		printf("GLFW failed to init!\n");
+		return false;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	s_window = glfwCreateWindow(1, 1, "benchmark", NULL, NULL);
+	if (s_window == NULL) {
+		printf("GLFW failed to create window\n");
+		return false;
+	}
+	glfwMakeContextCurrent(s_window);
+	//Never wait on a display
+	glfwSwapInterval(0);
+	if (!gladLoadGL(glfwGetProcAddress)) {
+		printf("GLAD Failed to load GL headers\n");
+		return false;
+	}
+	return true;
+}
+
+void destroyHeadlessContext()
+{
+	glfwDestroyWindow(s_window);
+	glfwTerminate();
+}
+
+bool makeHeadlessContextCurrent(bool current)
+{
+	glfwMakeContextCurrent(current ? s_window : NULL);
+	return true;
+}
+
+const char* headlessContextApi()
+{
+	return "GLFW";
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+// OpenGL 4.5 context without a visible window.
+// With BENCH_HEADLESS_EGL this is a surfaceless EGL context, which Mesa's llvmpipe
+// provides without any display (EGL_PLATFORM=surfaceless). Otherwise a hidden GLFW window.
+// Only offscreen framebuffers can be rendered to either way.
+bool createHeadlessContext();
+void destroyHeadlessContext();
+// Binds the context to the calling thread, or releases it from the calling thread.
+// A context can only be current on one thread at a time
+bool makeHeadlessContextCurrent(bool current);
+// "EGL" or "GLFW"
+const char* headlessContextApi();
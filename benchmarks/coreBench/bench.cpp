@@ -0,0 +1,158 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include <joey/jsonString.h>
+
+//Every allocation in the process goes through here. Allocations inside shared libraries
+//(assimp as a DLL on Windows) use their own allocator and aren't counted
+static std::atomic<size_t> s_allocations{ 0 };
+static std::atomic<size_t> s_allocatedBytes{ 0 };
+
+static void* countedAlloc(size_t size)
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	void* pointer = malloc(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return countedAlloc(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return countedAlloc(size); } catch (...) { return nullptr; } }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+
+namespace bench
+{
+	static std::vector<Result> s_results;
+	static const void* volatile s_escaped;
+
+	void escape(const void* pointer)
+	{
+		s_escaped = pointer;
+	}
+
+	Settings& settings()
+	{
+		static Settings s_settings;
+		return s_settings;
+	}
+
+	const std::vector<Result>& results()
+	{
+		return s_results;
+	}
+
+	static double timeBatch(const std::function<void(int)>& operation, int iterations, int* iterationIndex)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			operation((*iterationIndex)++);
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	void run(const std::string& name, const std::function<void(int)>& operation)
+	{
+		const Settings& config = settings();
+		if (!config.filter.empty() && name.find(config.filter) == std::string::npos)
+			return;
+
+		int iterationIndex = 0;
+		for (int i = 0; i < config.warmupIterations; i++)
+		{
+			operation(iterationIndex++);
+		}
+
+		//Grow the batch until it's long enough to time reliably
+		const int MAX_BATCH = 1 << 24;
+		int batch = 1;
+		while (batch < MAX_BATCH && timeBatch(operation, batch, &iterationIndex) < config.minBatchMs * 1000000.0)
+		{
+			batch *= 2;
+		}
+
+		std::vector<double> perOpNs;
+		perOpNs.reserve(config.repetitions);
+		size_t allocationsBefore = s_allocations.load(std::memory_order_relaxed);
+		size_t bytesBefore = s_allocatedBytes.load(std::memory_order_relaxed);
+		for (int r = 0; r < config.repetitions; r++)
+		{
+			perOpNs.push_back(timeBatch(operation, batch, &iterationIndex) / batch);
+		}
+		double totalOps = (double)batch * config.repetitions;
+		size_t allocations = s_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+		size_t bytes = s_allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+		Result result;
+		result.name = name;
+		result.iterationsPerBatch = batch;
+		double sum = 0.0;
+		for (double ns : perOpNs)
+		{
+			sum += ns;
+		}
+		result.meanNs = sum / perOpNs.size();
+		double variance = 0.0;
+		for (double ns : perOpNs)
+		{
+			variance += (ns - result.meanNs) * (ns - result.meanNs);
+		}
+		result.stddevNs = sqrt(variance / perOpNs.size());
+		std::sort(perOpNs.begin(), perOpNs.end());
+		result.medianNs = perOpNs[perOpNs.size() / 2];
+		result.minNs = perOpNs.front();
+		result.allocationsPerOp = allocations / totalOps;
+		result.bytesPerOp = bytes / totalOps;
+		s_results.push_back(result);
+
+		printf("%-44s %12.1f ns  +-%5.1f%%  %8.2f allocs  %10.0f bytes\n", name.c_str(), result.medianNs,
+			result.meanNs > 0.0 ? 100.0 * result.stddevNs / result.meanNs : 0.0, result.allocationsPerOp, result.bytesPerOp);
+	}
+
+	void printResults()
+	{
+		printf("\n%-44s %12s %12s %12s %8s %10s\n", "case", "median ns", "min ns", "stddev ns", "allocs", "bytes");
+		for (const Result& result : s_results)
+		{
+			printf("%-44s %12.1f %12.1f %12.1f %8.2f %10.0f\n", result.name.c_str(), result.medianNs, result.minNs,
+				result.stddevNs, result.allocationsPerOp, result.bytesPerOp);
+		}
+	}
+
+	bool writeJson(const char* filePath)
+	{
+		FILE* file = fopen(filePath, "w");
+		if (!file) {
+			printf("Failed to open %s\n", filePath);
+			return false;
+		}
+		fprintf(file, "{\n\t\"warmupIterations\": %d,\n\t\"repetitions\": %d,\n\t\"cases\": [\n",
+			settings().warmupIterations, settings().repetitions);
+		for (size_t i = 0; i < s_results.size(); i++)
+		{
+			const Result& r = s_results[i];
+			fprintf(file, "\t\t{ \"name\": %s, \"iterationsPerBatch\": %d, \"meanNs\": %.2f, \"medianNs\": %.2f, \"minNs\": %.2f, \"stddevNs\": %.2f, \"allocationsPerOp\": %.3f, \"bytesPerOp\": %.1f }%s\n",
+				joey::jsonString(r.name).c_str(), r.iterationsPerBatch, r.meanNs, r.medianNs, r.minNs, r.stddevNs, r.allocationsPerOp, r.bytesPerOp,
+				i + 1 < s_results.size() ? "," : "");
+		}
+		fprintf(file, "\t]\n}\n");
+		fclose(file);
+		return true;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark runner.
+// Each case runs warm-up iterations, then REPETITIONS timed batches. A batch repeats the
+// operation enough times to take at least MIN_BATCH_MS, so timer resolution doesn't matter.
+// Allocations are counted by the global operator new replacement in bench.cpp.
+
+namespace bench
+{
+	struct Result {
+		std::string name;
+		int iterationsPerBatch;
+		double meanNs; //Per operation, averaged over batches
+		double medianNs;
+		double minNs;
+		double stddevNs;
+		double allocationsPerOp;
+		double bytesPerOp;
+	};
+
+	struct Settings {
+		int warmupIterations = 10;
+		int repetitions = 15;
+		double minBatchMs = 20.0;
+		std::string filter; //Only run cases containing this
+	};
+
+	// Operation gets the iteration index, so inputs can vary and calls can't be hoisted
+	void run(const std::string& name, const std::function<void(int)>& operation);
+
+	Settings& settings();
+	const std::vector<Result>& results();
+	void printResults();
+	bool writeJson(const char* filePath);
+
+	// Keeps value (and everything it depends on) from being optimized away
+	void escape(const void* pointer);
+	template<typename T>
+	inline void doNotOptimize(const T& value) { escape(&value); }
+}
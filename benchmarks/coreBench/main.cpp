@@ -0,0 +1,499 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ew/external/glad.h>
+#include <ew/external/stb_image.h>
+
+#include <ew/shader.h>
+#include <ew/model.h>
+#include <ew/camera.h>
+#include <ew/transform.h>
+#include <ew/texture.h>
+#include <ew/procGen.h>
+
+#include <joey/jobSystem.h>
+#include <joey/geometryPool.h>
+#include <joey/dynamicMesh.h>
+#include <joey/pointCloud.h>
+#include <joey/materialTextures.h>
+#include <joey/shaderCache.h>
+#include <joey/shaderVariants.h>
+#include <joey/shadow.h>
+#include <joey/stateCache.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <headlessContext.h>
+#include "bench.h"
+
+// Usage (from bin/, like the assignments):
+//   core_bench [--filter name] [--repetitions N] [--warmup N] [--out core_bench.json]
+// Cases that touch GL finish the GL work inside the timed operation, so uploads are counted.
+// ew::Mesh and ew::Shader never free their GL objects, those cases leak a few hundred meshes or programs per run
+
+static const char* MODEL_PATH = "assets/suzanne.obj";
+static const char* TEXTURE_PATH = "assets/Monkey_Color.jpg";
+static const char* SHADER_PATH = "assets/deferredLit.frag";
+
+static void procGenCases()
+{
+	const int sphereLevels[] = { 8, 32, 128, 1000 };
+	for (int subdivisions : sphereLevels)
+	{
+		bench::run("createSphere/" + std::to_string(subdivisions), [=](int) {
+			ew::MeshData mesh = ew::createSphere(1.0f, subdivisions);
+			bench::doNotOptimize(mesh);
+		});
+	}
+	const int planeLevels[] = { 5, 50, 200, 1000 };
+	for (int subdivisions : planeLevels)
+	{
+		bench::run("createPlane/" + std::to_string(subdivisions), [=](int) {
+			ew::MeshData mesh = ew::createPlane(10.0f, 10.0f, subdivisions);
+			bench::doNotOptimize(mesh);
+		});
+	}
+	const int cylinderLevels[] = { 8, 64, 256 };
+	for (int subdivisions : cylinderLevels)
+	{
+		bench::run("createCylinder/" + std::to_string(subdivisions), [=](int) {
+			ew::MeshData mesh = ew::createCylinder(1.0f, 2.0f, subdivisions);
+			bench::doNotOptimize(mesh);
+		});
+	}
+	bench::run("createCube", [](int) {
+		ew::MeshData mesh = ew::createCube(1.0f);
+		bench::doNotOptimize(mesh);
+	});
+	//Welds UV seams, the sphere's uv seam column and poles
+	ew::MeshData sphere = ew::createSphere(1.0f, 128);
+	bench::run("createPositionStream (sphere/128)", [&](int) {
+		ew::PositionMeshData positions = ew::createPositionStream(sphere);
+		bench::doNotOptimize(positions);
+	});
+}
+
+// The same grids generated into memory allocated once, on one thread and on all of them, and into a
+// mapped GPU buffer. Level 1000 is about a million vertices
+static void procGenTargetCases()
+{
+	joey::JobSystem jobs;
+	std::string threads = "/threads=" + std::to_string(jobs.getThreadCount());
+	const int MAX_LEVEL = 1000;
+	//The plane has the most vertices and indices of the two at every level
+	ew::MeshSize capacity = ew::planeSize(MAX_LEVEL);
+	std::vector<ew::Vertex> vertices(capacity.vertices);
+	std::vector<unsigned int> indices(capacity.indices);
+	const int levels[] = { 100, 300, MAX_LEVEL };
+	for (int subdivisions : levels)
+	{
+		std::string level = "/" + std::to_string(subdivisions);
+		bench::run("createPlane into memory" + level, [&](int) {
+			ew::createPlane(100.0f, 100.0f, subdivisions, vertices.data(), indices.data());
+			bench::doNotOptimize(vertices);
+		});
+		bench::run("createPlane into memory" + level + threads, [&](int) {
+			ew::createPlane(100.0f, 100.0f, subdivisions, vertices.data(), indices.data(), &jobs);
+			bench::doNotOptimize(vertices);
+		});
+		bench::run("createSphere into memory" + level, [&](int) {
+			ew::createSphere(1.0f, subdivisions, vertices.data(), indices.data());
+			bench::doNotOptimize(vertices);
+		});
+		bench::run("createSphere into memory" + level + threads, [&](int) {
+			ew::createSphere(1.0f, subdivisions, vertices.data(), indices.data(), &jobs);
+			bench::doNotOptimize(vertices);
+		});
+	}
+
+	unsigned int buffers[2];
+	glCreateBuffers(2, buffers);
+	GLsizeiptr vertexBytes = sizeof(ew::Vertex) * capacity.vertices;
+	GLsizeiptr indexBytes = sizeof(unsigned int) * capacity.indices;
+	glNamedBufferStorage(buffers[0], vertexBytes, nullptr, GL_MAP_WRITE_BIT);
+	glNamedBufferStorage(buffers[1], indexBytes, nullptr, GL_MAP_WRITE_BIT);
+	bench::run("createPlane into mapped buffer/" + std::to_string(MAX_LEVEL) + threads, [&](int) {
+		ew::Vertex* mappedVertices = (ew::Vertex*)glMapNamedBufferRange(buffers[0], 0, vertexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		unsigned int* mappedIndices = (unsigned int*)glMapNamedBufferRange(buffers[1], 0, indexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		ew::createPlane(100.0f, 100.0f, MAX_LEVEL, mappedVertices, mappedIndices, &jobs);
+		glUnmapNamedBuffer(buffers[0]);
+		glUnmapNamedBuffer(buffers[1]);
+		glFinish();
+	});
+	glDeleteBuffers(2, buffers);
+}
+
+static void modelCases()
+{
+	bench::run("Model import (suzanne.obj)", [](int) {
+		ew::Model model(MODEL_PATH);
+		glFinish();
+		bench::doNotOptimize(model);
+	});
+
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(MODEL_PATH, aiProcess_Triangulate);
+	if (!scene || scene->mNumMeshes == 0) {
+		printf("Failed to load %s, skipping mesh conversion cases\n", MODEL_PATH);
+		return;
+	}
+	aiMesh* mesh = scene->mMeshes[0];
+	bench::run("Assimp ReadFile (suzanne.obj)", [](int) {
+		Assimp::Importer caseImporter;
+		const aiScene* caseScene = caseImporter.ReadFile(MODEL_PATH, aiProcess_Triangulate);
+		bench::doNotOptimize(caseScene);
+	});
+	bench::run("convertAiMesh", [=](int) {
+		ew::MeshData meshData = ew::convertAiMesh(mesh);
+		bench::doNotOptimize(meshData);
+	});
+	bench::run("processAiMesh (convert + upload)", [=](int) {
+		ew::Mesh uploaded = ew::processAiMesh(mesh);
+		glFinish();
+		bench::doNotOptimize(uploaded);
+	});
+}
+
+static void transformCases()
+{
+	bench::run("Transform::modelMatrix", [](int i) {
+		ew::Transform transform;
+		transform.position = glm::vec3((float)i, 1.0f, 2.0f);
+		transform.rotation = glm::rotate(transform.rotation, i * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f));
+		transform.scale = glm::vec3(1.0f + i * 0.0001f);
+		glm::mat4 m = transform.modelMatrix();
+		bench::doNotOptimize(m);
+	});
+
+	ew::Camera camera;
+	bench::run("Camera::viewMatrix", [&](int i) {
+		camera.position = glm::vec3(5.0f, 2.0f, (float)(i % 100));
+		glm::mat4 m = camera.viewMatrix();
+		bench::doNotOptimize(m);
+	});
+	bench::run("Camera::projectionMatrix (perspective)", [&](int i) {
+		camera.orthographic = false;
+		camera.fov = 60.0f + (i % 10);
+		glm::mat4 m = camera.projectionMatrix();
+		bench::doNotOptimize(m);
+	});
+	bench::run("Camera::projectionMatrix (ortho)", [&](int i) {
+		camera.orthographic = true;
+		camera.orthoHeight = 6.0f + (i % 10);
+		glm::mat4 m = camera.projectionMatrix();
+		bench::doNotOptimize(m);
+	});
+}
+
+static void assetCases()
+{
+	bench::run("loadShaderSourceFromFile (deferredLit.frag)", [](int) {
+		std::string source = ew::loadShaderSourceFromFile(SHADER_PATH);
+		bench::doNotOptimize(source);
+	});
+	bench::run("stbi_load decode (Monkey_Color.jpg)", [](int) {
+		int width, height, numComponents;
+		unsigned char* data = stbi_load(TEXTURE_PATH, &width, &height, &numComponents, 0);
+		bench::doNotOptimize(data);
+		stbi_image_free(data);
+	});
+	bench::run("loadTexture (decode + upload + mips)", [](int) {
+		unsigned int texture = ew::loadTexture(TEXTURE_PATH);
+		glFinish();
+		glDeleteTextures(1, &texture);
+	});
+	bench::run("MaterialTextures::load (decode + layer upload + mips)", [](int) {
+		joey::MaterialTextures materials(2048, 2048);
+		materials.load({ TEXTURE_PATH });
+		glFinish();
+	});
+}
+
+// The assignments' programs, built from source and then from binaries saved by the first
+// warm-up. Drivers keep their own cache too, so cold is a lower bound on a first run
+static void shaderCacheCases()
+{
+	const char* PROGRAMS[][2] = {
+		{ "assets/postprocess.vert", "assets/deferredLit.frag" },
+		{ "assets/lit.vert", "assets/geometryPass.frag" },
+		{ "assets/postprocess.vert", "assets/postprocess.frag" },
+		{ "assets/depthOnly.vert", "assets/depthOnly.frag" },
+		{ "assets/lightOrb.vert", "assets/lightOrb.frag" },
+	};
+	const int PROGRAM_COUNT = sizeof(PROGRAMS) / sizeof(PROGRAMS[0]);
+	//deferredLit.frag needs the light count injected, the other stages ignore it
+	const std::string defines = "#define MAX_POINT_LIGHTS 64\n";
+	std::vector<std::string> sources;
+	for (int i = 0; i < PROGRAM_COUNT; i++)
+	{
+		sources.push_back(ew::loadShaderSourceFromFile(PROGRAMS[i][0], defines));
+		sources.push_back(ew::loadShaderSourceFromFile(PROGRAMS[i][1], defines));
+	}
+	auto build = [&](const std::string& directory) {
+		joey::ShaderCache cache(directory);
+		unsigned int programs[PROGRAM_COUNT];
+		for (int i = 0; i < PROGRAM_COUNT; i++)
+		{
+			programs[i] = cache.request(PROGRAMS[i][1], sources[i * 2].c_str(), nullptr, sources[i * 2 + 1].c_str());
+		}
+		cache.finish();
+		for (int i = 0; i < PROGRAM_COUNT; i++)
+		{
+			joey::stateCacheForgetProgram(programs[i]);
+			glDeleteProgram(programs[i]);
+		}
+	};
+	bench::run("ShaderCache cold (5 programs from source)", [&](int) {
+		build("");
+	});
+	bench::run("ShaderCache warm (5 programs from binaries)", [&](int) {
+		build("core_bench_shaderCache");
+	});
+	//A filter switch that misses: preprocess and build one deferredLit variant
+	int filter = 0;
+	bench::run("ShaderVariants::get (new deferredLit variant)", [&](int) {
+		joey::ShaderVariants variants("assets/postprocess.vert", "assets/deferredLit.frag");
+		variants.setDefine("MAX_POINT_LIGHTS", 64);
+		const ew::Shader& shader = variants.get({ joey::shadowFilterDefine((joey::ShadowFilter)(filter++ % (int)joey::ShadowFilter::COUNT)), { "POINT_SHADOWS", 1 } });
+		bench::doNotOptimize(shader);
+		glFinish();
+	});
+}
+
+// Fills a pool, frees every other mesh so the free space is fragmented, then compacts it
+static void geometryPoolCases()
+{
+	const int MESH_COUNT = 256;
+	ew::MeshData sphere = ew::createSphere(1.0f, 8);
+	joey::GeometryPool pool(MESH_COUNT * (unsigned int)sphere.vertices.size(), MESH_COUNT * (unsigned int)sphere.indices.size());
+	std::vector<int> meshes(MESH_COUNT);
+	bench::run("GeometryPool add 256 spheres", [&](int) {
+		for (int i = 0; i < MESH_COUNT; i++)
+		{
+			meshes[i] = pool.add(sphere);
+		}
+		glFinish();
+		for (int i = 0; i < MESH_COUNT; i++)
+		{
+			pool.remove(meshes[i]);
+		}
+	});
+	bench::run("GeometryPool defragment 128 of 256", [&](int) {
+		for (int i = 0; i < MESH_COUNT; i++)
+		{
+			meshes[i] = pool.add(sphere);
+		}
+		for (int i = 0; i < MESH_COUNT; i += 2)
+		{
+			pool.remove(meshes[i]);
+		}
+		pool.defragment();
+		glFinish();
+		for (int i = 1; i < MESH_COUNT; i += 2)
+		{
+			pool.remove(meshes[i]);
+		}
+	});
+}
+
+// A 100k vertex grid deformed every iteration, against re-creating its storage with ew::Mesh::load.
+// Nothing waits for the GPU here, so any pipeline stall shows up as time
+static void dynamicMeshCases()
+{
+	const int SUBDIVISIONS = 316; //317^2 vertices
+	ew::MeshData grid = ew::createPlane(10.0f, 10.0f, SUBDIVISIONS);
+	int vertexCount = (int)grid.vertices.size();
+	joey::JobSystem jobs;
+	std::string threads = "/threads=" + std::to_string(jobs.getThreadCount());
+	auto wave = [](std::vector<ew::Vertex>& vertices, int iteration, int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			vertices[i].pos.y = sinf(vertices[i].pos.x * 2.0f + iteration * 0.1f) * 0.25f;
+		}
+	};
+
+	joey::DynamicMesh dynamicMesh(grid);
+	std::vector<ew::Vertex>& vertices = dynamicMesh.getVertices();
+	//Same work as the Mesh::load case below
+	bench::run("DynamicMesh deform + update 100k", [&](int iteration) {
+		wave(vertices, iteration, 0, vertexCount);
+		dynamicMesh.markDirty(0, vertexCount);
+		dynamicMesh.update();
+	});
+	bench::run("DynamicMesh deform + normals + update 100k" + threads, [&](int iteration) {
+		jobs.parallelFor(vertexCount, 4096, [&](int begin, int end) { wave(vertices, iteration, begin, end); });
+		dynamicMesh.recomputeNormals(&jobs);
+		dynamicMesh.update();
+	});
+	//A band of rows, normals of the rows either side change with it
+	int bandStart = vertexCount / 2, bandCount = vertexCount / 10;
+	int rowLength = SUBDIVISIONS + 1;
+	bench::run("DynamicMesh deform + normals + update 10% of 100k", [&](int iteration) {
+		wave(vertices, iteration, bandStart, bandStart + bandCount);
+		dynamicMesh.recomputeNormals(nullptr, bandStart - rowLength, bandCount + rowLength * 2);
+		dynamicMesh.update();
+	});
+	glFinish();
+	printf("DynamicMesh: %d of its updates waited for the GPU\n", dynamicMesh.getStallCount());
+
+	ew::Mesh mesh(grid);
+	bench::run("Mesh::load every frame 100k", [&](int iteration) {
+		wave(grid.vertices, iteration, 0, vertexCount);
+		mesh.load(grid);
+	});
+	glFinish();
+}
+
+// A synthetic scan, a rolling surface with some noise above it, as binary PLY in the working directory
+static void writeBenchPointCloud(const char* path, int pointCount)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return;
+	fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %d\n"
+		"property float x\nproperty float y\nproperty float z\n"
+		"property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n", pointCount);
+	unsigned int seed = 1;
+	auto random = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	for (int i = 0; i < pointCount; i++)
+	{
+		float position[3];
+		position[0] = random() * 200.0f - 100.0f;
+		position[2] = random() * 200.0f - 100.0f;
+		position[1] = sinf(position[0] * 0.05f) * cosf(position[2] * 0.07f) * 10.0f + random() * random() * 8.0f;
+		unsigned char color[3] = { (unsigned char)(position[1] * 8.0f + 128.0f), 160, (unsigned char)(random() * 255.0f) };
+		fwrite(position, sizeof(position), 1, file);
+		fwrite(color, sizeof(color), 1, file);
+	}
+	fclose(file);
+}
+
+// Octree builds in memory and through temporary files, then an orbit over the result with loads on the job system
+static void pointCloudCases()
+{
+	const char* SOURCE_PATH = "core_bench_cloud.ply";
+	const char* OCTREE_PATH = "core_bench_cloud.octree";
+	const int POINT_COUNT = 2 * 1000 * 1000;
+	writeBenchPointCloud(SOURCE_PATH, POINT_COUNT);
+
+	joey::PointCloudBuildSettings buildSettings;
+	joey::PointCloudBuildStats buildStats;
+	bench::run("buildPointCloudOctree in memory 2M", [&](int) {
+		joey::buildPointCloudOctree(SOURCE_PATH, OCTREE_PATH, buildSettings, &buildStats);
+	});
+	buildSettings.memoryPoints = 256 * 1024;
+	bench::run("buildPointCloudOctree spilled 2M (256k in memory)", [&](int) {
+		joey::buildPointCloudOctree(SOURCE_PATH, OCTREE_PATH, buildSettings, &buildStats);
+	});
+	printf("PointCloud: %d nodes, depth %d, %d spill passes\n", buildStats.nodes, buildStats.depth, buildStats.spillPasses);
+
+	joey::JobSystem jobs;
+	joey::PointCloudSettings settings;
+	settings.pointBudget = 1000 * 1000;
+	settings.gpuBytes = 32 * 1024 * 1024;
+	joey::PointCloud cloud(OCTREE_PATH, settings, &jobs);
+	ew::Camera camera;
+	camera.farPlane = 1000.0f;
+	bench::run("PointCloud::update + draw orbit 1M budget", [&](int iteration) {
+		float angle = iteration * 0.05f;
+		camera.position = glm::vec3(cosf(angle) * 60.0f, 20.0f, sinf(angle) * 60.0f);
+		cloud.update(camera, 1080.0f);
+		cloud.draw(camera.projectionMatrix() * camera.viewMatrix());
+		glFinish();
+	});
+	const joey::PointCloudStats& stats = cloud.getStats();
+	printf("PointCloud: %d nodes drawn, %d points, %d resident of %d slots, %d evictions\n",
+		stats.visibleNodes, stats.drawnPoints, stats.residentNodes, cloud.getSlotCount(), stats.evictions);
+	remove(SOURCE_PATH);
+	remove(OCTREE_PATH);
+}
+
+// Same work on 1..N threads. Transforms are fine grained, spheres are a few large jobs
+static void jobSystemCases()
+{
+	int maxThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	const int TRANSFORM_COUNT = 65536;
+	const int SPHERE_COUNT = 64;
+	std::vector<glm::mat4> matrices(TRANSFORM_COUNT);
+	std::vector<ew::MeshData> spheres(SPHERE_COUNT);
+	for (int threads : threadCounts)
+	{
+		joey::JobSystem jobs(threads - 1);
+		bench::run("parallelFor 64k Transform::modelMatrix/threads=" + std::to_string(threads), [&](int iteration) {
+			jobs.parallelFor(TRANSFORM_COUNT, 1024, [&](int begin, int end) {
+				ew::Transform transform;
+				for (int i = begin; i < end; i++)
+				{
+					transform.position = glm::vec3((float)i, (float)iteration, 0.0f);
+					matrices[i] = transform.modelMatrix();
+				}
+			});
+			bench::doNotOptimize(matrices);
+		});
+		bench::run("parallelFor 64 createSphere/32/threads=" + std::to_string(threads), [&](int) {
+			jobs.parallelFor(SPHERE_COUNT, 1, [&](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					spheres[i] = ew::createSphere(1.0f, 32);
+				}
+			});
+			bench::doNotOptimize(spheres);
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* output = "core_bench.json";
+	bench::Settings& settings = bench::settings();
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--filter") == 0) settings.filter = argv[i + 1];
+		else if (strcmp(argv[i], "--repetitions") == 0) settings.repetitions = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--warmup") == 0) settings.warmupIterations = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--out") == 0) output = argv[i + 1];
+		else {
+			printf("Usage: core_bench [--filter name] [--repetitions N] [--warmup N] [--out file]\n");
+			return 1;
+		}
+	}
+	if (settings.repetitions < 1)
+		settings.repetitions = 1;
+
+	if (!createHeadlessContext())
+		return 1;
+	printf("core_bench on %s (%s), %d repetitions\n\n", (const char*)glGetString(GL_RENDERER), headlessContextApi(), settings.repetitions);
+
+	procGenCases();
+	procGenTargetCases();
+	transformCases();
+	assetCases();
+	shaderCacheCases();
+	modelCases();
+	geometryPoolCases();
+	dynamicMeshCases();
+	pointCloudCases();
+	jobSystemCases();
+
+	bench::printResults();
+	bench::writeJson(output);
+	destroyHeadlessContext();
+	return 0;
+}
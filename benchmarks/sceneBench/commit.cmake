@@ -0,0 +1,8 @@
+#Run at build time by the sceneBenchCommit target, so the stamp follows HEAD without reconfiguring.
+#configure_file only rewrites the header when the hash changed, so unchanged commits don't rebuild main.cpp
+execute_process(COMMAND git rev-parse --short HEAD
+ WORKING_DIRECTORY ${SOURCE_DIR}
+ OUTPUT_VARIABLE SCENE_BENCH_COMMIT
+ OUTPUT_STRIP_TRAILING_WHITESPACE
+ ERROR_QUIET)
+configure_file(${CMAKE_CURRENT_LIST_DIR}/sceneBenchCommit.h.in ${OUTPUT} @ONLY)
@@ -0,0 +1,944 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ew/external/glad.h>
+
+#include <ew/shader.h>
+#include <ew/model.h>
+#include <ew/camera.h>
+#include <ew/transform.h>
+#include <ew/texture.h>
+#include <ew/procGen.h>
+
+#include <joey/shadow.h>
+#include <joey/pointShadowAtlas.h>
+#include <joey/renderGraph.h>
+#include <joey/gpuProfiler.h>
+#include <joey/cpuProfiler.h>
+#include <joey/renderStats.h>
+#include <joey/renderThread.h>
+#include <joey/streamBuffer.h>
+#include <joey/geometryPool.h>
+#include <joey/renderQueue.h>
+#include <joey/materialTextures.h>
+#include <joey/shaderCache.h>
+#include <joey/shaderVariants.h>
+#include <joey/proceduralPrimitive.h>
+#include <joey/staticBatch.h>
+#include <joey/terrain.h>
+#include <joey/jsonString.h>
+
+#include <headlessContext.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "sceneBenchCommit.h"
+
+// Usage (from bin/, like the assignments):
+//   sceneBench [options], every option takes a value, defaults in Options below
+//   --scene assignment3|assignment5   Scene to render
+//   --frames N, --warmup N            Measured frames, and frames rendered before measuring
+//   --width W, --height H             Render target size
+//   --path FILE                       Camera path, assets/bench/cameraPath.txt
+//   --render-thread off|async|sync    Submit GL from a render thread, see below
+//   --state-cache on|off              Skip redundant binds and uniform uploads
+//   --shader-cache DIR|off            Program binary cache directory
+//   --depth-prepass on|off            Depth pre-pass before the G-buffer
+//   --position-stream on|off          Depth passes read packed positions
+//   --static-batch on|off             assignment3 floor tiles as merged chunks
+//   --terrain on|off                  assignment3 hills around the scene
+//   --out FILE                        Results JSON, sceneBench.json
+// Frames advance a fixed 1/60 s regardless of how long they take, so every run renders the same images.
+// With a render thread, the main thread simulates frame N+1 while the render thread submits frame N;
+// sync renders each frame before the next one is simulated.
+// Run twice with the same --shader-cache to compare a cold start with a warm one
+
+struct Options {
+	std::string scene = "assignment3";
+	int frames = 600;
+	int warmup = 60;
+	int width = 1920;
+	int height = 1080;
+	std::string cameraPath = "assets/bench/cameraPath.txt";
+	std::string renderThread = "off";
+	std::string stateCache = "on";
+	std::string shaderCache = "shaderCache";
+	std::string depthPrepass = "on";
+	std::string positionStream = "on";
+	std::string staticBatch = "on";
+	std::string terrain = "off";
+	std::string output = "sceneBench.json";
+};
+
+struct CameraKey {
+	float time;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+struct PointLight {
+	glm::vec3 position;
+	float radius;
+	glm::vec4 color;
+};
+const int MAX_POINT_LIGHTS = 64;
+const int ORB_SUBDIVISIONS = 8;
+const int GRID_SIZE = 8;
+const int MONKEY_DRAWS = GRID_SIZE * GRID_SIZE;
+const float FRAME_DT = 1.0f / 60.0f;
+
+// Everything the assignment frames are built from, with the assignments' default settings
+struct Scene {
+	joey::ShaderVariants* deferredShaders; //Only the manual 3x3 filter with point shadows is used
+	ew::Shader* geometryShader;
+	ew::Shader* postProcessShader;
+	ew::Shader* shadowShader;
+	ew::Shader* lightOrbShader;
+	joey::ShaderCache* shaderCache;
+	joey::GeometryPool* geometryPool; //With a position stream when depth passes use it
+	ew::Model* monkeyModel;
+	int planeMesh;
+	joey::StaticBatch* floorBatch; //assignment3's floor tiles, drawn instead of planeMesh when batched
+	bool staticBatch;
+	joey::Terrain* terrain; //assignment3's hills, nullptr unless --terrain on
+	ew::Shader* terrainShader;
+	ew::Shader* terrainDepthShader;
+	int terrainPeakPatches;
+	joey::DrawList* casterList; //Draw indices as written by writeCasterDraws
+	joey::RenderQueue* renderQueue; //G-buffer draws
+	int gBufferState;
+	joey::MaterialTextures* materialTextures;
+	int floorMaterial;
+	int monkeyMaterial;
+	unsigned int shadowCompareSampler;
+	unsigned int dummyVAO;
+	joey::PointShadowAtlas* pointShadowAtlas;
+	joey::StreamBuffer* drawStream;
+	ew::Camera lightCamera;
+};
+
+// What simulation hands to rendering each frame. Copied into the frame's render command,
+// so the main thread can move on to the next frame while this one renders
+struct SceneState {
+	ew::Camera camera;
+	PointLight pointLights[MAX_POINT_LIGHTS] = {};
+	//assignment5 arm, torso -> shoulder -> arm -> hand
+	ew::Transform bones[4];
+	glm::mat4 boneMatrices[4];
+	//assignment3 grid
+	glm::mat4 monkeyMatrices[GRID_SIZE * GRID_SIZE];
+	glm::mat4 planeMatrices[GRID_SIZE * GRID_SIZE];
+};
+
+static bool parseOptions(int argc, char** argv, Options* options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value) {
+			printf("Missing value for %s\n", arg);
+			return false;
+		}
+		if (strcmp(arg, "--scene") == 0) options->scene = value;
+		else if (strcmp(arg, "--frames") == 0) options->frames = atoi(value);
+		else if (strcmp(arg, "--warmup") == 0) options->warmup = atoi(value);
+		else if (strcmp(arg, "--width") == 0) options->width = atoi(value);
+		else if (strcmp(arg, "--height") == 0) options->height = atoi(value);
+		else if (strcmp(arg, "--path") == 0) options->cameraPath = value;
+		else if (strcmp(arg, "--render-thread") == 0) options->renderThread = value;
+		else if (strcmp(arg, "--state-cache") == 0) options->stateCache = value;
+		else if (strcmp(arg, "--shader-cache") == 0) options->shaderCache = value;
+		else if (strcmp(arg, "--depth-prepass") == 0) options->depthPrepass = value;
+		else if (strcmp(arg, "--position-stream") == 0) options->positionStream = value;
+		else if (strcmp(arg, "--static-batch") == 0) options->staticBatch = value;
+		else if (strcmp(arg, "--terrain") == 0) options->terrain = value;
+		else if (strcmp(arg, "--out") == 0) options->output = value;
+		else {
+			printf("Unknown option %s\n", arg);
+			return false;
+		}
+		i++;
+	}
+	if (options->scene != "assignment3" && options->scene != "assignment5") {
+		printf("Unknown scene %s\n", options->scene.c_str());
+		return false;
+	}
+	if (options->renderThread != "off" && options->renderThread != "async" && options->renderThread != "sync") {
+		printf("Unknown render thread mode %s\n", options->renderThread.c_str());
+		return false;
+	}
+	if (options->stateCache != "on" && options->stateCache != "off") {
+		printf("Unknown state cache mode %s\n", options->stateCache.c_str());
+		return false;
+	}
+	if (options->depthPrepass != "on" && options->depthPrepass != "off") {
+		printf("Unknown depth pre-pass mode %s\n", options->depthPrepass.c_str());
+		return false;
+	}
+	if (options->positionStream != "on" && options->positionStream != "off") {
+		printf("Unknown position stream mode %s\n", options->positionStream.c_str());
+		return false;
+	}
+	if (options->staticBatch != "on" && options->staticBatch != "off") {
+		printf("Unknown static batch mode %s\n", options->staticBatch.c_str());
+		return false;
+	}
+	if (options->terrain != "on" && options->terrain != "off") {
+		printf("Unknown terrain mode %s\n", options->terrain.c_str());
+		return false;
+	}
+	return options->frames > 0 && options->width > 0 && options->height > 0;
+}
+
+static std::vector<CameraKey> loadCameraPath(const std::string& filePath)
+{
+	std::vector<CameraKey> keys;
+	std::ifstream file(filePath);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream stream(line);
+		CameraKey key;
+		if (stream >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z)
+			keys.push_back(key);
+	}
+	if (keys.empty()) {
+		printf("No camera path in %s, using a fixed camera\n", filePath.c_str());
+		CameraKey key = { 0.0f, glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f) };
+		keys.push_back(key);
+	}
+	return keys;
+}
+
+static void sampleCameraPath(const std::vector<CameraKey>& keys, float time, ew::Camera* camera)
+{
+	float duration = keys.back().time;
+	if (duration > 0.0f)
+		time = fmodf(time, duration);
+	size_t next = 0;
+	while (next < keys.size() - 1 && keys[next].time < time)
+	{
+		next++;
+	}
+	const CameraKey& b = keys[next];
+	const CameraKey& a = keys[next > 0 ? next - 1 : 0];
+	float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0f;
+	camera->position = glm::mix(a.position, b.position, t);
+	camera->target = glm::mix(a.target, b.target, t);
+}
+
+// Per draw data of each scene's shadow casters. assignment3 draws monkey i as i and the floor after them,
+// chunk c as MONKEY_DRAWS + c or unbatched tile i as MONKEY_DRAWS + i. assignment5 its bones as 0-3 and the floor as 4
+static int writeCasterDraws(Scene& scene, const SceneState& state, const std::string& sceneName, size_t* offset)
+{
+	if (sceneName == "assignment3") {
+		int count = MONKEY_DRAWS + (scene.staticBatch ? scene.floorBatch->getChunkCount() : GRID_SIZE * GRID_SIZE);
+		joey::GPUDrawData* draws = scene.drawStream->allocate<joey::GPUDrawData>(count, offset);
+		for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+		{
+			draws[i] = { state.monkeyMatrices[i], glm::vec4(1), scene.monkeyMaterial };
+			if (!scene.staticBatch)
+				draws[MONKEY_DRAWS + i] = { state.planeMatrices[i], glm::vec4(1), scene.floorMaterial };
+		}
+		if (scene.staticBatch)
+			scene.floorBatch->writeDrawData(draws + MONKEY_DRAWS);
+		return count;
+	}
+	joey::GPUDrawData* draws = scene.drawStream->allocate<joey::GPUDrawData>(5, offset);
+	for (int i = 0; i < 4; i++)
+	{
+		draws[i] = { state.boneMatrices[i], glm::vec4(1), scene.monkeyMaterial };
+	}
+	ew::Transform planeTransform;
+	planeTransform.position = glm::vec3(0, -1, 0);
+	draws[4] = { planeTransform.modelMatrix(), glm::vec4(1), scene.floorMaterial };
+	return 5;
+}
+
+const int QUEUE_PASS_GBUFFER = 0;
+
+// G-buffer draws with the same indices as writeCasterDraws, sorted by material then front to back
+static void queueCasters(Scene& scene, const SceneState& state, const std::string& sceneName)
+{
+	const ew::Camera& camera = state.camera;
+	glm::vec3 forward = glm::normalize(camera.target - camera.position);
+	auto queueAt = [&](int mesh, int material, const glm::vec3& position, int draw) {
+		float depth = (glm::dot(position - camera.position, forward) - camera.nearPlane) / (camera.farPlane - camera.nearPlane);
+		scene.renderQueue->submit(joey::RenderQueue::makeKey(QUEUE_PASS_GBUFFER, scene.gBufferState, material, mesh, depth), mesh, draw);
+	};
+	auto queue = [&](int mesh, int material, const glm::mat4& model, int draw) {
+		queueAt(mesh, material, glm::vec3(model[3]), draw);
+	};
+	scene.renderQueue->clear();
+	if (sceneName == "assignment3") {
+		for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+		{
+			for (int mesh : scene.monkeyModel->getPoolMeshes())
+			{
+				queue(mesh, scene.monkeyMaterial, state.monkeyMatrices[i], i);
+			}
+			if (!scene.staticBatch)
+				queue(scene.planeMesh, scene.floorMaterial, state.planeMatrices[i], MONKEY_DRAWS + i);
+		}
+		if (scene.staticBatch) {
+			std::vector<int> visibleChunks;
+			scene.floorBatch->cull(joey::Frustum::fromMatrix(camera.projectionMatrix() * camera.viewMatrix()), visibleChunks);
+			for (int c : visibleChunks)
+			{
+				const joey::StaticChunk& chunk = scene.floorBatch->getChunks()[c];
+				queueAt(chunk.mesh, chunk.material, (chunk.boundsMin + chunk.boundsMax) * 0.5f, MONKEY_DRAWS + c);
+			}
+		}
+	}
+	else {
+		for (int i = 0; i < 4; i++)
+		{
+			for (int mesh : scene.monkeyModel->getPoolMeshes())
+			{
+				queue(mesh, scene.monkeyMaterial, state.boneMatrices[i], i);
+			}
+		}
+		queue(scene.planeMesh, scene.floorMaterial, glm::translate(glm::mat4(1.0f), glm::vec3(0, -1, 0)), 4);
+	}
+	scene.renderQueue->sort();
+}
+
+// Geometry of each scene, drawn with whichever shader is bound
+static void drawCasters(Scene& scene, size_t drawOffset, int drawCount)
+{
+	scene.drawStream->bindRange(GL_SHADER_STORAGE_BUFFER, joey::StreamBuffer::DRAW_DATA_BINDING, drawOffset, sizeof(joey::GPUDrawData) * drawCount);
+	//Only depth passes draw the caster list, positions are all they read
+	scene.casterList->submitPositions(*scene.geometryPool);
+}
+
+static void setupScene(Scene& scene, SceneState& state, const std::string& sceneName, const std::string& shaderCacheDirectory, bool positionStream, bool staticBatch, bool terrain)
+{
+	//Programs build while the geometry and textures below load
+	scene.shaderCache = new joey::ShaderCache(shaderCacheDirectory);
+	scene.deferredShaders = new joey::ShaderVariants("assets/postprocess.vert", "assets/deferredLit.frag", scene.shaderCache);
+	scene.deferredShaders->setDefine("MAX_POINT_LIGHTS", MAX_POINT_LIGHTS);
+	scene.deferredShaders->prepare({ joey::shadowFilterDefine(joey::ShadowFilter::MANUAL_3X3), { "POINT_SHADOWS", 1 } });
+	scene.geometryShader = new ew::Shader("assets/lit.vert", "assets/geometryPass.frag", scene.shaderCache);
+	scene.postProcessShader = new ew::Shader("assets/postprocess.vert", "assets/postprocess.frag", scene.shaderCache);
+	scene.shadowShader = new ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag", scene.shaderCache);
+	scene.lightOrbShader = new ew::Shader("assets/lightOrb.vert", "assets/lightOrb.frag", scene.shaderCache);
+	scene.terrainShader = new ew::Shader("assets/terrain.vert", "assets/geometryPass.frag", scene.shaderCache);
+	scene.terrainDepthShader = new ew::Shader("assets/terrain.vert", "assets/depthOnly.frag", scene.shaderCache);
+	scene.geometryPool = new joey::GeometryPool(64 * 1024, 128 * 1024, positionStream);
+	scene.monkeyModel = new ew::Model("assets/suzanne.obj", nullptr, scene.geometryPool);
+	ew::MeshData planeData = ew::createPlane(10, 10, 5);
+	scene.planeMesh = scene.geometryPool->add(planeData);
+	scene.materialTextures = new joey::MaterialTextures(2048, 2048);
+	std::vector<int> materials = scene.materialTextures->load({ "assets/Floor_Color.jpg", "assets/Monkey_Color.jpg" });
+	scene.floorMaterial = materials[0];
+	scene.monkeyMaterial = materials[1];
+	//Same 20 unit chunks as assignment3, only its scene has enough tiles to batch
+	scene.floorBatch = new joey::StaticBatch(20.0f);
+	scene.staticBatch = staticBatch && sceneName == "assignment3";
+	scene.casterList = new joey::DrawList();
+	scene.terrain = nullptr;
+	scene.terrainPeakPatches = 0;
+	if (terrain && sceneName == "assignment3") {
+		//Same hills as assignment3, flattened under the floor tiles
+		joey::TerrainSettings terrainSettings;
+		terrainSettings.center = glm::vec3(17.5f, -1.5f, 17.5f);
+		terrainSettings.size = 1024.0f;
+		terrainSettings.heightScale = 120.0f;
+		const int HEIGHTMAP_SIZE = 1024;
+		std::vector<float> heights = joey::Terrain::generateHeightmap(HEIGHTMAP_SIZE, 7);
+		for (int z = 0; z < HEIGHTMAP_SIZE; z++)
+		{
+			for (int x = 0; x < HEIGHTMAP_SIZE; x++)
+			{
+				glm::vec2 offset = (glm::vec2(x, z) / (float)(HEIGHTMAP_SIZE - 1) - 0.5f) * terrainSettings.size;
+				heights[z * HEIGHTMAP_SIZE + x] *= glm::smoothstep(40.0f, 160.0f, glm::length(offset));
+			}
+		}
+		scene.terrain = new joey::Terrain(terrainSettings, heights.data(), HEIGHTMAP_SIZE);
+	}
+	if (sceneName == "assignment3") {
+		for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+		{
+			scene.monkeyModel->addDraws(*scene.casterList, i);
+		}
+		if (scene.staticBatch) {
+			for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+			{
+				ew::Transform plane;
+				plane.position = glm::vec3(i / GRID_SIZE * 5, -1, i % GRID_SIZE * 5);
+				scene.floorBatch->add(planeData, plane.modelMatrix(), scene.floorMaterial);
+			}
+			scene.floorBatch->build(*scene.geometryPool);
+			scene.floorBatch->addDraws(*scene.casterList, MONKEY_DRAWS);
+		}
+		else {
+			for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+			{
+				scene.casterList->add(scene.planeMesh, MONKEY_DRAWS + i);
+			}
+		}
+	}
+	else {
+		for (int i = 0; i < 4; i++)
+		{
+			scene.monkeyModel->addDraws(*scene.casterList, i);
+		}
+		scene.casterList->add(scene.planeMesh, 4);
+	}
+	scene.renderQueue = new joey::RenderQueue();
+	joey::RenderState gBufferState;
+	gBufferState.shader = scene.geometryShader;
+	gBufferState.textures[1] = scene.materialTextures->getTexture();
+	scene.gBufferState = scene.renderQueue->addState(gBufferState);
+	scene.shadowCompareSampler = joey::createShadowCompareSampler();
+	glCreateVertexArrays(1, &scene.dummyVAO);
+	scene.pointShadowAtlas = new joey::PointShadowAtlas(MAX_POINT_LIGHTS, 256, MAX_POINT_LIGHTS * 3, scene.shaderCache);
+	scene.drawStream = new joey::StreamBuffer(64 * 1024);
+	scene.shaderCache->finish();
+
+	scene.lightCamera.target = glm::vec3(17.5f, 0.0f, 17.5f);
+	scene.lightCamera.position = scene.lightCamera.target - glm::vec3(0.0f, -1.0f, 0.0f) * 10.0f;
+	scene.lightCamera.orthographic = true;
+	scene.lightCamera.orthoHeight = 40.0f;
+	scene.lightCamera.nearPlane = 0.001f;
+	scene.lightCamera.farPlane = 50.0f;
+	scene.lightCamera.aspectRatio = 1;
+
+	//Same rand() sequence as the assignments, which never seed it
+	int index = 0;
+	if (sceneName == "assignment3") {
+		for (int x = 0; x < 8; x++)
+		{
+			for (int y = 0; y < 8; y++)
+			{
+				state.pointLights[index].position = glm::vec3((x * 5) + 1, -0.5, (y * 5) + 1);
+				state.pointLights[index].radius = 5.0;
+				state.pointLights[index].color = glm::vec4(rand() % 2, rand() % 2, rand() % 2, 1);
+				index++;
+			}
+		}
+	}
+	else {
+		for (int x = -1; x < 1; x++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				state.pointLights[index].position = glm::vec3((x * 4) + 1, -0.5, (y * 4) + 1);
+				state.pointLights[index].radius = 5.0;
+				state.pointLights[index].color = glm::vec4(rand() % 2, rand() % 2, rand() % 2, 1);
+				index++;
+			}
+		}
+		state.bones[1].position = glm::vec3(1, 0, 0);
+		state.bones[1].scale = glm::vec3(0.2, 0.2, 0.2);
+		state.bones[2].position = glm::vec3(0, -2, 0);
+		state.bones[3].position = glm::vec3(0, -2.5, 0);
+		state.bones[3].scale = glm::vec3(0.5, 0.5, 0.5);
+	}
+
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+}
+
+static void animateScene(SceneState& state, const std::string& sceneName)
+{
+	if (sceneName == "assignment3") {
+		for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+		{
+			ew::Transform monkey, plane;
+			int x = i / GRID_SIZE, y = i % GRID_SIZE;
+			plane.position = glm::vec3(x * 5, -1, y * 5);
+			monkey.position = glm::vec3(x * 5, 0, y * 5);
+			state.monkeyMatrices[i] = monkey.modelMatrix();
+			state.planeMatrices[i] = plane.modelMatrix();
+		}
+		return;
+	}
+	//Same axes as assignment5's arm, advanced by the fixed step
+	const glm::vec3 axes[4] = { glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(1, 0, 0) };
+	for (int i = 0; i < 4; i++)
+	{
+		state.bones[i].rotation = glm::rotate(state.bones[i].rotation, FRAME_DT, axes[i]);
+		glm::mat4 local = state.bones[i].modelMatrix();
+		state.boneMatrices[i] = i == 0 ? local : state.boneMatrices[i - 1] * local;
+	}
+}
+
+// Same passes as the assignments' render loops, ending in an offscreen target instead of the backbuffer
+static void buildFrame(joey::RenderGraph& frameGraph, Scene& scene, const SceneState& state, const std::string& sceneName, int width, int height, bool depthPrepass)
+{
+	const ew::Camera& camera = state.camera;
+	size_t casterDrawOffset = 0;
+	int casterDrawCount = writeCasterDraws(scene, state, sceneName, &casterDrawOffset);
+	queueCasters(scene, state, sceneName);
+	if (scene.terrain) {
+		scene.terrain->select(camera, (float)height);
+		scene.terrain->upload(*scene.drawStream);
+		scene.terrainPeakPatches = std::max(scene.terrainPeakPatches, scene.terrain->getStats().patches);
+	}
+	glm::mat4 lightMatrix = scene.lightCamera.projectionMatrix() * scene.lightCamera.viewMatrix();
+	glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+
+	frameGraph.reset();
+	joey::RGHandle output = frameGraph.createTexture("Final", width, height, GL_RGBA8);
+	joey::RGHandle shadowMap = frameGraph.createTexture("Shadow Map", 2048, 2048, GL_DEPTH_COMPONENT16, GL_NEAREST);
+	joey::RGHandle gPosition = frameGraph.createTexture("GBuffer Position", width, height, GL_RGB32F, GL_NEAREST);
+	joey::RGHandle gNormal = frameGraph.createTexture("GBuffer Normal", width, height, GL_RGB16F, GL_NEAREST);
+	joey::RGHandle gAlbedo = frameGraph.createTexture("GBuffer Albedo", width, height, GL_RGB16F, GL_NEAREST);
+	joey::RGHandle gDepth = frameGraph.createTexture("GBuffer Depth", width, height, GL_DEPTH_COMPONENT16, GL_NEAREST);
+	joey::RGHandle hdr = frameGraph.createTexture("HDR", width, height, GL_RGBA16);
+
+	joey::RGPass& shadowPass = frameGraph.addPass("Shadow", [&](joey::RenderGraph& graph) {
+		unsigned int shadowTexture = graph.getTexture(shadowMap);
+		float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTextureParameteri(shadowTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(shadowTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTextureParameterfv(shadowTexture, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glCullFace(GL_FRONT);
+		scene.shadowShader->use();
+		scene.shadowShader->setMat4("_ViewProjection", lightMatrix);
+		drawCasters(scene, casterDrawOffset, casterDrawCount);
+	});
+	shadowMap = shadowPass.writeDepth(shadowMap, true);
+
+	joey::RGHandle atlas = frameGraph.importTexture("Point Shadow Atlas", scene.pointShadowAtlas->getTexture(), scene.pointShadowAtlas->getFaceSize(), scene.pointShadowAtlas->getFaceSize());
+	joey::RGPass& atlasPass = frameGraph.addPass("Point Shadow Atlas", [&](joey::RenderGraph& graph) {
+		joey::PointShadowLight shadowLights[MAX_POINT_LIGHTS];
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			shadowLights[i].position = state.pointLights[i].position;
+			shadowLights[i].radius = state.pointLights[i].radius;
+			shadowLights[i].importance = glm::dot(glm::vec3(state.pointLights[i].color), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+		}
+		if (sceneName == "assignment5")
+			scene.pointShadowAtlas->invalidate();
+		scene.pointShadowAtlas->update(shadowLights, MAX_POINT_LIGHTS, camera, 24);
+		scene.pointShadowAtlas->render([&](const ew::Shader& shader) {
+			drawCasters(scene, casterDrawOffset, casterDrawCount);
+		});
+	});
+	atlas = atlasPass.write(atlas);
+
+	if (depthPrepass) {
+		joey::RGPass& prepass = frameGraph.addPass("Depth Pre-pass", [&](joey::RenderGraph& graph) {
+			glCullFace(GL_BACK);
+			scene.shadowShader->use();
+			scene.shadowShader->setMat4("_ViewProjection", viewProjection);
+			drawCasters(scene, casterDrawOffset, casterDrawCount);
+			if (scene.terrain) {
+				scene.terrainDepthShader->use();
+				scene.terrainDepthShader->setMat4("_ViewProjection", viewProjection);
+				scene.terrain->draw(*scene.terrainDepthShader, 6);
+			}
+		});
+		gDepth = prepass.writeDepth(gDepth, true);
+	}
+
+	joey::RGPass& gBufferPass = frameGraph.addPass("GBuffer", [&](joey::RenderGraph& graph) {
+		if (depthPrepass) {
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		glCullFace(GL_BACK);
+		scene.geometryShader->use();
+		scene.geometryShader->setMat4("_ViewProjection", viewProjection);
+		scene.geometryShader->setInt("_MaterialTextures", 1);
+		scene.drawStream->bindRange(GL_SHADER_STORAGE_BUFFER, joey::StreamBuffer::DRAW_DATA_BINDING, casterDrawOffset, sizeof(joey::GPUDrawData) * casterDrawCount);
+		scene.renderQueue->execute(QUEUE_PASS_GBUFFER, *scene.geometryPool, *scene.drawStream);
+		if (scene.terrain) {
+			scene.terrainShader->use();
+			scene.terrainShader->setMat4("_ViewProjection", viewProjection);
+			scene.terrainShader->setInt("_MaterialTextures", 1);
+			scene.terrainShader->setInt("_TerrainMaterial", scene.floorMaterial);
+			joey::bindTextureUnit(1, scene.materialTextures->getTexture());
+			scene.terrain->draw(*scene.terrainShader, 6);
+		}
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_TRUE);
+	});
+	gPosition = gBufferPass.writeColor(gPosition, true, glm::vec4(0, 0, 0, 1));
+	gNormal = gBufferPass.writeColor(gNormal, true, glm::vec4(0, 0, 0, 1));
+	gAlbedo = gBufferPass.writeColor(gAlbedo, true, glm::vec4(0, 0, 0, 1));
+	gDepth = gBufferPass.writeDepth(gDepth, !depthPrepass);
+
+	joey::RGPass& lightingPass = frameGraph.addPass("Deferred Lighting", [&](joey::RenderGraph& graph) {
+		const ew::Shader& shader = scene.deferredShaders->get({ joey::shadowFilterDefine(joey::ShadowFilter::MANUAL_3X3), { "POINT_SHADOWS", 1 } });
+		shader.use();
+		joey::bindTextureUnit(0, graph.getTexture(gPosition));
+		joey::bindTextureUnit(1, graph.getTexture(gNormal));
+		joey::bindTextureUnit(2, graph.getTexture(gAlbedo));
+		joey::bindShadowMap(graph.getTexture(shadowMap), scene.shadowCompareSampler, 3, 4);
+		joey::setShadowUniforms(shader, 3, 4);
+		scene.pointShadowAtlas->bind(5);
+		shader.setInt("_PointShadowAtlas", 5);
+		shader.setFloat("_PointShadowBias", 0.02f);
+		shader.setMat4("_LightViewProjection", lightMatrix);
+		shader.setVec3("_LightDirection", glm::vec3(0.0, -1.0, 0.0));
+		shader.setVec3("_LightColor", glm::vec3(1));
+		shader.setFloat("_MinBias", 0.007f);
+		shader.setFloat("_MaxBias", 0.2f);
+		shader.setFloat("_Material.AmbientCo", 1.0f);
+		shader.setFloat("_Material.DiffuseCo", 0.5f);
+		shader.setFloat("_Material.SpecualarCo", 0.5f);
+		shader.setFloat("_Material.Shininess", 128.0f);
+		shader.setVec3("_EyePos", camera.position);
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+			std::string prefix = "_PointLights[" + std::to_string(i) + "].";
+			shader.setVec3(prefix + "position", state.pointLights[i].position);
+			shader.setFloat(prefix + "radius", state.pointLights[i].radius);
+			shader.setVec4(prefix + "color", state.pointLights[i].color);
+		}
+		joey::bindVertexArray(scene.dummyVAO);
+		joey::drawArrays(GL_TRIANGLES, 0, 6);
+	});
+	lightingPass.read(gPosition);
+	lightingPass.read(gNormal);
+	lightingPass.read(gAlbedo);
+	lightingPass.read(shadowMap);
+	lightingPass.read(atlas);
+	hdr = lightingPass.writeColor(hdr, true, glm::vec4(0, 0, 0, 1));
+
+	joey::RGPass& orbPass = frameGraph.addPass("Light Orbs", [&](joey::RenderGraph& graph) {
+		scene.lightOrbShader->use();
+		scene.lightOrbShader->setMat4("_ViewProjection", viewProjection);
+		scene.lightOrbShader->setInt("_Subdivisions", ORB_SUBDIVISIONS);
+		size_t orbDrawOffset = 0;
+		joey::GPUDrawData* orbDraws = scene.drawStream->allocate<joey::GPUDrawData>(MAX_POINT_LIGHTS, &orbDrawOffset);
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			glm::mat4 m = glm::mat4(1.0f);
+			m = glm::translate(m, state.pointLights[i].position);
+			m = glm::scale(m, glm::vec3(0.2f));
+			orbDraws[i] = { m, state.pointLights[i].color, 0 };
+		}
+		scene.drawStream->bindRange(GL_SHADER_STORAGE_BUFFER, joey::StreamBuffer::DRAW_DATA_BINDING, orbDrawOffset, sizeof(joey::GPUDrawData) * MAX_POINT_LIGHTS);
+		joey::drawProcedural(joey::ProceduralShape::SPHERE, ORB_SUBDIVISIONS, MAX_POINT_LIGHTS);
+	});
+	hdr = orbPass.writeColor(hdr);
+	gDepth = orbPass.writeDepth(gDepth);
+
+	joey::RGPass& postPass = frameGraph.addPass("Post Process", [&](joey::RenderGraph& graph) {
+		scene.postProcessShader->use();
+		scene.postProcessShader->setFloat("_Exposure", 1.0f);
+		scene.postProcessShader->setFloat("_Contrast", 1.0f);
+		scene.postProcessShader->setFloat("_Brightness", 0.0f);
+		joey::bindTextureUnit(0, graph.getTexture(hdr));
+		joey::bindVertexArray(scene.dummyVAO);
+		joey::drawArrays(GL_TRIANGLES, 0, 6);
+	});
+	postPass.read(hdr);
+	output = postPass.writeColor(output, true, glm::vec4(0, 0, 0, 1));
+	frameGraph.markOutput(output);
+
+	frameGraph.execute();
+}
+
+struct Percentiles {
+	float mean, p50, p90, p99, max;
+};
+
+static Percentiles computePercentiles(std::vector<float> samples)
+{
+	Percentiles result = {};
+	if (samples.empty())
+		return result;
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (float sample : samples)
+	{
+		total += sample;
+	}
+	//Nearest rank
+	auto rank = [&](float p) { return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))]; };
+	result.mean = (float)(total / samples.size());
+	result.p50 = rank(0.5f);
+	result.p90 = rank(0.9f);
+	result.p99 = rank(0.99f);
+	result.max = samples.back();
+	return result;
+}
+
+// Counters divided by frames, passes come from the last frame so are written unscaled
+static void writeRenderCounters(FILE* file, const char* name, const joey::RenderCounters& c, int frames)
+{
+	double n = std::max(frames, 1);
+	fprintf(file, "\t%s: { \"drawCalls\": %.1f, \"indirectCommands\": %.1f, \"skippedStateChanges\": %.1f, \"triangles\": %.1f, \"programBinds\": %.1f, \"redundantProgramBinds\": %.1f, "
+		"\"textureBinds\": %.1f, \"redundantTextureBinds\": %.1f, \"vertexArrayBinds\": %.1f, \"redundantVertexArrayBinds\": %.1f, "
+		"\"framebufferBinds\": %.1f, \"uniformUploads\": %.1f, \"redundantUniformUploads\": %.1f }",
+		joey::jsonString(name).c_str(), c.drawCalls / n, c.indirectCommands / n, c.skippedStateChanges / n, c.triangles / n, c.programBinds / n, c.redundantProgramBinds / n,
+		c.textureBinds / n, c.redundantTextureBinds / n, c.vertexArrayBinds / n, c.redundantVertexArrayBinds / n,
+		c.framebufferBinds / n, c.uniformUploads / n, c.redundantUniformUploads / n);
+}
+
+static void writePercentiles(FILE* file, const char* name, const Percentiles& p, bool last = false)
+{
+	fprintf(file, "\t\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+		name, p.mean, p.p50, p.p90, p.p99, p.max, last ? "" : ",");
+}
+
+static size_t peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	//Kilobytes on Linux
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!parseOptions(argc, argv, &options)) {
+		printf("Usage: sceneBench [--scene assignment3|assignment5] [--frames N] [--warmup N] [--width W] [--height H] [--path file] [--render-thread off|async|sync] [--state-cache on|off] [--shader-cache dir|off] [--depth-prepass on|off] [--position-stream on|off] [--static-batch on|off] [--terrain on|off] [--out file]\n");
+		return 1;
+	}
+	if (!createHeadlessContext())
+		return 1;
+	printf("sceneBench: %s, %d frames at %dx%d on %s (%s)\n", options.scene.c_str(), options.frames,
+		options.width, options.height, (const char*)glGetString(GL_RENDERER), headlessContextApi());
+
+	std::vector<CameraKey> cameraPath = loadCameraPath(options.cameraPath);
+	SceneState state;
+	state.camera.aspectRatio = (float)options.width / options.height;
+	state.camera.fov = 60.0f;
+
+	Scene scene;
+	auto setupStart = std::chrono::steady_clock::now();
+	setupScene(scene, state, options.scene, options.shaderCache == "off" ? "" : options.shaderCache, options.positionStream == "on", options.staticBatch == "on",
+		options.terrain == "on");
+	float setupMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+	joey::setStateCacheEnabled(options.stateCache == "on");
+
+	//Deleted by hand, they free GL objects and must go before the context
+	joey::RenderTargetPool* renderTargets = new joey::RenderTargetPool();
+	joey::GpuProfiler* gpuProfiler = new joey::GpuProfiler();
+	std::vector<float> cpuFrameMs;
+	std::vector<float> gpuFrameMs;
+	std::vector<float> renderFrameMs;
+	std::vector<float> submitStallMs;
+	size_t peakTargetBytes = 0;
+	//Summed over measured frames, written as per frame means
+	joey::RenderCounters renderCounters;
+
+	//GPU frame time from timestamps, these don't clash with the profiler's elapsed queries.
+	//Read a few frames later like the profiler so the CPU never waits on the frame it just submitted
+	const int QUERY_LATENCY = joey::GpuProfiler::FRAME_LATENCY;
+	unsigned int timestamps[QUERY_LATENCY][2];
+	glGenQueries(QUERY_LATENCY * 2, &timestamps[0][0]);
+
+	{
+		joey::RenderGraph frameGraph(renderTargets);
+		frameGraph.setProfiler(gpuProfiler);
+
+		int totalFrames = options.warmup + options.frames;
+		//GL side of a frame, runs on the render thread when there is one
+		auto renderFrame = [&](const SceneState& frameState, int frame) {
+			bool measured = frame >= options.warmup;
+			int slot = frame % QUERY_LATENCY;
+			if (frame >= QUERY_LATENCY && frame - QUERY_LATENCY >= options.warmup) {
+				GLuint64 start = 0, end = 0;
+				glGetQueryObjectui64v(timestamps[slot][0], GL_QUERY_RESULT, &start);
+				glGetQueryObjectui64v(timestamps[slot][1], GL_QUERY_RESULT, &end);
+				gpuFrameMs.push_back((float)((end - start) / 1000000.0));
+			}
+			if (frame == options.warmup)
+				gpuProfiler->clear();
+
+			auto renderStart = std::chrono::steady_clock::now();
+			gpuProfiler->beginFrame();
+			joey::renderStatsBeginFrame();
+			if (frame > options.warmup)
+				renderCounters.add(joey::getFrameRenderCounters());
+			glQueryCounter(timestamps[slot][0], GL_TIMESTAMP);
+
+			scene.drawStream->beginFrame();
+			buildFrame(frameGraph, scene, frameState, options.scene, options.width, options.height, options.depthPrepass == "on");
+			scene.drawStream->endFrame();
+
+			glQueryCounter(timestamps[slot][1], GL_TIMESTAMP);
+			gpuProfiler->endFrame();
+			renderTargets->endFrame();
+			//Stands in for the swap, keeps the driver from queueing unbounded frames
+			glFlush();
+			auto renderEnd = std::chrono::steady_clock::now();
+
+			if (measured) {
+				renderFrameMs.push_back(std::chrono::duration<float, std::milli>(renderEnd - renderStart).count());
+				peakTargetBytes = std::max(peakTargetBytes, renderTargets->getAllocatedBytes());
+			}
+		};
+
+		//The context moves to the render thread for the frame loop and back for the results
+		joey::RenderThread* renderThread = nullptr;
+		if (options.renderThread != "off") {
+			makeHeadlessContextCurrent(false);
+			renderThread = new joey::RenderThread([]() { makeHeadlessContextCurrent(true); }, []() { makeHeadlessContextCurrent(false); });
+			renderThread->setSynchronous(options.renderThread == "sync");
+		}
+
+		for (int frame = 0; frame < totalFrames; frame++)
+		{
+			auto cpuStart = std::chrono::steady_clock::now();
+			JOEY_CPU_FRAME();
+			sampleCameraPath(cameraPath, frame * FRAME_DT, &state.camera);
+			animateScene(state, options.scene);
+			if (renderThread) {
+				renderThread->submit([&renderFrame, state, frame]() { renderFrame(state, frame); });
+				renderThread->endFrame();
+			}
+			else {
+				renderFrame(state, frame);
+			}
+			auto cpuEnd = std::chrono::steady_clock::now();
+
+			if (frame >= options.warmup) {
+				cpuFrameMs.push_back(std::chrono::duration<float, std::milli>(cpuEnd - cpuStart).count());
+				if (renderThread)
+					submitStallMs.push_back(renderThread->getLastStallMs());
+			}
+		}
+
+		if (renderThread) {
+			delete renderThread;
+			makeHeadlessContextCurrent(true);
+		}
+
+		//Results of the last few frames
+		glFinish();
+		for (int frame = std::max(totalFrames - QUERY_LATENCY, options.warmup); frame < totalFrames; frame++)
+		{
+			int slot = frame % QUERY_LATENCY;
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(timestamps[slot][0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(timestamps[slot][1], GL_QUERY_RESULT, &end);
+			gpuFrameMs.push_back((float)((end - start) / 1000000.0));
+		}
+		gpuProfiler->resolve();
+		frameGraph.reset();
+		//Closes the last frame's counters
+		joey::renderStatsBeginFrame();
+		renderCounters.add(joey::getFrameRenderCounters());
+	}
+	glDeleteQueries(QUERY_LATENCY * 2, &timestamps[0][0]);
+
+	FILE* file = fopen(options.output.c_str(), "w");
+	if (!file) {
+		printf("Failed to open %s\n", options.output.c_str());
+		return 1;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"commit\": \"%s\",\n", SCENE_BENCH_COMMIT);
+	fprintf(file, "\t\"scene\": \"%s\",\n", options.scene.c_str());
+	fprintf(file, "\t\"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+	fprintf(file, "\t\"context\": \"%s\",\n", headlessContextApi());
+	fprintf(file, "\t\"renderThread\": \"%s\",\n", options.renderThread.c_str());
+	fprintf(file, "\t\"stateCache\": \"%s\",\n", options.stateCache.c_str());
+	fprintf(file, "\t\"depthPrepass\": \"%s\",\n", options.depthPrepass.c_str());
+	//Compare the Shadow pass across --position-stream, assignment3 draws 64 monkeys and its floor into it
+	fprintf(file, "\t\"positionStream\": \"%s\",\n", options.positionStream.c_str());
+	//Draw calls per frame are in renderStatsPerFrame, chunks is 0 unless batched
+	fprintf(file, "\t\"staticBatch\": { \"mode\": \"%s\", \"chunks\": %d, \"instances\": %d },\n", options.staticBatch.c_str(),
+		scene.floorBatch->getChunkCount(), scene.floorBatch->getInstanceCount());
+	//Most patches any frame selected, never above maxPatches however far the camera sees
+	if (scene.terrain) {
+		fprintf(file, "\t\"terrain\": { \"mode\": \"on\", \"peakPatches\": %d, \"maxPatches\": %d, \"peakTriangles\": %u },\n", scene.terrainPeakPatches,
+			scene.terrain->getSettings().maxPatches, (unsigned int)scene.terrainPeakPatches * scene.terrain->getSettings().patchResolution * scene.terrain->getSettings().patchResolution * 2);
+	}
+	else
+		fprintf(file, "\t\"terrain\": { \"mode\": \"off\" },\n");
+	//Cold when cacheHits is 0, setupMs includes model and texture loading
+	fprintf(file, "\t\"shaderStartup\": { \"cacheHits\": %d, \"cacheMisses\": %d, \"buildMs\": %.2f, \"setupMs\": %.2f, \"parallelCompile\": %s },\n",
+		scene.shaderCache->getHitCount(), scene.shaderCache->getMissCount(), scene.shaderCache->getBuildMs(), setupMs,
+		scene.shaderCache->hasParallelCompile() ? "true" : "false");
+	fprintf(file, "\t\"drawDataStalls\": %d,\n", scene.drawStream->getStallCount());
+	fprintf(file, "\t\"width\": %d,\n\t\"height\": %d,\n", options.width, options.height);
+	fprintf(file, "\t\"frames\": %d,\n\t\"warmupFrames\": %d,\n", options.frames, options.warmup);
+	writePercentiles(file, "cpuFrameMs", computePercentiles(cpuFrameMs));
+	writePercentiles(file, "gpuFrameMs", computePercentiles(gpuFrameMs));
+	//Time spent issuing GL per frame, on the render thread if there is one
+	writePercentiles(file, "renderFrameMs", computePercentiles(renderFrameMs));
+	//Main thread blocked on the render thread, empty without one
+	writePercentiles(file, "submitStallMs", computePercentiles(submitStallMs));
+	fprintf(file, "\t\"gpuPasses\": [\n");
+	std::vector<joey::GpuPassStats> passStats = gpuProfiler->getPassStats();
+	for (size_t i = 0; i < passStats.size(); i++)
+	{
+		//Fragments per output pixel, only meaningful for screen sized passes. Compare GBuffer across --depth-prepass
+		const joey::GpuPassStats& stats = passStats[i];
+		double overdraw = stats.meanFragments / ((double)options.width * options.height);
+		fprintf(file, "\t\t{ \"name\": %s, \"minMs\": %.4f, \"meanMs\": %.4f, \"p99Ms\": %.4f, \"meanFragments\": %.0f, \"overdraw\": %.3f }%s\n",
+			joey::jsonString(stats.name).c_str(), stats.minMs, stats.meanMs, stats.p99Ms, stats.meanFragments, overdraw, i + 1 < passStats.size() ? "," : "");
+	}
+	fprintf(file, "\t],\n");
+	writeRenderCounters(file, "renderStatsPerFrame", renderCounters, options.frames);
+	fprintf(file, ",\n\t\"renderStatsPasses\": {\n");
+	const std::vector<joey::PassRenderCounters>& passCounters = joey::getPassRenderCounters();
+	for (size_t i = 0; i < passCounters.size(); i++)
+	{
+		fprintf(file, "\t");
+		writeRenderCounters(file, passCounters[i].name.c_str(), passCounters[i].counters, 1);
+		fprintf(file, "%s\n", i + 1 < passCounters.size() ? "," : "");
+	}
+	fprintf(file, "\t},\n");
+	fprintf(file, "\t\"memory\": { \"renderTargetBytes\": %zu, \"pointShadowAtlasBytes\": %zu, \"peakResidentBytes\": %zu }\n",
+		peakTargetBytes, scene.pointShadowAtlas->getMemoryBytes(), peakResidentBytes());
+	fprintf(file, "}\n");
+	fclose(file);
+
+	Percentiles cpu = computePercentiles(cpuFrameMs);
+	Percentiles gpu = computePercentiles(gpuFrameMs);
+	printf("CPU frame: mean %.3f ms, p99 %.3f ms\n", cpu.mean, cpu.p99);
+	printf("GPU frame: mean %.3f ms, p99 %.3f ms\n", gpu.mean, gpu.p99);
+	printf("Results written to %s\n", options.output.c_str());
+
+	delete scene.pointShadowAtlas;
+	delete scene.drawStream;
+	delete scene.casterList;
+	delete scene.floorBatch;
+	delete scene.terrain;
+	delete scene.renderQueue;
+	delete scene.materialTextures;
+	delete scene.monkeyModel;
+	delete scene.geometryPool;
+	scene.deferredShaders->destroy();
+	delete scene.deferredShaders;
+	ew::Shader* shaders[] = { scene.geometryShader, scene.postProcessShader, scene.shadowShader, scene.lightOrbShader,
+		scene.terrainShader, scene.terrainDepthShader };
+	for (ew::Shader* shader : shaders)
+	{
+		shader->destroy();
+		delete shader;
+	}
+	delete scene.shaderCache;
+	glDeleteSamplers(1, &scene.shadowCompareSampler);
+	glDeleteVertexArrays(1, &scene.dummyVAO);
+	renderTargets->trim();
+	delete renderTargets;
+	delete gpuProfiler;
+	destroyHeadlessContext();
+	return 0;
+}
@@ -0,0 +1,21 @@
+// Per draw data streamed through joey::StreamBuffer, include right after #version.
+// Each draw's base instance is its index, see ew::Mesh::draw(DrawMode, int)
+#extension GL_ARB_shader_draw_parameters : require
+
+struct DrawData
+{
+	mat4 model;
+	vec4 color;
+	ivec4 material; //x = material, its layer in joey::MaterialTextures
+};
+
+// Must match joey::StreamBuffer::DRAW_DATA_BINDING
+layout (std430, binding = 5) readonly buffer DrawDataBuffer
+{
+	DrawData _Draws[];
+};
+
+#define CURRENT_DRAW _Draws[gl_BaseInstanceARB]
+
+// Instanced draws (joey::drawArraysInstanced) get one entry per instance from the base instance on
+#define CURRENT_INSTANCE _Draws[gl_BaseInstanceARB + gl_InstanceID]
@@ -0,0 +1,56 @@
+// Blinn-Phong lighting shared by lit.frag and deferredLit.frag.
+// The material and directional light come from the same uniforms in both.
+
+// Coefficients for editor
+struct Material
+{
+	float AmbientCo;
+	float DiffuseCo;
+	float SpecualarCo;
+	float Shininess;
+};
+
+struct PointLight
+{
+	vec3 position;
+	float radius;
+	vec4 color;
+};
+
+uniform vec3 _EyePos;
+uniform vec3 _LightDirection;
+uniform vec3 _LightColor;
+uniform vec3 _AmbientColor = vec3(0.3, 0.4, 0.46);
+uniform Material _Material;
+
+float attenuateExponential(float distance, float radius)
+{
+	float i = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+	return i * i;
+}
+
+// Directional light plus ambient, before shadowing
+vec3 calcDirectionalLight(vec3 normal, vec3 worldPos)
+{
+	vec3 toLight = -_LightDirection;
+	vec3 toEye = normalize(_EyePos - worldPos);
+	vec3 h = normalize(toLight + toEye);
+	float diffuseFactor = max(dot(normal, toLight), 0.0);
+	float specularFactor = pow(max(dot(normal, h), 0.0), _Material.Shininess);
+
+	vec3 lightColor = (_Material.DiffuseCo * diffuseFactor + _Material.SpecualarCo * specularFactor) * _LightColor;
+	return lightColor + _AmbientColor * _Material.AmbientCo;
+}
+
+vec3 calcPointLight(PointLight light, vec3 normal, vec3 worldPos)
+{
+	vec3 diff = light.position - worldPos;
+	vec3 toLight = normalize(diff);
+	vec3 toEye = normalize(_EyePos - worldPos);
+	vec3 h = normalize(toLight + toEye);
+	float diffuseFactor = max(dot(normal, toLight), 0.0);
+	float specularFactor = pow(max(dot(normal, h), 0.0), _Material.Shininess);
+
+	vec3 lightColor = (diffuseFactor + specularFactor) * light.color.rgb;
+	return lightColor * attenuateExponential(length(diff), light.radius);
+}
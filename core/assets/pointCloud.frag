@@ -0,0 +1,13 @@
+#version 450
+in vec3 Color;
+
+out vec4 FragColor;
+
+void main()
+{
+	//Round points, the square's corners are dropped
+	vec2 offset = gl_PointCoord * 2.0 - 1.0;
+	if (dot(offset, offset) > 1.0)
+		discard;
+	FragColor = vec4(Color, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 450
+// joey::PointCloud, one vertex per point
+layout (location = 0) in vec3 vPos;
+layout (location = 1) in vec4 vColor;
+
+uniform mat4 _ViewProjection;
+uniform float _PointSize;
+
+out vec3 Color;
+
+void main()
+{
+	Color = vColor.rgb;
+	gl_Position = _ViewProjection * vec4(vPos, 1.0);
+	gl_PointSize = _PointSize;
+}
@@ -0,0 +1,10 @@
+#version 450
+
+in vec3 FragWorldPos;
+flat in vec4 LightPosRadius;
+
+void main()
+{
+	//Linear distance to the light, normalized by its radius
+	gl_FragDepth = length(FragWorldPos - LightPosRadius.xyz) / LightPosRadius.w;
+}
@@ -0,0 +1,11 @@
+#version 450
+#include "drawData.glsl"
+layout (location = 0) in vec3 vPos;
+
+out vec3 WorldPos;
+
+void main()
+{
+	//Projection happens per cube face in pointShadow.geom
+	WorldPos = vec3(CURRENT_DRAW.model * vec4(vPos, 1.0));
+}
@@ -0,0 +1,53 @@
+// Point light shadow lookups into joey::PointShadowAtlas, included by deferredLit.frag.
+// Faces are stored per light as +X, -X, +Y, -Y, +Z, -Z.
+// Without POINT_SHADOWS (defined to 1 per variant) every light counts as unshadowed.
+
+#ifndef POINT_SHADOWS
+#define POINT_SHADOWS 0
+#endif
+
+struct PointShadowFace
+{
+	mat4 viewProjection;
+	ivec4 layer; //x = atlas layer, -1 when the face is not resident
+};
+
+// Must match joey::PointShadowAtlas::FACE_BUFFER_BINDING
+layout (std430, binding = 3) readonly buffer PointShadowFaces
+{
+	PointShadowFace _PointShadowFaces[];
+};
+
+uniform sampler2DArrayShadow _PointShadowAtlas;
+uniform float _PointShadowBias = 0.02;
+
+int cubeFace(vec3 dir)
+{
+	vec3 a = abs(dir);
+	if (a.x >= a.y && a.x >= a.z)
+		return dir.x > 0.0 ? 0 : 1;
+	if (a.y >= a.z)
+		return dir.y > 0.0 ? 2 : 3;
+	return dir.z > 0.0 ? 4 : 5;
+}
+
+// Returns 0 when lit, 1 when fully in shadow of point light lightIndex
+float calcPointShadow(int lightIndex, vec3 lightPos, float radius, vec3 worldPos)
+{
+#if !POINT_SHADOWS
+	return 0.0;
+#else
+	vec3 toFrag = worldPos - lightPos;
+	float dist = length(toFrag);
+	if (dist >= radius)
+		return 0.0;
+
+	PointShadowFace face = _PointShadowFaces[lightIndex * 6 + cubeFace(toFrag)];
+	if (face.layer.x < 0)
+		return 0.0;
+
+	vec4 clip = face.viewProjection * vec4(worldPos, 1.0);
+	vec2 uv = clip.xy / clip.w * 0.5 + 0.5;
+	return 1.0 - texture(_PointShadowAtlas, vec4(uv, face.layer.x, dist / radius - _PointShadowBias));
+#endif
+}
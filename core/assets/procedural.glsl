@@ -0,0 +1,81 @@
+// Buffer-less primitives, generated from gl_VertexID with nothing bound but an empty vertex array.
+// Non indexed triangle lists drawn with joey::drawProcedural, which has the vertex counts.
+// Same shapes, winding and UVs as ew::createPlane/createSphere/createCylinder, at unit size:
+// 1x1 plane, radius 1 sphere, radius 1 cylinder of height 1. Scale with the model matrix
+
+struct ProceduralVertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
+const float PROCEDURAL_PI = 3.14159265359;
+
+// (column, row) offset of a vertex within its quad, in the triangle order ew's sphere and cylinder use
+ivec2 proceduralQuadCorner(int vertexId)
+{
+	const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+	return corners[vertexId % 6];
+}
+
+ProceduralVertex proceduralPlane(int vertexId, int subdivisions)
+{
+	//ew::createPlane's triangles go the other way round their quad
+	const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1), ivec2(1, 1), ivec2(0, 1), ivec2(0, 0));
+	int quad = vertexId / 6;
+	ivec2 cell = ivec2(quad % subdivisions, quad / subdivisions) + corners[vertexId % 6];
+	ProceduralVertex v;
+	v.uv = vec2(cell) / float(subdivisions);
+	v.position = vec3(v.uv.x - 0.5, 0.0, 0.5 - v.uv.y);
+	v.normal = vec3(0, 1, 0);
+	return v;
+}
+
+// Rows of quads from pole to pole, the pole rows have one degenerate triangle each
+ProceduralVertex proceduralSphere(int vertexId, int subdivisions)
+{
+	int quad = vertexId / 6;
+	ivec2 cell = ivec2(quad % subdivisions, quad / subdivisions) + proceduralQuadCorner(vertexId);
+	float theta = 2.0 * PROCEDURAL_PI * float(cell.x) / float(subdivisions);
+	float phi = PROCEDURAL_PI * float(cell.y) / float(subdivisions);
+	ProceduralVertex v;
+	v.normal = vec3(cos(theta) * sin(phi), cos(phi), sin(theta) * sin(phi));
+	v.position = v.normal;
+	v.uv = vec2(float(cell.x) / float(subdivisions), 1.0 - float(cell.y) / float(subdivisions));
+	return v;
+}
+
+// Top cap fan, one row of side quads, bottom cap fan
+ProceduralVertex proceduralCylinder(int vertexId, int subdivisions)
+{
+	int capVertices = subdivisions * 3;
+	int sideVertices = subdivisions * 6;
+	ProceduralVertex v;
+	if (vertexId < capVertices || vertexId >= capVertices + sideVertices)
+	{
+		bool top = vertexId < capVertices;
+		int local = top ? vertexId : vertexId - capVertices - sideVertices;
+		int corner = local % 3;
+		float y = top ? 0.5 : -0.5;
+		v.normal = vec3(0, y * 2.0, 0);
+		if (corner == 0) {
+			v.position = vec3(0, y, 0);
+			v.uv = vec2(0.5);
+			return v;
+		}
+		//The top fan goes against the ring's direction and the bottom along it, so both face out
+		int column = local / 3 + (top == (corner == 1) ? 1 : 0);
+		float theta = 2.0 * PROCEDURAL_PI * float(column) / float(subdivisions);
+		v.position = vec3(cos(theta), y, sin(theta));
+		v.uv = vec2(cos(theta), sin(theta)) * 0.5 + 0.5;
+		return v;
+	}
+	int local = vertexId - capVertices;
+	ivec2 cell = ivec2(local / 6, 0) + proceduralQuadCorner(local);
+	float theta = 2.0 * PROCEDURAL_PI * float(cell.x) / float(subdivisions);
+	v.position = vec3(cos(theta), cell.y == 0 ? 0.5 : -0.5, sin(theta));
+	v.normal = vec3(cos(theta), 0, sin(theta));
+	v.uv = vec2(float(cell.x) / float(subdivisions), cell.y == 0 ? 1.0 : 0.0);
+	return v;
+}
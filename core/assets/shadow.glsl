@@ -0,0 +1,142 @@
+// Shared directional shadow filtering, included by lit.frag and deferredLit.frag.
+// The filter is compiled in: SHADOW_FILTER is defined per variant from C++ through
+// joey::shadowFilterDefine (core/joey/shadow.h), keep the SHADOW_FILTER_* values in sync with that enum.
+
+#define SHADOW_FILTER_MANUAL_3X3 0
+#define SHADOW_FILTER_HARDWARE_PCF 1
+#define SHADOW_FILTER_GATHER_4 2
+#define SHADOW_FILTER_GATHER_16 3
+#define SHADOW_FILTER_POISSON 4
+
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_MANUAL_3X3
+#endif
+
+// Same depth texture bound twice: raw for the manual filter, and through a
+// comparison sampler object (GL_COMPARE_REF_TO_TEXTURE, GL_LINEAR) for the rest
+uniform sampler2D _ShadowMap;
+uniform sampler2DShadow _ShadowMapCmp;
+uniform float _ShadowFilterRadius = 1.5; //Poisson disk radius in texels
+
+const vec2 POISSON_DISK[16] = vec2[](
+	//Outer ring first so the early out can test these four
+	vec2(-0.94201624, -0.39906216),
+	vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870),
+	vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432),
+	vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845),
+	vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554),
+	vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023),
+	vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507),
+	vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367),
+	vec2(0.14383161, -0.14100790)
+);
+
+// Original filter: 9 point samples of the raw depth, 0/1 each
+float shadowManual3x3(vec3 sampleCoord, float depth)
+{
+	float totalShadow = 0;
+	vec2 texelOffset = 1.0 / textureSize(_ShadowMap, 0);
+
+	for(int y = -1; y <= 1; y++)
+	{
+		for(int x = -1; x <= 1; x++)
+		{
+			vec2 uv = sampleCoord.xy + vec2(x * texelOffset.x, y * texelOffset.y);
+			totalShadow += step(texture(_ShadowMap, uv).r, depth);
+		}
+	}
+
+	return totalShadow / 9.0;
+}
+
+// One comparison tap, the sampler does 2x2 bilinear PCF for free
+float shadowHardware(vec3 sampleCoord, float depth)
+{
+	return 1.0 - texture(_ShadowMapCmp, vec3(sampleCoord.xy, depth));
+}
+
+// Weights a textureGather result. Gather order is (x0,y1) (x1,y1) (x1,y0) (x0,y0)
+float gatherWeighted(vec2 uv, float depth, vec2 wx, vec2 wy)
+{
+	vec4 lit = textureGather(_ShadowMapCmp, uv, depth);
+	return dot(lit, vec4(wx.x * wy.y, wx.y * wy.y, wx.y * wy.x, wx.x * wy.x));
+}
+
+// 2x2 texels in one gather, bilinear weighted
+float shadowGather4(vec3 sampleCoord, float depth)
+{
+	vec2 size = vec2(textureSize(_ShadowMapCmp, 0));
+	vec2 texel = sampleCoord.xy * size - 0.5;
+	vec2 f = fract(texel);
+	//A coordinate on a texel corner gathers the 2x2 block around it
+	vec2 corner = (floor(texel) + 1.0) / size;
+
+	return 1.0 - gatherWeighted(corner, depth, vec2(1.0 - f.x, f.x), vec2(1.0 - f.y, f.y));
+}
+
+// 4x4 texels in four gathers, 3x3 tent over the bilinear footprint
+float shadowGather16(vec3 sampleCoord, float depth)
+{
+	vec2 size = vec2(textureSize(_ShadowMapCmp, 0));
+	vec2 texel = sampleCoord.xy * size - 0.5;
+	vec2 f = fract(texel);
+	vec2 base = floor(texel);
+
+	float lit = 0.0;
+	lit += gatherWeighted((base + vec2(0, 0)) / size, depth, vec2(1.0 - f.x, 1.0), vec2(1.0 - f.y, 1.0));
+	lit += gatherWeighted((base + vec2(2, 0)) / size, depth, vec2(1.0, f.x), vec2(1.0 - f.y, 1.0));
+	lit += gatherWeighted((base + vec2(0, 2)) / size, depth, vec2(1.0 - f.x, 1.0), vec2(1.0, f.y));
+	lit += gatherWeighted((base + vec2(2, 2)) / size, depth, vec2(1.0, f.x), vec2(1.0, f.y));
+
+	return 1.0 - lit / 9.0;
+}
+
+// Poisson disk of comparison taps. Fully lit/shadowed pixels stop after 4 taps,
+// only the penumbra pays for all 16
+float shadowPoisson(vec3 sampleCoord, float depth)
+{
+	vec2 radius = _ShadowFilterRadius / vec2(textureSize(_ShadowMapCmp, 0));
+
+	float lit = 0.0;
+	for (int i = 0; i < 4; i++)
+	{
+		lit += texture(_ShadowMapCmp, vec3(sampleCoord.xy + POISSON_DISK[i] * radius, depth));
+	}
+	if (lit == 0.0 || lit == 4.0)
+	{
+		return 1.0 - lit / 4.0;
+	}
+	for (int i = 4; i < 16; i++)
+	{
+		lit += texture(_ShadowMapCmp, vec3(sampleCoord.xy + POISSON_DISK[i] * radius, depth));
+	}
+	return 1.0 - lit / 16.0;
+}
+
+// Returns 0 when lit, 1 when fully in shadow
+float calcShadow(vec4 lightSpacePos, float bias)
+{
+	vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+	sampleCoord = sampleCoord * 0.5 + 0.5;
+
+	float myDepth = sampleCoord.z - bias;
+
+#if SHADOW_FILTER == SHADOW_FILTER_HARDWARE_PCF
+	return shadowHardware(sampleCoord, myDepth);
+#elif SHADOW_FILTER == SHADOW_FILTER_GATHER_4
+	return shadowGather4(sampleCoord, myDepth);
+#elif SHADOW_FILTER == SHADOW_FILTER_GATHER_16
+	return shadowGather16(sampleCoord, myDepth);
+#elif SHADOW_FILTER == SHADOW_FILTER_POISSON
+	return shadowPoisson(sampleCoord, myDepth);
+#else
+	return shadowManual3x3(sampleCoord, myDepth);
+#endif
+}
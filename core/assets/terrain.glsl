@@ -0,0 +1,66 @@
+// Quadtree terrain patches drawn by joey::Terrain, one instance per patch. Every patch is the same
+// ew::createPlane(1, 1, resolution) grid, placed here, morphed into its parent's grid as it nears
+// the next level's distance and displaced by the heightmap
+
+struct TerrainPatch
+{
+	vec4 placement; //xy = min corner in world xz, z = size
+	vec4 morph; //x = distance morphing starts, y = distance it's complete
+};
+
+// Must match joey::Terrain::PATCH_BINDING
+layout (std430, binding = 6) readonly buffer TerrainPatchBuffer
+{
+	TerrainPatch _TerrainPatches[];
+};
+
+uniform sampler2D _TerrainHeightmap;
+uniform vec3 _TerrainCenter;
+uniform float _TerrainSize;
+uniform float _TerrainHeightScale;
+uniform int _TerrainResolution;
+uniform vec3 _TerrainEye; //Camera the patches were selected for
+
+struct TerrainVertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv; //0-1 across the whole terrain
+};
+
+float terrainHeight(vec2 uv)
+{
+	//Heightmap samples sit exactly on the terrain's edges, not half a texel in
+	float size = float(textureSize(_TerrainHeightmap, 0).x);
+	return textureLod(_TerrainHeightmap, (uv * (size - 1.0) + 0.5) / size, 0.0).r * _TerrainHeightScale + _TerrainCenter.y;
+}
+
+TerrainVertex terrainVertex(vec3 gridPosition, int patchIndex)
+{
+	TerrainPatch terrainPatch = _TerrainPatches[patchIndex];
+	vec2 corner = _TerrainCenter.xz - _TerrainSize * 0.5;
+	float resolution = float(_TerrainResolution);
+	//Whole grid steps, so odd and even columns are exact
+	vec2 cell = round((gridPosition.xz + 0.5) * resolution);
+	vec2 position = terrainPatch.placement.xy + cell / resolution * terrainPatch.placement.z;
+	vec2 uv = (position - corner) / _TerrainSize;
+
+	float distance = length(vec3(position.x, terrainHeight(uv), position.y) - _TerrainEye);
+	float morph = clamp((distance - terrainPatch.morph.x) / (terrainPatch.morph.y - terrainPatch.morph.x), 0.0, 1.0);
+	//Odd vertices slide onto their even neighbours, which are the parent's vertices
+	cell -= mod(cell, 2.0) * morph;
+	position = terrainPatch.placement.xy + cell / resolution * terrainPatch.placement.z;
+	uv = (position - corner) / _TerrainSize;
+
+	TerrainVertex v;
+	v.position = vec3(position.x, terrainHeight(uv), position.y);
+	v.uv = uv;
+	//Central differences one heightmap sample apart
+	float texel = 1.0 / float(textureSize(_TerrainHeightmap, 0).x - 1);
+	float left = terrainHeight(uv - vec2(texel, 0.0));
+	float right = terrainHeight(uv + vec2(texel, 0.0));
+	float back = terrainHeight(uv - vec2(0.0, texel));
+	float front = terrainHeight(uv + vec2(0.0, texel));
+	v.normal = normalize(vec3(left - right, 2.0 * texel * _TerrainSize, back - front));
+	return v;
+}
@@ -3,8 +3,10 @@
 */
 
 #include "cameraController.h"
+#include "../joey/cpuProfiler.h"
 namespace ew {
 	void CameraController::move(GLFWwindow* window, ew::Camera* camera, float deltaTime) {
+		JOEY_CPU_ZONE("CameraController::move");
 		//Only allow movement if right mouse is held
 		if (!glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_2)) {
 			//Release cursor
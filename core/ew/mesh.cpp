@@ -7,13 +7,52 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include "../joey/renderStats.h"
+#include <string.h>
+#include <unordered_map>
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	struct PositionKey {
+		unsigned int bits[3];
+		bool operator==(const PositionKey& other)const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+	};
+	struct PositionKeyHash {
+		size_t operator()(const PositionKey& key)const {
+			return key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u;
+		}
+	};
+
+	/// <summary>
+	/// Collapses vertices with bit identical positions into one, so a depth pass fetches 12 bytes
+	/// per unique position instead of a whole Vertex per seam copy
+	/// </summary>
+	/// <param name="meshData">Source mesh, indexed</param>
+	/// <returns></returns>
+	PositionMeshData createPositionStream(const MeshData& meshData) {
+		PositionMeshData positionData;
+		std::vector<unsigned int> remap(meshData.vertices.size());
+		std::unordered_map<PositionKey, unsigned int, PositionKeyHash> unique;
+		unique.reserve(meshData.vertices.size());
+		for (size_t i = 0; i < meshData.vertices.size(); i++) {
+			PositionKey key;
+			memcpy(key.bits, &meshData.vertices[i].pos, sizeof(key.bits));
+			auto inserted = unique.insert({ key, (unsigned int)positionData.positions.size() });
+			if (inserted.second)
+				positionData.positions.push_back(meshData.vertices[i].pos);
+			remap[i] = inserted.first->second;
+		}
+		positionData.indices.resize(meshData.indices.size());
+		for (size_t i = 0; i < meshData.indices.size(); i++) {
+			positionData.indices[i] = remap[meshData.indices[i]];
+		}
+		return positionData;
+	}
+
+	Mesh::Mesh(const MeshData& meshData, bool positionStream)
 	{
-		load(meshData);
+		load(meshData, positionStream);
 	}
-	void Mesh::load(const MeshData& meshData)
+	void Mesh::load(const MeshData& meshData, bool positionStream)
 	{
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
@@ -52,19 +91,58 @@ namespace ew {
 		m_numVertices = meshData.vertices.size();
 		m_numIndices = meshData.indices.size();
 
+		if (positionStream) {
+			PositionMeshData positionData = createPositionStream(meshData);
+			if (!m_positionVao) {
+				//Position attribute only, tightly packed
+				glCreateVertexArrays(1, &m_positionVao);
+				glCreateBuffers(1, &m_positionVbo);
+				glCreateBuffers(1, &m_positionEbo);
+				glVertexArrayAttribFormat(m_positionVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+				glVertexArrayAttribBinding(m_positionVao, 0, 0);
+				glEnableVertexArrayAttrib(m_positionVao, 0);
+				glVertexArrayVertexBuffer(m_positionVao, 0, m_positionVbo, 0, sizeof(glm::vec3));
+				glVertexArrayElementBuffer(m_positionVao, m_positionEbo);
+			}
+			if (positionData.positions.size() > 0) {
+				glNamedBufferData(m_positionVbo, sizeof(glm::vec3) * positionData.positions.size(), positionData.positions.data(), GL_STATIC_DRAW);
+			}
+			if (positionData.indices.size() > 0) {
+				glNamedBufferData(m_positionEbo, sizeof(unsigned int) * positionData.indices.size(), positionData.indices.data(), GL_STATIC_DRAW);
+			}
+			m_numPositions = positionData.positions.size();
+		}
+
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		//Bound behind the state cache's back
+		joey::stateCacheVertexArray(0);
 	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
-		glBindVertexArray(m_vao);
+		draw(drawMode, 0);
+	}
+	void Mesh::draw(ew::DrawMode drawMode, int baseInstance) const
+	{
+		joey::bindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			joey::renderStatsDraw(GL_TRIANGLES, m_numIndices);
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL, 1, baseInstance);
 		}
 		else {
-			glDrawArrays(GL_POINTS, 0, m_numVertices);
+			joey::renderStatsDraw(GL_POINTS, m_numVertices);
+			glDrawArraysInstancedBaseInstance(GL_POINTS, 0, m_numVertices, 1, baseInstance);
+		}
+	}
+	void Mesh::drawPositions(int baseInstance) const
+	{
+		if (!m_positionVao) {
+			draw(DrawMode::TRIANGLES, baseInstance);
+			return;
 		}
-		
+		joey::bindVertexArray(m_positionVao);
+		joey::renderStatsDraw(GL_TRIANGLES, m_numIndices);
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL, 1, baseInstance);
 	}
 }
\ No newline at end of file
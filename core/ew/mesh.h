@@ -18,6 +18,14 @@ namespace ew {
 		std::vector<unsigned int> indices;
 	};
 
+	//Positions only, for depth passes. Vertices split by normal or UV seams share one position
+	struct PositionMeshData {
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices; //Same triangles in the same order as the source mesh
+	};
+
+	PositionMeshData createPositionStream(const MeshData& meshData);
+
 	enum class DrawMode {
 		TRIANGLES = 0,
 		POINTS = 1
@@ -26,11 +34,17 @@ namespace ew {
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
-		void load(const MeshData& meshData);
+		Mesh(const MeshData& meshData, bool positionStream = false);
+		//positionStream also uploads createPositionStream(meshData) for drawPositions
+		void load(const MeshData& meshData, bool positionStream = false);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Single instance draw, baseInstance reaches the shader as gl_BaseInstanceARB (see drawData.glsl)
+		void draw(DrawMode drawMode, int baseInstance)const;
+		//Triangles from the position stream, only attribute 0 is fed. Same as draw without one
+		void drawPositions(int baseInstance = 0)const;
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		inline int getNumPositions()const { return m_numPositions; }
 	private:
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
@@ -38,5 +52,9 @@ namespace ew {
 		unsigned int m_ebo = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		unsigned int m_positionVao = 0;
+		unsigned int m_positionVbo = 0;
+		unsigned int m_positionEbo = 0;
+		unsigned int m_numPositions = 0;
 	};
 }
\ No newline at end of file
@@ -8,26 +8,66 @@
 
 #include <assimp/scene.h>
 #include <glm/glm.hpp>
+#include "../joey/jobSystem.h"
+#include "../joey/geometryPool.h"
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
-
-	Model::Model(const std::string& filePath)
+	Model::Model(const std::string& filePath, joey::JobSystem* jobs, joey::GeometryPool* pool)
+		: m_pool(pool)
 	{
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
-		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
+		if (!jobs && !pool) {
+			for (size_t i = 0; i < aiScene->mNumMeshes; i++)
+			{
+				aiMesh* aiMesh = aiScene->mMeshes[i];
+				m_meshes.push_back(processAiMesh(aiMesh));
+			}
+			return;
+		}
+		//GL calls have to stay on the thread that owns the context
+		std::vector<MeshData> meshData(aiScene->mNumMeshes);
+		auto convert = [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				meshData[i] = convertAiMesh(aiScene->mMeshes[i]);
+			}
+		};
+		if (jobs)
+			jobs->parallelFor((int)meshData.size(), 1, convert);
+		else
+			convert(0, (int)meshData.size());
+		for (const MeshData& data : meshData)
 		{
-			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			if (pool)
+				m_poolMeshes.push_back(pool->add(data));
+			else
+				m_meshes.push_back(ew::Mesh(data));
 		}
 	}
 
 	void Model::draw()
 	{
+		draw(0);
+	}
+
+	void Model::draw(int baseInstance)
+	{
+		for (int mesh : m_poolMeshes)
+		{
+			m_pool->draw(mesh, baseInstance);
+		}
 		for (size_t i = 0; i < m_meshes.size(); i++)
 		{
-			m_meshes[i].draw();
+			m_meshes[i].draw(DrawMode::TRIANGLES, baseInstance);
+		}
+	}
+
+	void Model::addDraws(joey::DrawList& drawList, int baseInstance) const
+	{
+		for (int mesh : m_poolMeshes)
+		{
+			drawList.add(mesh, baseInstance);
 		}
 	}
 
@@ -35,8 +75,7 @@ namespace ew {
 		return glm::vec3(v.x, v.y, v.z);
 	}
 
-	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
+	MeshData convertAiMesh(const aiMesh* aiMesh) {
 		ew::MeshData meshData;
 		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
 		{
@@ -58,7 +97,11 @@ namespace ew {
 				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
 			}
 		}
-		return ew::Mesh(meshData);
+		return meshData;
+	}
+
+	ew::Mesh processAiMesh(aiMesh* aiMesh) {
+		return ew::Mesh(convertAiMesh(aiMesh));
 	}
 
 }
@@ -7,12 +7,35 @@
 #include "shader.h"
 #include <vector>
 
+struct aiMesh;
+
+namespace joey {
+	class JobSystem;
+	class GeometryPool;
+	class DrawList;
+}
+
 namespace ew {
+	//Converts an Assimp mesh to vertices and indices, no GL calls
+	MeshData convertAiMesh(const aiMesh* aiMesh);
+	//convertAiMesh + upload
+	ew::Mesh processAiMesh(aiMesh* aiMesh);
+
 	class Model {
 	public:
-		Model(const std::string& filePath);
+		//With jobs, meshes are converted in parallel and uploaded on the calling thread.
+		//With a pool, meshes are uploaded into it instead of getting their own buffers
+		Model(const std::string& filePath, joey::JobSystem* jobs = nullptr, joey::GeometryPool* pool = nullptr);
 		void draw();
+		//Every mesh with the same base instance, see Mesh::draw(DrawMode, int)
+		void draw(int baseInstance);
+		//Appends every mesh to a list over the model's pool, only for pooled models
+		void addDraws(joey::DrawList& drawList, int baseInstance)const;
+		//Handles in the model's pool, empty for unpooled models
+		inline const std::vector<int>& getPoolMeshes()const { return m_poolMeshes; }
 	private:
 		std::vector<ew::Mesh> m_meshes;
+		joey::GeometryPool* m_pool = nullptr;
+		std::vector<int> m_poolMeshes;
 	};
 }
\ No newline at end of file
@@ -3,7 +3,10 @@
 */
 
 #include "procGen.h"
+#include "../joey/jobSystem.h"
 #include <stdlib.h>
+#include <math.h>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
@@ -60,181 +63,271 @@ namespace ew {
 		createCubeFace(vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
 		return mesh;
 	}
+	//Grids below this many vertices aren't worth handing to the job system
+	static const unsigned int PARALLEL_MIN_VERTICES = 64 * 1024;
+	//Columns per sine/cosine table, small enough to stay on the stack
+	static const int SINCOS_BLOCK = 256;
+
+	//body(beginRow, endRow), split across jobs when there are enough vertices. A template so the
+	//generators' large lambdas are called directly, a std::function of them would allocate.
+	//parallelFor only gets a reference to body, which fits std::function's inline storage
+	template<typename Body>
+	static void forEachRow(int rows, unsigned int vertexCount, joey::JobSystem* jobs, const Body& body)
+	{
+		if (jobs && vertexCount >= PARALLEL_MIN_VERTICES)
+			jobs->parallelFor(rows, 0, [&body](int begin, int end) { body(begin, end); });
+		else
+			body(0, rows);
+	}
+
+	//cosf/sinf of (first + i) * step, once per column instead of once per vertex
+	static void fillSinCos(int first, int count, float step, float* cosTable, float* sinTable)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			float angle = step * (float)(first + i);
+			cosTable[i] = cosf(angle);
+			sinTable[i] = sinf(angle);
+		}
+	}
+
+	MeshSize planeSize(int subdivisions)
+	{
+		unsigned int columns = subdivisions + 1;
+		return { columns * columns, (unsigned int)(subdivisions * subdivisions * 6) };
+	}
+	MeshSize sphereSize(int subdivisions)
+	{
+		unsigned int columns = subdivisions + 1;
+		//Two caps of one triangle per column, quads between the rows in between
+		unsigned int sideRows = subdivisions > 2 ? subdivisions - 2 : 0;
+		return { columns * columns, subdivisions * 6 + sideRows * subdivisions * 6 };
+	}
+	MeshSize cylinderSize(int subdivisions)
+	{
+		unsigned int columns = subdivisions + 1;
+		//Center vertices plus 4 rings. Caps and sides each have one triangle (pair) per ring vertex
+		return { 2 + columns * 4, columns * 12 };
+	}
+
 	MeshData createPlane(float width, float height, int subdivisions)
 	{
-		//VERTICES
 		MeshData mesh;
+		MeshSize size = planeSize(subdivisions);
+		mesh.vertices.resize(size.vertices);
+		mesh.indices.resize(size.indices);
+		createPlane(width, height, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createPlane(float width, float height, int subdivisions, Vertex* vertices, unsigned int* indices, joey::JobSystem* jobs)
+	{
 		int columns = subdivisions + 1;
-		for (size_t row = 0; row <= subdivisions; row++)
-		{
-			for (size_t col = 0; col <= subdivisions; col++)
+		forEachRow(columns, planeSize(subdivisions).vertices, jobs, [=](int begin, int end) {
+			//VERTICES
+			for (int row = begin; row < end; row++)
 			{
-				Vertex v;                                                                                                                                                                                                                                                                                                                                                                                                    
-				v.uv.x = ((float)col / subdivisions);
-				v.uv.y = ((float)row / subdivisions);
-				v.pos.x = -width/2 + width * v.uv.x;
-				v.pos.y = 0;
-				v.pos.z = height/2 -height * v.uv.y;
-				v.normal = vec3(0, 1, 0);
-				mesh.vertices.push_back(v);
+				Vertex* v = vertices + row * columns;
+				for (int col = 0; col <= subdivisions; col++, v++)
+				{
+					v->uv.x = ((float)col / subdivisions);
+					v->uv.y = ((float)row / subdivisions);
+					v->pos.x = -width/2 + width * v->uv.x;
+					v->pos.y = 0;
+					v->pos.z = height/2 -height * v->uv.y;
+					v->normal = vec3(0, 1, 0);
+				}
 			}
-		}
-		//INDICES
-		for (size_t row = 0; row < subdivisions; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
+			//INDICES, rows of quads below each vertex row but the last
+			for (int row = begin; row < end && row < subdivisions; row++)
 			{
-				int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start);
+				unsigned int* i = indices + row * subdivisions * 6;
+				for (int col = 0; col < subdivisions; col++)
+				{
+					unsigned int start = row * columns + col;
+					*i++ = start;
+					*i++ = start + 1;
+					*i++ = start + columns + 1;
+					*i++ = start + columns + 1;
+					*i++ = start + columns;
+					*i++ = start;
+				}
 			}
-		}
-		return mesh;
+		});
 	}
 	MeshData createSphere(float radius, int subdivisions)
 	{
 		MeshData mesh;
+		MeshSize size = sphereSize(subdivisions);
+		mesh.vertices.resize(size.vertices);
+		mesh.indices.resize(size.indices);
+		createSphere(radius, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createSphere(float radius, int subdivisions, Vertex* vertices, unsigned int* indices, joey::JobSystem* jobs)
+	{
 		//VERTICES
 		float thetaStep = glm::two_pi<float>() / subdivisions;
 		float phiStep = glm::pi<float>() / subdivisions;
-		for (size_t row = 0; row <= subdivisions; row++)
-		{
-			float phi = row * phiStep;
-			for (size_t col = 0; col <= subdivisions; col++)
+		int columns = subdivisions + 1;
+		forEachRow(columns, sphereSize(subdivisions).vertices, jobs, [=](int begin, int end) {
+			//Column blocks outside, so each block's table serves every row of this job
+			float cosTheta[SINCOS_BLOCK], sinTheta[SINCOS_BLOCK];
+			for (int firstCol = 0; firstCol < columns; firstCol += SINCOS_BLOCK)
 			{
-				float theta = thetaStep * col;
-				Vertex v;
-				v.normal.x = cosf(theta) * sinf(phi);
-				v.normal.y = cosf(phi);
-				v.normal.z = sinf(theta) * sinf(phi);
-				v.pos = v.normal * radius;
-				v.uv.x = (float)col / subdivisions;
-				v.uv.y = 1.0 - ((float)row / subdivisions);
-				mesh.vertices.push_back(v);
+				int blockColumns = std::min(SINCOS_BLOCK, columns - firstCol);
+				fillSinCos(firstCol, blockColumns, thetaStep, cosTheta, sinTheta);
+				for (int row = begin; row < end; row++)
+				{
+					float phi = row * phiStep;
+					float cosPhi = cosf(phi), sinPhi = sinf(phi);
+					float v = 1.0 - ((float)row / subdivisions);
+					Vertex* vertex = vertices + row * columns + firstCol;
+					for (int i = 0; i < blockColumns; i++, vertex++)
+					{
+						vertex->normal.x = cosTheta[i] * sinPhi;
+						vertex->normal.y = cosPhi;
+						vertex->normal.z = sinTheta[i] * sinPhi;
+						vertex->pos = vertex->normal * radius;
+						vertex->uv.x = (float)(firstCol + i) / subdivisions;
+						vertex->uv.y = v;
+					}
+				}
 			}
-		}
-		
+		});
+
 		//INDICES
-		unsigned int columns = subdivisions + 1;
 		unsigned int sideStart = columns;
 		unsigned int poleStart = 0;
+		unsigned int* i = indices;
 		//Top cap
-		for (size_t i = 0; i < subdivisions; i++)
+		for (int col = 0; col < subdivisions; col++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(poleStart + i);
-			mesh.indices.push_back(sideStart +i+1);
+			*i++ = sideStart + col;
+			*i++ = poleStart + col;
+			*i++ = sideStart + col + 1;
 		}
 		//Rows of quads for sides
-		for (size_t row = 1; row < subdivisions - 1; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
+		unsigned int* sides = i;
+		int sideRows = subdivisions > 2 ? subdivisions - 2 : 0;
+		forEachRow(sideRows, sphereSize(subdivisions).vertices, jobs, [=](int begin, int end) {
+			for (int row = begin + 1; row < end + 1; row++)
 			{
-				unsigned int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
+				unsigned int* quad = sides + (row - 1) * subdivisions * 6;
+				for (int col = 0; col < subdivisions; col++)
+				{
+					unsigned int start = row * columns + col;
+					*quad++ = start;
+					*quad++ = start + 1;
+					*quad++ = start + columns;
+					*quad++ = start + columns;
+					*quad++ = start + 1;
+					*quad++ = start + columns + 1;
+				}
 			}
-		}
+		});
+		i += sideRows * subdivisions * 6;
 		//Bottom cap
 		poleStart = (columns * columns) - columns;
 		sideStart = poleStart - columns;
-		for (size_t i = 0; i < subdivisions; i++)
+		for (int col = 0; col < subdivisions; col++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(sideStart + i + 1);
-			mesh.indices.push_back(poleStart + i);
+			*i++ = sideStart + col;
+			*i++ = sideStart + col + 1;
+			*i++ = poleStart + col;
 		}
-		return mesh;
 	}
-	void createCylinderRing(MeshData* meshData, float radius, int subdivisions, float y, bool sideFacing) {
-		float thetaStep = two_pi<float>() / subdivisions;
-		for (size_t i = 0; i <= subdivisions; i++)
+	//Writes subdivisions + 1 vertices around the y axis from the ring's sine/cosine tables
+	static void createCylinderRing(Vertex* ring, const float* cosTable, const float* sinTable, int first, int count, float radius, int subdivisions, float y, bool sideFacing) {
+		for (int i = 0; i < count; i++)
 		{
-			float theta = i * thetaStep;
-			float cosA = cosf(theta);
-			float sinA = sinf(theta);
-			Vertex v;
+			float cosA = cosTable[i];
+			float sinA = sinTable[i];
+			Vertex& v = ring[first + i];
 			v.pos = vec3(cosA * radius, y, sinA * radius);
 			if (sideFacing) {
 				v.normal = vec3(cosA, 0, sinA);
-				v.uv = vec2((float)i / subdivisions, y > 0 ? 1 : 0);
+				v.uv = vec2((float)(first + i) / subdivisions, y > 0 ? 1 : 0);
 			}
 			else {
 				v.normal = vec3(0, sign(y), 0);
 				v.uv = vec2(cosA * 0.5f + 0.5f, sinA * 0.5f + 0.5f);
 			}
-
-			meshData->vertices.push_back(v);
 		}
 	}
 	MeshData createCylinder(float radius, float height, int subdivisions)
 	{
 		MeshData mesh;
+		MeshSize size = cylinderSize(subdivisions);
+		mesh.vertices.resize(size.vertices);
+		mesh.indices.resize(size.indices);
+		createCylinder(radius, height, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createCylinder(float radius, float height, int subdivisions, Vertex* vertices, unsigned int* indices)
+	{
+		int columns = subdivisions + 1;
 
 		//VERTICES
 		{
 			const float topY = height * 0.5;
 			const float bottomY = -topY;
 
-			Vertex topVertex;
+			Vertex& topVertex = vertices[0];
 			topVertex.pos = vec3(0, topY, 0);
 			topVertex.normal = vec3(0, 1, 0);
 			topVertex.uv = vec2(0.5f);
-			mesh.vertices.push_back(topVertex);
 
-			createCylinderRing(&mesh, radius, subdivisions, topY, false);
-			createCylinderRing(&mesh, radius, subdivisions, topY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, false);
+			//Top cap, top side, bottom side and bottom cap rings share one table
+			float thetaStep = two_pi<float>() / subdivisions;
+			float cosTable[SINCOS_BLOCK], sinTable[SINCOS_BLOCK];
+			for (int first = 0; first < columns; first += SINCOS_BLOCK)
+			{
+				int count = std::min(SINCOS_BLOCK, columns - first);
+				fillSinCos(first, count, thetaStep, cosTable, sinTable);
+				createCylinderRing(vertices + 1, cosTable, sinTable, first, count, radius, subdivisions, topY, false);
+				createCylinderRing(vertices + 1 + columns, cosTable, sinTable, first, count, radius, subdivisions, topY, true);
+				createCylinderRing(vertices + 1 + columns * 2, cosTable, sinTable, first, count, radius, subdivisions, bottomY, true);
+				createCylinderRing(vertices + 1 + columns * 3, cosTable, sinTable, first, count, radius, subdivisions, bottomY, false);
+			}
 
-			Vertex bottomVertex;
+			Vertex& bottomVertex = vertices[1 + columns * 4];
 			bottomVertex.pos = vec3(0, bottomY, 0);
 			bottomVertex.normal = vec3(0, -1, 0);
 			bottomVertex.uv = vec2(0.5f);
-			mesh.vertices.push_back(bottomVertex);
 		}
-		
+
 
 		//INDICES
 		{
-			int columns = subdivisions + 1;
+			unsigned int* i = indices;
 			//Top cap
-			for (size_t i = 0; i < columns; i++)
+			for (int col = 0; col < columns; col++)
 			{
-				mesh.indices.push_back(0);
-				mesh.indices.push_back(i + 1);
-				mesh.indices.push_back(i);
+				*i++ = 0;
+				*i++ = col + 1;
+				*i++ = col;
 			}
-			int sideStart = columns;
+			unsigned int sideStart = columns;
 			//Sides
-			for (size_t i = 0; i < columns; i++)
+			for (int col = 0; col < columns; col++)
 			{
-				unsigned int start = sideStart + i;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
+				unsigned int start = sideStart + col;
+				*i++ = start;
+				*i++ = start + 1;
+				*i++ = start + columns;
+				*i++ = start + columns;
+				*i++ = start + 1;
+				*i++ = start + columns + 1;
 			}
 			//Bottom cap
-			unsigned int bottomIndex = mesh.vertices.size() - 1;
+			unsigned int bottomIndex = 1 + columns * 4;
 			sideStart = bottomIndex - columns;
-			for (size_t i = 0; i < columns; i++)
+			for (int col = 0; col < columns; col++)
 			{
-				mesh.indices.push_back(bottomIndex);
-				mesh.indices.push_back(sideStart + i);
-				mesh.indices.push_back(sideStart + i + 1);
+				*i++ = bottomIndex;
+				*i++ = sideStart + col;
+				*i++ = sideStart + col + 1;
 			}
 		}
-		return mesh;
 	}
-}
\ No newline at end of file
+}
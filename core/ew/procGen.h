@@ -5,9 +5,28 @@
 #pragma once
 #include "mesh.h"
 
+namespace joey {
+	class JobSystem;
+}
+
 namespace ew {
 	MeshData createCube(float size);
 	MeshData createPlane(float width, float height, int subdivisions);
 	MeshData createSphere(float radius, int subdivisions);
 	MeshData createCylinder(float radius, float height, int subdivisions);
+
+	//Exact vertex and index counts of a shape, to allocate once before generating into it
+	struct MeshSize {
+		unsigned int vertices;
+		unsigned int indices;
+	};
+	MeshSize planeSize(int subdivisions);
+	MeshSize sphereSize(int subdivisions);
+	MeshSize cylinderSize(int subdivisions);
+
+	//Same meshes written straight into caller memory, e.g. a mapped GPU buffer, which must hold the
+	//shape's MeshSize. Nothing is allocated. With jobs, large grids are split across threads by rows
+	void createPlane(float width, float height, int subdivisions, Vertex* vertices, unsigned int* indices, joey::JobSystem* jobs = nullptr);
+	void createSphere(float radius, int subdivisions, Vertex* vertices, unsigned int* indices, joey::JobSystem* jobs = nullptr);
+	void createCylinder(float radius, float height, int subdivisions, Vertex* vertices, unsigned int* indices);
 }
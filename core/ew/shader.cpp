@@ -8,24 +8,78 @@
 #include "external/glad.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "../joey/renderStats.h"
+#include "../joey/shaderCache.h"
 
 namespace ew {
-	/// <summary>
-	/// Loads shader source code from a file.
-	/// </summary>
-	/// <param name="filePath"></param>
-	/// <returns></returns>
-	std::string loadShaderSourceFromFile(const std::string& filePath) {
+	//Guards against include cycles
+	static const int MAX_INCLUDE_DEPTH = 16;
+
+	static std::string loadShaderSourceRecursive(const std::string& filePath, int depth) {
 		std::ifstream fstream(filePath);
 		if (!fstream.is_open()) {
 			printf("Failed to load file %s", filePath.c_str());
 			return {};
 		}
+		//Includes are resolved relative to the including file
+		size_t slash = filePath.find_last_of("/\\");
+		std::string directory = slash == std::string::npos ? "" : filePath.substr(0, slash + 1);
+
 		std::stringstream buffer;
-		buffer << fstream.rdbuf();
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(fstream, line)) {
+			lineNumber++;
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+				buffer << line << "\n";
+				continue;
+			}
+			size_t open = line.find('"', start);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos) {
+				printf("Malformed #include in %s:%d\n", filePath.c_str(), lineNumber);
+				continue;
+			}
+			if (depth >= MAX_INCLUDE_DEPTH) {
+				printf("#include depth exceeded in %s:%d\n", filePath.c_str(), lineNumber);
+				continue;
+			}
+			buffer << loadShaderSourceRecursive(directory + line.substr(open + 1, close - open - 1), depth + 1);
+			//Keep compiler errors pointing at the right line of this file
+			buffer << "#line " << lineNumber + 1 << "\n";
+		}
 		return buffer.str();
 	}
 
+	/// <summary>
+	/// Loads shader source code from a file.
+	/// Lines of the form #include "file" are replaced with that file's source, relative to this one.
+	/// </summary>
+	/// <param name="filePath"></param>
+	/// <param name="defines">Lines inserted right after #version, usually #defines. Empty for none</param>
+	/// <returns></returns>
+	std::string loadShaderSourceFromFile(const std::string& filePath, const std::string& defines) {
+		std::string source = loadShaderSourceRecursive(filePath, 0);
+		if (defines.empty())
+			return source;
+		//#version has to stay the first statement
+		size_t version = source.find("#version");
+		size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+		if (insert == std::string::npos)
+			return source;
+		if (version != std::string::npos)
+			insert++;
+		int nextLine = 1;
+		for (size_t i = 0; i < insert; i++)
+		{
+			if (source[i] == '\n')
+				nextLine++;
+		}
+		return source.substr(0, insert) + defines + (defines.back() == '\n' ? "" : "\n")
+			+ "#line " + std::to_string(nextLine) + "\n" + source.substr(insert);
+	}
+
 	/// <summary>
 	/// Creates and compiles a shader object of a given type
 	/// </summary>
@@ -57,12 +111,28 @@ namespace ew {
 	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
 	/// <returns></returns>
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		return createShaderProgram(vertexShaderSource, nullptr, fragmentShaderSource);
+	}
+
+	/// <summary>
+	/// Creates a shader program with a vertex, geometry and fragment shader
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="geometryShaderSource">GLSL source code for the geometry shader. nullptr to skip this stage</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource) {
 		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
+		unsigned int geometryShader = geometryShaderSource ? createShader(GL_GEOMETRY_SHADER, geometryShaderSource) : 0;
 		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
 
 		unsigned int shaderProgram = glCreateProgram();
+		joey::stateCacheForgetProgram(shaderProgram);
 		//Attach each stage
 		glAttachShader(shaderProgram, vertexShader);
+		if (geometryShader) {
+			glAttachShader(shaderProgram, geometryShader);
+		}
 		glAttachShader(shaderProgram, fragmentShader);
 		//Link all the stages together
 		glLinkProgram(shaderProgram);
@@ -75,6 +145,9 @@ namespace ew {
 		}
 		//The linked program now contains our compiled code, so we can delete these intermediate objects
 		glDeleteShader(vertexShader);
+		if (geometryShader) {
+			glDeleteShader(geometryShader);
+		}
 		glDeleteShader(fragmentShader);
 		return shaderProgram;
 	}
@@ -89,45 +162,106 @@ namespace ew {
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
 	}
+	/// <summary>
+	/// Creates a shader instance with vertex + geometry + fragment stages
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="geometryShader">File path to geometry shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader)
+	{
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
+		std::string geometryShaderSource = ew::loadShaderSourceFromFile(geometryShader.c_str());
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), geometryShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + fragment stages through a shader cache
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="cache">Builds the program, call its finish() before relying on it. nullptr builds it here</param>
+	/// <param name="defines">Inserted after #version in both stages, see loadShaderSourceFromFile</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, joey::ShaderCache* cache, const std::string& defines)
+	{
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader, defines);
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader, defines);
+		if (cache)
+			m_id = cache->request(vertexShader + " + " + fragmentShader, vertexShaderSource.c_str(), nullptr, fragmentShaderSource.c_str());
+		else
+			m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + geometry + fragment stages through a shader cache
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="geometryShader">File path to geometry shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="cache">Builds the program, call its finish() before relying on it</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader, joey::ShaderCache* cache)
+	{
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
+		std::string geometryShaderSource = ew::loadShaderSourceFromFile(geometryShader.c_str());
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
+		m_id = cache->request(vertexShader + " + " + geometryShader + " + " + fragmentShader,
+			vertexShaderSource.c_str(), geometryShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
 	void Shader::use()const
 	{
-		glUseProgram(m_id);
+		joey::useProgram(m_id);
+	}
+	void Shader::destroy()
+	{
+		joey::stateCacheForgetProgram(m_id);
+		glDeleteProgram(m_id);
+		m_id = 0;
 	}
 	void Shader::setInt(const std::string& name, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, &v, sizeof(v)))
+			glUniform1i(location, v);
 	}
 	void Shader::setFloat(const std::string& name, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, &v, sizeof(v)))
+			glUniform1f(location, v);
 	}
 	void Shader::setVec2(const std::string& name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		setVec2(name, glm::vec2(x, y));
 	}
 	void Shader::setVec2(const std::string& name, const glm::vec2& v) const
 	{
-		setVec2(name, v.x, v.y);
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, &v, sizeof(v)))
+			glUniform2f(location, v.x, v.y);
 	}
 	void Shader::setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		setVec3(name, glm::vec3(x, y, z));
 	}
 	void Shader::setVec3(const std::string& name, const glm::vec3& v) const
 	{
-		setVec3(name, v.x, v.y, v.z);
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, &v, sizeof(v)))
+			glUniform3f(location, v.x, v.y, v.z);
 	}
 	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		setVec4(name, glm::vec4(x, y, z, w));
 	}
 	void Shader::setVec4(const std::string& name, const glm::vec4& v) const
 	{
-		setVec4(name, v.x, v.y, v.z, v.w);
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, &v, sizeof(v)))
+			glUniform4f(location, v.x, v.y, v.z, v.w);
 	}
 	void Shader::setMat4(const std::string& name, const glm::mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+		int location = glGetUniformLocation(m_id, name.c_str());
+		if (joey::uniformNeeded(m_id, location, glm::value_ptr(m), sizeof(m)))
+			glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(m));
 	}
-}
-
+}
\ No newline at end of file
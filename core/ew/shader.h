@@ -6,13 +6,24 @@
 #include <string>
 #include <glm/glm.hpp>
 
+namespace joey {
+	class ShaderCache;
+}
+
 namespace ew {
-	std::string loadShaderSourceFromFile(const std::string& filePath);
+	std::string loadShaderSourceFromFile(const std::string& filePath, const std::string& defines = "");
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource);
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader);
+		//Built through the cache without waiting on the driver, errors are reported by cache->finish()
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, joey::ShaderCache* cache, const std::string& defines = "");
+		Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader, joey::ShaderCache* cache);
 		void use()const;
+		//Deletes the program. Copies share it, so only once none of them is used anymore
+		void destroy();
 		void setInt(const std::string& name, int v) const;
 		void setFloat(const std::string& name, float v) const;
 		void setVec2(const std::string& name, float x, float y) const;
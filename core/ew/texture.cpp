@@ -5,6 +5,9 @@
 #include "texture.h"
 #include "external/glad.h"
 #include "external/stb_image.h"
+#include "../joey/jobSystem.h"
+#include "../joey/stateCache.h"
+#include <stdio.h>
 
 static int getTextureFormat(int numComponents) {
 	switch (numComponents) {
@@ -22,19 +25,32 @@ namespace ew {
 	unsigned int loadTexture(const char* filePath) {
 		return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
 	}
-	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
-		int width, height, numComponents;
-		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
-		if (data == NULL) {
+	struct DecodedImage {
+		unsigned char* data = nullptr;
+		int width = 0;
+		int height = 0;
+		int numComponents = 0;
+	};
+
+	static DecodedImage decodeImage(const char* filePath) {
+		DecodedImage image;
+		image.data = stbi_load(filePath, &image.width, &image.height, &image.numComponents, 0);
+		if (image.data == NULL) {
 			printf("Failed to load image %s", filePath);
-			stbi_image_free(data);
+		}
+		return image;
+	}
+
+	//Frees the image data
+	static unsigned int uploadTexture(DecodedImage& image, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		if (image.data == NULL) {
 			return 0;
 		}
 		unsigned int texture;
 		glGenTextures(1, &texture);
 		glBindTexture(GL_TEXTURE_2D, texture);
-		int format = getTextureFormat(numComponents);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		int format = getTextureFormat(image.numComponents);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
@@ -49,8 +65,31 @@ namespace ew {
 		}
 
 		glBindTexture(GL_TEXTURE_2D, 0);
-		stbi_image_free(data);
+		//Bound behind the state cache's back, on unit 0 as nothing changes the active unit
+		joey::stateCacheTexture(0, 0);
+		stbi_image_free(image.data);
+		image.data = NULL;
 		return texture;
 	}
-}
 
+	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		DecodedImage image = decodeImage(filePath);
+		return uploadTexture(image, wrapMode, magFilter, minFilter, mipmap);
+	}
+
+	std::vector<unsigned int> loadTextures(const std::vector<std::string>& filePaths, joey::JobSystem* jobs) {
+		std::vector<DecodedImage> images(filePaths.size());
+		jobs->parallelFor((int)filePaths.size(), 1, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				images[i] = decodeImage(filePaths[i].c_str());
+			}
+		});
+		std::vector<unsigned int> textures;
+		for (DecodedImage& image : images)
+		{
+			textures.push_back(uploadTexture(image, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true));
+		}
+		return textures;
+	}
+}
@@ -3,8 +3,16 @@
 */
 
 #pragma once
+#include <string>
+#include <vector>
+
+namespace joey {
+	class JobSystem;
+}
 
 namespace ew {
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//Decodes every file on jobs, uploads on the calling thread. 0 for files that failed to load
+	std::vector<unsigned int> loadTextures(const std::vector<std::string>& filePaths, joey::JobSystem* jobs);
 }
@@ -0,0 +1,250 @@
+#include "cpuProfiler.h"
+#include "jsonString.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <imgui.h>
+
+namespace joey
+{
+	struct CpuZoneEvent {
+		const char* name;
+		long long start; //Nanoseconds since the profiler started
+		long long end;
+		int depth;
+	};
+
+	// Written only by its thread, read by whoever exports or draws.
+	// Readers recheck head after copying and drop events that may have been overwritten meanwhile
+	struct CpuThreadBuffer {
+		CpuZoneEvent events[CpuZone::RING_SIZE];
+		std::atomic<unsigned int> head{ 0 };
+		std::string name;
+		int id = 0;
+	};
+
+	static const int FRAME_HISTORY = 64;
+
+	static std::mutex s_registryMutex;
+	//Never freed, threads can exit while their zones are still being read
+	static std::vector<CpuThreadBuffer*> s_buffers;
+	static std::set<std::string> s_internedNames;
+	//Zones of cpuProfilerMeasureOverhead, kept out of s_buffers and reused by every measurement
+	static std::mutex s_overheadMutex;
+	static CpuThreadBuffer s_overheadBuffer;
+	static long long s_frameStarts[FRAME_HISTORY];
+	static std::atomic<int> s_frameCount{ 0 };
+
+	static thread_local CpuThreadBuffer* t_buffer = nullptr;
+	static thread_local int t_depth = 0;
+
+	static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	static inline long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+	}
+
+	static CpuThreadBuffer* threadBuffer()
+	{
+		if (!t_buffer) {
+			t_buffer = new CpuThreadBuffer();
+			std::lock_guard<std::mutex> lock(s_registryMutex);
+			t_buffer->id = (int)s_buffers.size();
+			t_buffer->name = t_buffer->id == 0 ? "Main" : "Thread " + std::to_string(t_buffer->id);
+			s_buffers.push_back(t_buffer);
+		}
+		return t_buffer;
+	}
+
+	CpuZone::CpuZone(const char* name)
+		: m_name(name)
+	{
+		t_depth++;
+		m_start = now();
+	}
+
+	CpuZone::~CpuZone()
+	{
+		long long end = now();
+		t_depth--;
+		CpuThreadBuffer* buffer = threadBuffer();
+		unsigned int head = buffer->head.load(std::memory_order_relaxed);
+		CpuZoneEvent& event = buffer->events[head % CpuZone::RING_SIZE];
+		event.name = m_name;
+		event.start = m_start;
+		event.end = end;
+		event.depth = t_depth;
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	void cpuProfilerFrameMark()
+	{
+		int frame = s_frameCount.load(std::memory_order_relaxed);
+		s_frameStarts[frame % FRAME_HISTORY] = now();
+		s_frameCount.store(frame + 1, std::memory_order_release);
+	}
+
+	void cpuProfilerSetThreadName(const char* name)
+	{
+		CpuThreadBuffer* buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		buffer->name = name;
+	}
+
+	const char* cpuProfilerIntern(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		return s_internedNames.insert(name).first->c_str();
+	}
+
+	/// <summary>
+	/// Copies out the events of a thread that are safe to read, oldest first
+	/// </summary>
+	static std::vector<CpuZoneEvent> snapshot(const CpuThreadBuffer& buffer)
+	{
+		unsigned int head = buffer.head.load(std::memory_order_acquire);
+		unsigned int count = head < (unsigned int)CpuZone::RING_SIZE ? head : CpuZone::RING_SIZE;
+		std::vector<CpuZoneEvent> events(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			events[i] = buffer.events[(head - count + i) % CpuZone::RING_SIZE];
+		}
+		//Anything the writer lapped while copying is garbage, and so is the slot it may be writing right now.
+		//Copied event i shares a slot with every write up to and including newHead once i + RING_SIZE <= newHead
+		unsigned int newHead = buffer.head.load(std::memory_order_acquire);
+		long long overwritten = (long long)newHead + 1 - CpuZone::RING_SIZE - (head - count);
+		if (overwritten >= (long long)count)
+			return {};
+		if (overwritten > 0)
+			events.erase(events.begin(), events.begin() + overwritten);
+		return events;
+	}
+
+	static std::vector<CpuThreadBuffer*> visibleBuffers()
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		return s_buffers;
+	}
+
+	bool cpuProfilerExportTrace(const char* filePath)
+	{
+		FILE* file = fopen(filePath, "w");
+		if (!file) {
+			printf("CPU profiler: failed to open %s\n", filePath);
+			return false;
+		}
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+		for (CpuThreadBuffer* buffer : visibleBuffers())
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", buffer->id);
+			fputs(jsonString(buffer->name).c_str(), file);
+			fprintf(file, "}}");
+			first = false;
+
+			for (const CpuZoneEvent& event : snapshot(*buffer))
+			{
+				fprintf(file, ",\n{\"name\":");
+				fputs(jsonString(event.name).c_str(), file);
+				//Trace timestamps are microseconds
+				fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+			}
+		}
+
+		int frameCount = s_frameCount.load(std::memory_order_acquire);
+		for (int i = frameCount > FRAME_HISTORY ? frameCount - FRAME_HISTORY : 0; i < frameCount; i++)
+		{
+			fprintf(file, "%s{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f}",
+				first ? "" : ",\n", s_frameStarts[i % FRAME_HISTORY] / 1000.0);
+			first = false;
+		}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		return true;
+	}
+
+	void cpuProfilerDrawFlameView(const char* title)
+	{
+		ImGui::Begin(title);
+#if !JOEY_CPU_PROFILER
+		ImGui::Text("Zones compiled out, configure with JOEY_CPU_PROFILER=ON");
+#endif
+		int frameCount = s_frameCount.load(std::memory_order_acquire);
+		if (frameCount < 2) {
+			ImGui::Text("Waiting for frames");
+			ImGui::End();
+			return;
+		}
+		//Last complete frame
+		long long frameStart = s_frameStarts[(frameCount - 2) % FRAME_HISTORY];
+		long long frameEnd = s_frameStarts[(frameCount - 1) % FRAME_HISTORY];
+		float frameMs = (frameEnd - frameStart) / 1000000.0f;
+		ImGui::Text("Frame: %.3f ms", frameMs);
+
+		const float ROW_HEIGHT = 18.0f;
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		float width = ImGui::GetContentRegionAvail().x;
+		float nsToPixels = width / (float)(frameEnd - frameStart);
+
+		for (CpuThreadBuffer* buffer : visibleBuffers())
+		{
+			std::vector<CpuZoneEvent> events = snapshot(*buffer);
+			int maxDepth = -1;
+			for (const CpuZoneEvent& event : events)
+			{
+				if (event.end > frameStart && event.start < frameEnd && event.depth > maxDepth)
+					maxDepth = event.depth;
+			}
+			if (maxDepth < 0)
+				continue;
+
+			ImGui::Text("%s", buffer->name.c_str());
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			float laneHeight = (maxDepth + 1) * ROW_HEIGHT;
+			drawList->PushClipRect(origin, ImVec2(origin.x + width, origin.y + laneHeight), true);
+			for (const CpuZoneEvent& event : events)
+			{
+				if (event.end <= frameStart || event.start >= frameEnd)
+					continue;
+				ImVec2 min = ImVec2(origin.x + (event.start - frameStart) * nsToPixels, origin.y + event.depth * ROW_HEIGHT);
+				ImVec2 max = ImVec2(origin.x + (event.end - frameStart) * nsToPixels, min.y + ROW_HEIGHT - 1.0f);
+				//Color by name so the same zone keeps its color between frames
+				unsigned int hash = (unsigned int)(size_t)event.name * 2654435761u;
+				ImU32 color = IM_COL32(100 + (hash >> 8) % 120, 100 + (hash >> 16) % 120, 100 + (hash >> 24) % 120, 255);
+				drawList->AddRectFilled(min, max, color);
+				if (max.x - min.x > 30.0f)
+					drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), event.name);
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.start) / 1000000.0f);
+			}
+			drawList->PopClipRect();
+			ImGui::Dummy(ImVec2(width, laneHeight));
+		}
+		ImGui::End();
+	}
+
+	float cpuProfilerMeasureOverhead(int zones)
+	{
+		//Own thread writing its own ring, so the test zones don't flush the visible rings or add a row
+		std::lock_guard<std::mutex> lock(s_overheadMutex);
+		long long elapsed = 0;
+		std::thread thread([&]() {
+			t_buffer = &s_overheadBuffer;
+			long long start = now();
+			for (int i = 0; i < zones; i++)
+			{
+				CpuZone zone("Overhead");
+			}
+			elapsed = now() - start;
+		});
+		thread.join();
+		return (float)elapsed / zones;
+	}
+}
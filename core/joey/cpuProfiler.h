@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+// Compiled in by the JOEY_CPU_PROFILER CMake option. When off, zones expand to nothing
+#ifndef JOEY_CPU_PROFILER
+#define JOEY_CPU_PROFILER 0
+#endif
+
+#define JOEY_CPU_CONCAT_INNER(a, b) a##b
+#define JOEY_CPU_CONCAT(a, b) JOEY_CPU_CONCAT_INNER(a, b)
+
+#if JOEY_CPU_PROFILER
+// Times the rest of the enclosing scope. name must outlive the profiler, e.g. a string literal
+#define JOEY_CPU_ZONE(name) joey::CpuZone JOEY_CPU_CONCAT(cpuZone, __LINE__)(name)
+// Call once per frame on the main thread, frames bound the flame view
+#define JOEY_CPU_FRAME() joey::cpuProfilerFrameMark()
+#else
+#define JOEY_CPU_ZONE(name) (void)0
+#define JOEY_CPU_FRAME() (void)0
+#endif
+
+namespace joey
+{
+	// Scoped CPU timing zone. Each thread records into its own ring of the last
+	// RING_SIZE zones, so recording takes no locks and older zones are overwritten
+	struct CpuZone {
+		static const int RING_SIZE = 16384;
+
+		explicit CpuZone(const char* name);
+		~CpuZone();
+		CpuZone(const CpuZone&) = delete;
+		CpuZone& operator=(const CpuZone&) = delete;
+	private:
+		const char* m_name;
+		long long m_start;
+	};
+
+	void cpuProfilerFrameMark();
+	// Shown as the lane title in the flame view and trace. Call from the thread being named
+	void cpuProfilerSetThreadName(const char* name);
+	// Persistent copy of a runtime name, for zones named by e.g. render graph passes
+	const char* cpuProfilerIntern(const std::string& name);
+
+	// Chrome / Perfetto trace event JSON of every zone still in the rings
+	bool cpuProfilerExportTrace(const char* filePath);
+	// Window with the zones of the last complete frame, one lane per thread
+	void cpuProfilerDrawFlameView(const char* title = "CPU Flame View");
+	// Mean cost of an empty zone in nanoseconds, measured on a separate thread
+	float cpuProfilerMeasureOverhead(int zones = 1000000);
+}
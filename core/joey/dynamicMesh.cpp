@@ -0,0 +1,170 @@
+#include "dynamicMesh.h"
+#include "jobSystem.h"
+#include "renderStats.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace joey
+{
+	DynamicMesh::DynamicMesh(const ew::MeshData& meshData, int framesInFlight)
+		: m_vertices(meshData.vertices), m_indices(meshData.indices)
+	{
+		m_copyCount = std::min(std::max(framesInFlight, 1), MAX_COPIES);
+		for (DirtyRange& dirty : m_dirty)
+		{
+			dirty = { 0, 0 };
+		}
+
+		//Which triangles touch each vertex, so normals can be gathered per vertex without write races
+		m_triangleOffsets.assign(m_vertices.size() + 1, 0);
+		for (unsigned int index : m_indices)
+		{
+			m_triangleOffsets[index + 1]++;
+		}
+		for (size_t i = 1; i < m_triangleOffsets.size(); i++)
+		{
+			m_triangleOffsets[i] += m_triangleOffsets[i - 1];
+		}
+		m_vertexTriangles.resize(m_indices.size());
+		std::vector<unsigned int> cursor(m_triangleOffsets.begin(), m_triangleOffsets.end() - 1);
+		for (size_t i = 0; i < m_indices.size(); i++)
+		{
+			m_vertexTriangles[cursor[m_indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		size_t copyBytes = sizeof(ew::Vertex) * m_vertices.size();
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &m_vbo);
+		glNamedBufferStorage(m_vbo, copyBytes * m_copyCount, NULL, flags);
+		m_mapped = (ew::Vertex*)glMapNamedBufferRange(m_vbo, 0, copyBytes * m_copyCount, flags);
+		if (!m_mapped)
+			printf("DynamicMesh failed to map %zu bytes\n", copyBytes * m_copyCount);
+		for (int i = 0; m_mapped && i < m_copyCount; i++)
+		{
+			memcpy(m_mapped + m_vertices.size() * i, m_vertices.data(), copyBytes);
+		}
+		glCreateBuffers(1, &m_ebo);
+		glNamedBufferStorage(m_ebo, sizeof(unsigned int) * m_indices.size(), m_indices.data(), 0);
+
+		glCreateVertexArrays(1, &m_vao);
+		//Position, normal, UV, same locations as ew::Mesh
+		glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, pos));
+		glVertexArrayAttribFormat(m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, normal));
+		glVertexArrayAttribFormat(m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, uv));
+		for (int i = 0; i < 3; i++)
+		{
+			glVertexArrayAttribBinding(m_vao, i, 0);
+			glEnableVertexArrayAttrib(m_vao, i);
+		}
+		//Copies are picked with baseVertex at draw time, so the binding never changes
+		glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(ew::Vertex));
+		glVertexArrayElementBuffer(m_vao, m_ebo);
+	}
+
+	DynamicMesh::~DynamicMesh()
+	{
+		for (void* fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync((GLsync)fence);
+		}
+		glDeleteVertexArrays(1, &m_vao);
+		glUnmapNamedBuffer(m_vbo);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+	}
+
+	void DynamicMesh::markDirty(unsigned int first, unsigned int count)
+	{
+		unsigned int end = (unsigned int)std::min((size_t)first + count, m_vertices.size());
+		if (first >= end)
+			return;
+		//Every copy is missing this edit until it is next written
+		for (int i = 0; i < m_copyCount; i++)
+		{
+			DirtyRange& dirty = m_dirty[i];
+			if (dirty.first >= dirty.end) {
+				dirty = { first, end };
+				continue;
+			}
+			dirty.first = std::min(dirty.first, first);
+			dirty.end = std::max(dirty.end, end);
+		}
+	}
+
+	void DynamicMesh::recomputeNormals(JobSystem* jobs, unsigned int first, unsigned int count)
+	{
+		unsigned int end = (unsigned int)std::min((size_t)first + count, m_vertices.size());
+		if (first >= end)
+			return;
+		//Each vertex only writes itself, so any split of the range is safe
+		auto body = [this, first](int from, int to) {
+			for (unsigned int v = first + from; v < first + (unsigned int)to; v++)
+			{
+				glm::vec3 normal = glm::vec3(0);
+				for (unsigned int t = m_triangleOffsets[v]; t < m_triangleOffsets[v + 1]; t++)
+				{
+					const unsigned int* triangle = &m_indices[m_vertexTriangles[t] * 3];
+					glm::vec3 a = m_vertices[triangle[0]].pos;
+					//Unnormalized, so larger triangles weigh more
+					normal += glm::cross(m_vertices[triangle[1]].pos - a, m_vertices[triangle[2]].pos - a);
+				}
+				float length = glm::length(normal);
+				if (length > 0.0f)
+					m_vertices[v].normal = normal / length;
+			}
+		};
+		if (jobs)
+			jobs->parallelFor((int)(end - first), 4096, body);
+		else
+			body(0, (int)(end - first));
+		markDirty(first, end - first);
+	}
+
+	void DynamicMesh::update()
+	{
+		//Everything drawn so far reads the current copy
+		if (m_fences[m_copy])
+			glDeleteSync((GLsync)m_fences[m_copy]);
+		m_fences[m_copy] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		m_copy = (m_copy + 1) % m_copyCount;
+		m_lastUploadBytes = 0;
+		DirtyRange& dirty = m_dirty[m_copy];
+		if (dirty.first >= dirty.end || !m_mapped)
+			return;
+
+		GLsync fence = (GLsync)m_fences[m_copy];
+		if (fence) {
+			//Usually signaled long ago, only block when the GPU is framesInFlight behind
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED) {
+				auto start = std::chrono::steady_clock::now();
+				do {
+					result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+				} while (result == GL_TIMEOUT_EXPIRED);
+				m_stallCount++;
+				m_lastStallMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+			glDeleteSync(fence);
+			m_fences[m_copy] = nullptr;
+		}
+
+		//Coherent, so draws issued after this see the write without a flush
+		ew::Vertex* copy = m_mapped + m_vertices.size() * m_copy;
+		m_lastUploadBytes = sizeof(ew::Vertex) * (dirty.end - dirty.first);
+		memcpy(copy + dirty.first, &m_vertices[dirty.first], m_lastUploadBytes);
+		dirty = { 0, 0 };
+	}
+
+	void DynamicMesh::draw(int baseInstance) const
+	{
+		bindVertexArray(m_vao);
+		renderStatsDraw(GL_TRIANGLES, (int)m_indices.size());
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (int)m_indices.size(), GL_UNSIGNED_INT, NULL, 1,
+			(int)m_vertices.size() * m_copy, baseInstance);
+	}
+}
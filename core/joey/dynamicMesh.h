@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include <stddef.h>
+#include <vector>
+
+namespace joey
+{
+	class JobSystem;
+
+	// Mesh whose vertices are edited every frame, e.g. a deforming grid. A persistently mapped,
+	// coherent buffer holds one copy of the vertices per frame in flight, each guarded by a fence
+	// like StreamBuffer's regions. update() copies the ranges edited since the next copy was last
+	// written straight into it, waiting only if the GPU is still reading that copy. Draws in flight
+	// keep reading the older copies, so edits don't wait on them. Indices never change
+	class DynamicMesh {
+	public:
+		static const int MAX_COPIES = 4;
+
+		DynamicMesh(const ew::MeshData& meshData, int framesInFlight = 3);
+		~DynamicMesh();
+		DynamicMesh(const DynamicMesh&) = delete;
+		DynamicMesh& operator=(const DynamicMesh&) = delete;
+
+		// CPU copy to edit, then markDirty what changed
+		inline std::vector<ew::Vertex>& getVertices() { return m_vertices; }
+		void markDirty(unsigned int first, unsigned int count);
+		// Area weighted normals from the current positions for vertices [first, first + count),
+		// split across jobs when given. Marks them dirty
+		void recomputeNormals(JobSystem* jobs = nullptr, unsigned int first = 0, unsigned int count = 0xFFFFFFFF);
+		// Uploads the edits into the next copy, draws after this read it
+		void update();
+		// baseInstance as in ew::Mesh::draw(DrawMode, int)
+		void draw(int baseInstance = 0)const;
+
+		inline unsigned int getVertexCount()const { return (unsigned int)m_vertices.size(); }
+		// Bytes the last update() uploaded
+		inline size_t getLastUploadBytes()const { return m_lastUploadBytes; }
+		// Updates that had to wait for the GPU to finish with a copy, and how long the last one waited
+		inline int getStallCount()const { return m_stallCount; }
+		inline float getLastStallMs()const { return m_lastStallMs; }
+	private:
+		//Vertices [first, end) not yet written to a copy, empty when first >= end
+		struct DirtyRange {
+			unsigned int first;
+			unsigned int end;
+		};
+
+		std::vector<ew::Vertex> m_vertices;
+		std::vector<unsigned int> m_indices;
+		//Triangles touching vertex v are m_vertexTriangles[m_triangleOffsets[v]] up to m_triangleOffsets[v + 1]
+		std::vector<unsigned int> m_triangleOffsets;
+		std::vector<unsigned int> m_vertexTriangles;
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		ew::Vertex* m_mapped = nullptr;
+		int m_copyCount;
+		int m_copy = 0; //The copy draws read
+		DirtyRange m_dirty[MAX_COPIES];
+		void* m_fences[MAX_COPIES] = {};
+		size_t m_lastUploadBytes = 0;
+		int m_stallCount = 0;
+		float m_lastStallMs = 0.0f;
+	};
+}
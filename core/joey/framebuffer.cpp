@@ -0,0 +1,118 @@
+#include "framebuffer.h"
+#include <stdio.h>
+
+namespace joey
+{
+	Framebuffer createFramebuffer(unsigned int width, unsigned int height, int colorFormat)
+	{
+		return createFramebuffer(width, height, &colorFormat, 1, GL_DEPTH_COMPONENT16);
+	}
+
+	Framebuffer createFramebuffer(unsigned int width, unsigned int height, const int* colorFormats, int numColors, int depthFormat)
+	{
+		unsigned int colorTextures[MAX_COLOR_ATTACHMENTS];
+		for (int i = 0; i < numColors && i < MAX_COLOR_ATTACHMENTS; i++)
+		{
+			colorTextures[i] = createRenderTexture(width, height, colorFormats[i]);
+		}
+		unsigned int depthTexture = depthFormat ? createRenderTexture(width, height, depthFormat, GL_NEAREST) : 0;
+		return createFramebufferFromTextures(width, height, colorTextures, numColors, depthTexture);
+	}
+
+	Framebuffer createFramebufferFromTextures(unsigned int width, unsigned int height, const unsigned int* colorTextures, int numColors, unsigned int depthTexture)
+	{
+		Framebuffer buffer;
+		buffer.width = width;
+		buffer.height = height;
+		buffer.numColorBuffers = numColors < MAX_COLOR_ATTACHMENTS ? numColors : MAX_COLOR_ATTACHMENTS;
+		buffer.depthBuffer = depthTexture;
+
+		glCreateFramebuffers(1, &buffer.fbo);
+
+		//Attach each texture to a different slot, GL_COLOR_ATTACHMENT0 + 1 = GL_COLOR_ATTACHMENT1, etc
+		GLenum drawBuffers[MAX_COLOR_ATTACHMENTS];
+		for (unsigned int i = 0; i < buffer.numColorBuffers; i++)
+		{
+			buffer.colorBuffer[i] = colorTextures[i];
+			glNamedFramebufferTexture(buffer.fbo, GL_COLOR_ATTACHMENT0 + i, colorTextures[i], 0);
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		if (buffer.numColorBuffers > 0) {
+			glNamedFramebufferDrawBuffers(buffer.fbo, buffer.numColorBuffers, drawBuffers);
+		}
+		else {
+			//Depth only, e.g. shadow maps
+			glNamedFramebufferDrawBuffer(buffer.fbo, GL_NONE);
+			glNamedFramebufferReadBuffer(buffer.fbo, GL_NONE);
+		}
+
+		if (depthTexture) {
+			glNamedFramebufferTexture(buffer.fbo, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+		}
+
+		GLenum status = glCheckNamedFramebufferStatus(buffer.fbo, GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Framebuffer incomplete: %d\n", status);
+		}
+		return buffer;
+	}
+
+	void deleteFramebuffer(Framebuffer* framebuffer)
+	{
+		glDeleteTextures(framebuffer->numColorBuffers, framebuffer->colorBuffer);
+		if (framebuffer->depthBuffer) {
+			glDeleteTextures(1, &framebuffer->depthBuffer);
+		}
+		glDeleteFramebuffers(1, &framebuffer->fbo);
+		*framebuffer = Framebuffer();
+	}
+
+	unsigned int createRenderTexture(unsigned int width, unsigned int height, int format, int filter)
+	{
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, 1, format, width, height);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+		//Clamp so post processing never wraps around the screen edge
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+
+	size_t getFormatBytesPerPixel(int format)
+	{
+		switch (format) {
+		case GL_R8:
+			return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGB8:
+			return 3;
+		case GL_RGBA8:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB10_A2:
+		case GL_DEPTH_COMPONENT24: //Padded to 32 bits by drivers
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return 4;
+		case GL_RGB16F:
+			return 6;
+		case GL_RGBA16:
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGB32F:
+			return 12;
+		case GL_RGBA32F:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+}
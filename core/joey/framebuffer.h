@@ -1,15 +1,32 @@
 #pragma once
 
 #include "../ew/external/glad.h"
+#include <stddef.h>
 
 namespace joey 
 {
+	const int MAX_COLOR_ATTACHMENTS = 8;
+
 	struct Framebuffer {
-		unsigned int fbo;
-		unsigned int colorBuffer[8];
-		unsigned int depthBuffer;
-		unsigned int width;
-		unsigned int height;
+		unsigned int fbo = 0;
+		unsigned int colorBuffer[MAX_COLOR_ATTACHMENTS] = {};
+		unsigned int depthBuffer = 0;
+		unsigned int numColorBuffers = 0;
+		unsigned int width = 0;
+		unsigned int height = 0;
 	};
+
+	// Single color attachment + 16 bit depth, both width x height
 	Framebuffer createFramebuffer(unsigned int width, unsigned int height, int colorFormat);
-}
\ No newline at end of file
+	// numColors color attachments (may be 0), depthFormat 0 for no depth attachment
+	Framebuffer createFramebuffer(unsigned int width, unsigned int height, const int* colorFormats, int numColors, int depthFormat);
+	// Builds the fbo around existing textures, which stay owned by the caller
+	Framebuffer createFramebufferFromTextures(unsigned int width, unsigned int height, const unsigned int* colorTextures, int numColors, unsigned int depthTexture);
+	// Deletes the fbo and its attachments
+	void deleteFramebuffer(Framebuffer* framebuffer);
+
+	// Immutable 1 level texture with linear filtering and clamp to edge
+	unsigned int createRenderTexture(unsigned int width, unsigned int height, int format, int filter = GL_LINEAR);
+	// Approximate storage cost of one texel of a sized internal format
+	size_t getFormatBytesPerPixel(int format);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace joey
+{
+	// View frustum as 6 inward facing planes (xyz = normal, w = distance), extracted from a view projection matrix
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		static inline Frustum fromMatrix(const glm::mat4& viewProjection) {
+			Frustum frustum;
+			//Gribb/Hartmann: rows of the matrix combined give the clip planes
+			for (int i = 0; i < 3; i++)
+			{
+				glm::vec4 row = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+				glm::vec4 w = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+				frustum.planes[i * 2 + 0] = w + row;
+				frustum.planes[i * 2 + 1] = w - row;
+			}
+			for (int i = 0; i < 6; i++)
+			{
+				frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+			}
+			return frustum;
+		}
+
+		inline bool intersectsSphere(const glm::vec3& center, float radius)const {
+			for (int i = 0; i < 6; i++)
+			{
+				if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+					return false;
+			}
+			return true;
+		}
+
+		inline bool intersectsAABB(const glm::vec3& min, const glm::vec3& max)const {
+			for (int i = 0; i < 6; i++)
+			{
+				//Test the corner furthest along the plane normal
+				glm::vec3 p = glm::vec3(
+					planes[i].x >= 0 ? max.x : min.x,
+					planes[i].y >= 0 ? max.y : min.y,
+					planes[i].z >= 0 ? max.z : min.z);
+				if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0)
+					return false;
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,349 @@
+#include "geometryPool.h"
+#include "renderStats.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <stddef.h>
+
+namespace joey
+{
+	void RangeAllocator::reset(unsigned int capacity, unsigned int used)
+	{
+		m_capacity = capacity;
+		m_freeCount = capacity - used;
+		m_free.clear();
+		if (m_freeCount > 0)
+			m_free.push_back({ used, m_freeCount });
+	}
+
+	unsigned int RangeAllocator::allocate(unsigned int count)
+	{
+		if (count == 0)
+			return 0;
+		for (size_t i = 0; i < m_free.size(); i++)
+		{
+			Range& range = m_free[i];
+			if (range.count < count)
+				continue;
+			unsigned int offset = range.offset;
+			range.offset += count;
+			range.count -= count;
+			if (range.count == 0)
+				m_free.erase(m_free.begin() + i);
+			m_freeCount -= count;
+			return offset;
+		}
+		return INVALID;
+	}
+
+	void RangeAllocator::free(unsigned int offset, unsigned int count)
+	{
+		if (count == 0)
+			return;
+		m_freeCount += count;
+		size_t i = 0;
+		while (i < m_free.size() && m_free[i].offset < offset)
+			i++;
+		//Merge into the range before and/or after instead of inserting when they touch
+		bool joinsPrev = i > 0 && m_free[i - 1].offset + m_free[i - 1].count == offset;
+		bool joinsNext = i < m_free.size() && offset + count == m_free[i].offset;
+		if (joinsPrev && joinsNext) {
+			m_free[i - 1].count += count + m_free[i].count;
+			m_free.erase(m_free.begin() + i);
+		}
+		else if (joinsPrev) {
+			m_free[i - 1].count += count;
+		}
+		else if (joinsNext) {
+			m_free[i].offset = offset;
+			m_free[i].count += count;
+		}
+		else {
+			m_free.insert(m_free.begin() + i, { offset, count });
+		}
+	}
+
+	GeometryPool::GeometryPool(unsigned int maxVertices, unsigned int maxIndices, bool positionStream)
+		: m_vertexRanges(maxVertices), m_indexRanges(maxIndices), m_positionRanges(positionStream ? maxVertices : 0)
+	{
+		glCreateVertexArrays(1, &m_vao);
+		//Position, normal, UV, same locations as ew::Mesh
+		glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, pos));
+		glVertexArrayAttribFormat(m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, normal));
+		glVertexArrayAttribFormat(m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, uv));
+		for (int i = 0; i < 3; i++)
+		{
+			glVertexArrayAttribBinding(m_vao, i, 0);
+			glEnableVertexArrayAttrib(m_vao, i);
+		}
+		createBuffers(m_vbo, m_ebo);
+		if (positionStream) {
+			glCreateVertexArrays(1, &m_positionVao);
+			glVertexArrayAttribFormat(m_positionVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribBinding(m_positionVao, 0, 0);
+			glEnableVertexArrayAttrib(m_positionVao, 0);
+			createPositionBuffers(m_positionVbo, m_positionEbo);
+		}
+		bindBuffers();
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+		glDeleteVertexArrays(1, &m_positionVao);
+		glDeleteBuffers(1, &m_positionVbo);
+		glDeleteBuffers(1, &m_positionEbo);
+	}
+
+	void GeometryPool::createBuffers(unsigned int& vbo, unsigned int& ebo) const
+	{
+		glCreateBuffers(1, &vbo);
+		glNamedBufferStorage(vbo, sizeof(ew::Vertex) * m_vertexRanges.getCapacity(), NULL, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &ebo);
+		glNamedBufferStorage(ebo, sizeof(unsigned int) * m_indexRanges.getCapacity(), NULL, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	//A mesh has as many position indices as regular ones, so both index buffers share m_indexRanges
+	void GeometryPool::createPositionBuffers(unsigned int& vbo, unsigned int& ebo) const
+	{
+		glCreateBuffers(1, &vbo);
+		glNamedBufferStorage(vbo, sizeof(glm::vec3) * m_positionRanges.getCapacity(), NULL, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &ebo);
+		glNamedBufferStorage(ebo, sizeof(unsigned int) * m_indexRanges.getCapacity(), NULL, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	void GeometryPool::bindBuffers()
+	{
+		glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(ew::Vertex));
+		glVertexArrayElementBuffer(m_vao, m_ebo);
+		if (m_positionVao) {
+			glVertexArrayVertexBuffer(m_positionVao, 0, m_positionVbo, 0, sizeof(glm::vec3));
+			glVertexArrayElementBuffer(m_positionVao, m_positionEbo);
+		}
+	}
+
+	int GeometryPool::add(const ew::MeshData& meshData)
+	{
+		unsigned int vertexCount = (unsigned int)meshData.vertices.size();
+		unsigned int indexCount = (unsigned int)meshData.indices.size();
+		ew::PositionMeshData positionData;
+		if (m_positionVao)
+			positionData = ew::createPositionStream(meshData);
+		unsigned int positionCount = (unsigned int)positionData.positions.size();
+		if (vertexCount > m_vertexRanges.getFreeCount() || indexCount > m_indexRanges.getFreeCount() || positionCount > m_positionRanges.getFreeCount()) {
+			printf("GeometryPool full, %u vertices and %u indices requested, %u and %u free\n",
+				vertexCount, indexCount, m_vertexRanges.getFreeCount(), m_indexRanges.getFreeCount());
+			return -1;
+		}
+		unsigned int firstVertex = m_vertexRanges.allocate(vertexCount);
+		unsigned int firstIndex = m_indexRanges.allocate(indexCount);
+		unsigned int firstPosition = m_positionRanges.allocate(positionCount);
+		if (firstVertex == RangeAllocator::INVALID || firstIndex == RangeAllocator::INVALID || firstPosition == RangeAllocator::INVALID) {
+			//Enough space in total, just not in one piece
+			if (firstVertex != RangeAllocator::INVALID)
+				m_vertexRanges.free(firstVertex, vertexCount);
+			if (firstIndex != RangeAllocator::INVALID)
+				m_indexRanges.free(firstIndex, indexCount);
+			if (firstPosition != RangeAllocator::INVALID)
+				m_positionRanges.free(firstPosition, positionCount);
+			defragment();
+			firstVertex = m_vertexRanges.allocate(vertexCount);
+			firstIndex = m_indexRanges.allocate(indexCount);
+			firstPosition = m_positionRanges.allocate(positionCount);
+		}
+
+		PoolMesh mesh;
+		mesh.firstVertex = firstVertex;
+		mesh.vertexCount = vertexCount;
+		mesh.firstIndex = firstIndex;
+		mesh.indexCount = indexCount;
+		mesh.firstPosition = firstPosition;
+		mesh.positionCount = positionCount;
+		mesh.live = true;
+		if (vertexCount > 0)
+			glNamedBufferSubData(m_vbo, sizeof(ew::Vertex) * firstVertex, sizeof(ew::Vertex) * vertexCount, meshData.vertices.data());
+		if (indexCount > 0)
+			glNamedBufferSubData(m_ebo, sizeof(unsigned int) * firstIndex, sizeof(unsigned int) * indexCount, meshData.indices.data());
+		if (positionCount > 0) {
+			glNamedBufferSubData(m_positionVbo, sizeof(glm::vec3) * firstPosition, sizeof(glm::vec3) * positionCount, positionData.positions.data());
+			glNamedBufferSubData(m_positionEbo, sizeof(unsigned int) * firstIndex, sizeof(unsigned int) * indexCount, positionData.indices.data());
+		}
+
+		if (!m_freeHandles.empty()) {
+			int handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+			m_meshes[handle] = mesh;
+			//Commands built under the handle's previous mesh are stale
+			m_generation++;
+			return handle;
+		}
+		m_meshes.push_back(mesh);
+		return (int)m_meshes.size() - 1;
+	}
+
+	void GeometryPool::remove(int mesh)
+	{
+		PoolMesh& entry = m_meshes[mesh];
+		if (!entry.live)
+			return;
+		m_vertexRanges.free(entry.firstVertex, entry.vertexCount);
+		m_indexRanges.free(entry.firstIndex, entry.indexCount);
+		m_positionRanges.free(entry.firstPosition, entry.positionCount);
+		entry.live = false;
+		m_freeHandles.push_back(mesh);
+		m_generation++;
+	}
+
+	void GeometryPool::defragment()
+	{
+		if (m_vertexRanges.getFreeRangeCount() <= 1 && m_indexRanges.getFreeRangeCount() <= 1 && m_positionRanges.getFreeRangeCount() <= 1)
+			return;
+		//Copy into fresh buffers rather than in place, source and destination ranges may overlap
+		unsigned int vbo, ebo, positionVbo = 0, positionEbo = 0;
+		createBuffers(vbo, ebo);
+		if (m_positionVao)
+			createPositionBuffers(positionVbo, positionEbo);
+		unsigned int vertexHead = 0, indexHead = 0, positionHead = 0;
+		for (PoolMesh& mesh : m_meshes)
+		{
+			if (!mesh.live)
+				continue;
+			if (mesh.vertexCount > 0)
+				glCopyNamedBufferSubData(m_vbo, vbo, sizeof(ew::Vertex) * mesh.firstVertex, sizeof(ew::Vertex) * vertexHead, sizeof(ew::Vertex) * mesh.vertexCount);
+			if (mesh.indexCount > 0)
+				glCopyNamedBufferSubData(m_ebo, ebo, sizeof(unsigned int) * mesh.firstIndex, sizeof(unsigned int) * indexHead, sizeof(unsigned int) * mesh.indexCount);
+			if (mesh.positionCount > 0) {
+				glCopyNamedBufferSubData(m_positionVbo, positionVbo, sizeof(glm::vec3) * mesh.firstPosition, sizeof(glm::vec3) * positionHead, sizeof(glm::vec3) * mesh.positionCount);
+				glCopyNamedBufferSubData(m_positionEbo, positionEbo, sizeof(unsigned int) * mesh.firstIndex, sizeof(unsigned int) * indexHead, sizeof(unsigned int) * mesh.indexCount);
+			}
+			mesh.firstVertex = vertexHead;
+			mesh.firstIndex = indexHead;
+			mesh.firstPosition = positionHead;
+			vertexHead += mesh.vertexCount;
+			indexHead += mesh.indexCount;
+			positionHead += mesh.positionCount;
+		}
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+		glDeleteBuffers(1, &m_positionVbo);
+		glDeleteBuffers(1, &m_positionEbo);
+		m_vbo = vbo;
+		m_ebo = ebo;
+		m_positionVbo = positionVbo;
+		m_positionEbo = positionEbo;
+		bindBuffers();
+		m_vertexRanges.reset(m_vertexRanges.getCapacity(), vertexHead);
+		m_indexRanges.reset(m_indexRanges.getCapacity(), indexHead);
+		m_positionRanges.reset(m_positionRanges.getCapacity(), positionHead);
+		m_generation++;
+	}
+
+	DrawElementsIndirectCommand GeometryPool::getCommand(int mesh, int baseInstance, bool positions) const
+	{
+		const PoolMesh& entry = m_meshes[mesh];
+		DrawElementsIndirectCommand command;
+		//Removed meshes draw nothing instead of whatever now occupies their range
+		command.count = entry.live ? entry.indexCount : 0;
+		command.instanceCount = 1;
+		command.firstIndex = entry.firstIndex;
+		command.baseVertex = (int)(positions ? entry.firstPosition : entry.firstVertex);
+		command.baseInstance = (unsigned int)baseInstance;
+		return command;
+	}
+
+	void GeometryPool::bind() const
+	{
+		bindVertexArray(m_vao);
+	}
+
+	void GeometryPool::bindPositions() const
+	{
+		bindVertexArray(m_positionVao);
+	}
+
+	void GeometryPool::draw(int mesh, int baseInstance) const
+	{
+		const PoolMesh& entry = m_meshes[mesh];
+		if (!entry.live)
+			return;
+		bind();
+		renderStatsDraw(GL_TRIANGLES, entry.indexCount);
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, entry.indexCount, GL_UNSIGNED_INT,
+			(const void*)(sizeof(unsigned int) * entry.firstIndex), 1, (int)entry.firstVertex, baseInstance);
+	}
+
+	DrawList::~DrawList()
+	{
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	void DrawList::clear()
+	{
+		m_draws.clear();
+		m_dirty = true;
+	}
+
+	void DrawList::add(int mesh, int baseInstance)
+	{
+		m_draws.push_back({ mesh, baseInstance });
+		m_dirty = true;
+	}
+
+	void DrawList::upload(const GeometryPool& pool)
+	{
+		size_t commandCount = m_draws.size() * (pool.hasPositionStream() ? 2 : 1);
+		if (commandCount > m_capacity) {
+			//Immutable storage can't grow, replace it
+			glDeleteBuffers(1, &m_buffer);
+			m_capacity = commandCount * 2;
+			glCreateBuffers(1, &m_buffer);
+			glNamedBufferStorage(m_buffer, sizeof(DrawElementsIndirectCommand) * m_capacity, NULL, GL_DYNAMIC_STORAGE_BIT);
+		}
+		std::vector<DrawElementsIndirectCommand> commands(commandCount);
+		m_indexCount = 0;
+		for (size_t i = 0; i < m_draws.size(); i++)
+		{
+			commands[i] = pool.getCommand(m_draws[i].mesh, m_draws[i].baseInstance);
+			m_indexCount += commands[i].count;
+		}
+		for (size_t i = m_draws.size(); i < commandCount; i++)
+		{
+			const Draw& draw = m_draws[i - m_draws.size()];
+			commands[i] = pool.getCommand(draw.mesh, draw.baseInstance, true);
+		}
+		glNamedBufferSubData(m_buffer, 0, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data());
+		m_dirty = false;
+		m_pool = &pool;
+		m_poolGeneration = pool.getGeneration();
+	}
+
+	void DrawList::submit(const GeometryPool& pool)
+	{
+		issue(pool, false);
+	}
+
+	void DrawList::submitPositions(const GeometryPool& pool)
+	{
+		issue(pool, pool.hasPositionStream());
+	}
+
+	void DrawList::issue(const GeometryPool& pool, bool positions)
+	{
+		if (m_draws.empty())
+			return;
+		if (m_dirty || m_pool != &pool || m_poolGeneration != pool.getGeneration())
+			upload(pool);
+		size_t offset = 0;
+		if (positions) {
+			pool.bindPositions();
+			offset = sizeof(DrawElementsIndirectCommand) * m_draws.size();
+		}
+		else {
+			pool.bind();
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+		renderStatsMultiDraw(GL_TRIANGLES, (int)m_draws.size(), m_indexCount);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, (int)m_draws.size(), 0);
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include <vector>
+
+namespace joey
+{
+	// Layout glMultiDrawElementsIndirect reads commands in
+	struct DrawElementsIndirectCommand {
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	// First fit suballocator over [0, capacity), in whatever unit the caller uses.
+	// Free ranges are kept sorted and merged with their neighbours when freed
+	class RangeAllocator {
+	public:
+		static const unsigned int INVALID = 0xFFFFFFFF;
+
+		RangeAllocator(unsigned int capacity = 0) { reset(capacity, 0); }
+		// Everything free except [0, used)
+		void reset(unsigned int capacity, unsigned int used);
+		// Offset of count units, INVALID when no single free range is large enough
+		unsigned int allocate(unsigned int count);
+		void free(unsigned int offset, unsigned int count);
+
+		inline unsigned int getCapacity()const { return m_capacity; }
+		inline unsigned int getFreeCount()const { return m_freeCount; }
+		// More than one means free space is fragmented
+		inline int getFreeRangeCount()const { return (int)m_free.size(); }
+	private:
+		struct Range {
+			unsigned int offset;
+			unsigned int count;
+		};
+		std::vector<Range> m_free;
+		unsigned int m_capacity = 0;
+		unsigned int m_freeCount = 0;
+	};
+
+	// Where a mesh lives in the pool, in vertices and indices rather than bytes
+	struct PoolMesh {
+		unsigned int firstVertex = 0;
+		unsigned int vertexCount = 0;
+		unsigned int firstIndex = 0;
+		unsigned int indexCount = 0;
+		//Position stream, indices are at firstIndex in the position index buffer
+		unsigned int firstPosition = 0;
+		unsigned int positionCount = 0;
+		bool live = false;
+	};
+
+	// Shared vertex and index buffers for many meshes, all drawn through one vertex array with
+	// ew::Vertex's layout. Indices stay relative to their mesh and are offset by baseVertex at draw
+	// time, so defragment() can move meshes by copying bytes. Meshes are handles into a table and
+	// survive defragmenting, indirect commands built before it do not (see getGeneration).
+	// With a position stream, every mesh is also stored as deduplicated, tightly packed positions
+	// (ew::createPositionStream) behind a second vertex array, for depth only passes
+	class GeometryPool {
+	public:
+		GeometryPool(unsigned int maxVertices, unsigned int maxIndices, bool positionStream = false);
+		~GeometryPool();
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		// Uploads the mesh, defragmenting first if only fragmentation stands in the way.
+		// -1 when the pool is full
+		int add(const ew::MeshData& meshData);
+		// The handle draws nothing from then on and is handed out again by a later add(),
+		// so take it out of any DrawList before then
+		void remove(int mesh);
+		// Packs the live meshes to the front of both buffers, leaving one free range each
+		void defragment();
+
+		inline const PoolMesh& getMesh(int mesh)const { return m_meshes[mesh]; }
+		// positions = draw from the position stream, which must exist
+		DrawElementsIndirectCommand getCommand(int mesh, int baseInstance, bool positions = false)const;
+		// Binds the pool's vertex array, needed before any draw from it
+		void bind()const;
+		// Binds the position only vertex array, attribute 0 only
+		void bindPositions()const;
+		inline bool hasPositionStream()const { return m_positionVao != 0; }
+		// Single mesh without indirect commands, baseInstance as in ew::Mesh::draw(DrawMode, int)
+		void draw(int mesh, int baseInstance = 0)const;
+
+		inline unsigned int getVertexArray()const { return m_vao; }
+		// Bumped whenever meshes move, are removed or a handle is reused
+		inline int getGeneration()const { return m_generation; }
+		inline const RangeAllocator& getVertexRanges()const { return m_vertexRanges; }
+		inline const RangeAllocator& getIndexRanges()const { return m_indexRanges; }
+		inline const RangeAllocator& getPositionRanges()const { return m_positionRanges; }
+	private:
+		void createBuffers(unsigned int& vbo, unsigned int& ebo)const;
+		void createPositionBuffers(unsigned int& vbo, unsigned int& ebo)const;
+		void bindBuffers();
+
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		RangeAllocator m_vertexRanges;
+		RangeAllocator m_indexRanges;
+		unsigned int m_positionVao = 0;
+		unsigned int m_positionVbo = 0;
+		unsigned int m_positionEbo = 0;
+		RangeAllocator m_positionRanges;
+		std::vector<PoolMesh> m_meshes;
+		std::vector<int> m_freeHandles;
+		int m_generation = 0;
+	};
+
+	// Indirect commands for one glMultiDrawElementsIndirect over a GeometryPool.
+	// The command buffer is only rewritten when the list or the pool's layout changed, so a list
+	// built once can be submitted every frame for free
+	class DrawList {
+	public:
+		DrawList() {};
+		~DrawList();
+		DrawList(const DrawList&) = delete;
+		DrawList& operator=(const DrawList&) = delete;
+
+		void clear();
+		// baseInstance indexes the bound draw data (see drawData.glsl)
+		void add(int mesh, int baseInstance);
+		// Binds the pool and issues the whole list as one draw
+		void submit(const GeometryPool& pool);
+		// Same draws from the pool's position stream, for depth only passes. Falls back to submit without one
+		void submitPositions(const GeometryPool& pool);
+
+		inline int getDrawCount()const { return (int)m_draws.size(); }
+	private:
+		void upload(const GeometryPool& pool);
+		void issue(const GeometryPool& pool, bool positions);
+
+		struct Draw {
+			int mesh;
+			int baseInstance;
+		};
+		std::vector<Draw> m_draws;
+		unsigned int m_buffer = 0;
+		size_t m_capacity = 0; //Commands, the position stream's follow the regular ones
+		long long m_indexCount = 0;
+		bool m_dirty = true;
+		int m_poolGeneration = -1;
+		const GeometryPool* m_pool = nullptr;
+	};
+}
@@ -0,0 +1,265 @@
+#include "gpuProfiler.h"
+#include "jsonString.h"
+#include <stdio.h>
+#include <float.h>
+#include <algorithm>
+#include <imgui.h>
+
+namespace joey
+{
+	GpuProfiler::GpuProfiler()
+	{
+		//Software drivers may expose the query without a counter behind it
+		int counterBits = 0;
+		glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &counterBits);
+		m_supported = counterBits > 0;
+		if (!m_supported) {
+			printf("GpuProfiler: GL_TIME_ELAPSED has no counter bits, GPU timings disabled\n");
+			return;
+		}
+		for (Frame& frame : m_frames)
+		{
+			glGenQueries(MAX_PASSES_PER_FRAME, frame.queries);
+			glGenQueries(MAX_PASSES_PER_FRAME, frame.fragmentQueries);
+		}
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+		if (!m_supported)
+			return;
+		for (Frame& frame : m_frames)
+		{
+			glDeleteQueries(MAX_PASSES_PER_FRAME, frame.queries);
+			glDeleteQueries(MAX_PASSES_PER_FRAME, frame.fragmentQueries);
+		}
+	}
+
+	void GpuProfiler::beginFrame()
+	{
+		if (!m_supported)
+			return;
+		//This slot was last used FRAME_LATENCY frames ago, its results are usually in by now
+		Frame& frame = m_frames[m_frame % FRAME_LATENCY];
+		if (frame.pending && !collect(frame, false))
+			m_droppedFrames++;
+		frame.count = 0;
+		frame.pending = false;
+	}
+
+	void GpuProfiler::endFrame()
+	{
+		if (!m_supported)
+			return;
+		endPass();
+		m_frames[m_frame % FRAME_LATENCY].pending = true;
+		m_frame++;
+	}
+
+	void GpuProfiler::beginPass(const std::string& name)
+	{
+		if (!m_supported)
+			return;
+		endPass();
+		Frame& frame = m_frames[m_frame % FRAME_LATENCY];
+		if (frame.count >= MAX_PASSES_PER_FRAME)
+			return;
+
+		auto it = m_passIndices.find(name);
+		if (it == m_passIndices.end()) {
+			Pass pass;
+			pass.name = name;
+			m_passes.push_back(pass);
+			it = m_passIndices.insert({ name, (int)m_passes.size() - 1 }).first;
+		}
+		frame.passes[frame.count] = it->second;
+		glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+		glBeginQuery(GL_SAMPLES_PASSED, frame.fragmentQueries[frame.count]);
+		frame.count++;
+		m_passOpen = true;
+	}
+
+	void GpuProfiler::endPass()
+	{
+		if (!m_passOpen)
+			return;
+		glEndQuery(GL_TIME_ELAPSED);
+		glEndQuery(GL_SAMPLES_PASSED);
+		m_passOpen = false;
+	}
+
+	/// <summary>
+	/// Adds a finished frame's timings to the pass stats.
+	/// Without wait, returns false and discards the frame if any result isn't available yet.
+	/// </summary>
+	bool GpuProfiler::collect(Frame& frame, bool wait)
+	{
+		if (!wait) {
+			//The fragment query ended after the timer, so it's the one to check
+			for (int i = 0; i < frame.count; i++)
+			{
+				int available = 0;
+				glGetQueryObjectiv(frame.fragmentQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+					return false;
+			}
+		}
+
+		for (int i = 0; i < frame.count; i++)
+		{
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsedNs);
+			float ms = (float)(elapsedNs / 1000000.0);
+			GLuint64 fragments = 0;
+			glGetQueryObjectui64v(frame.fragmentQueries[i], GL_QUERY_RESULT, &fragments);
+
+			Pass& pass = m_passes[frame.passes[i]];
+			pass.minMs = pass.samples == 0 ? ms : std::min(pass.minMs, ms);
+			pass.lastMs = ms;
+			pass.totalMs += ms;
+			pass.samples++;
+			pass.lastFragments = (long long)fragments;
+			pass.totalFragments += (double)fragments;
+			pass.history[pass.historyHead] = ms;
+			pass.historyHead = (pass.historyHead + 1) % HISTORY_SIZE;
+		}
+		return true;
+	}
+
+	void GpuProfiler::resolve()
+	{
+		if (!m_supported)
+			return;
+		endPass();
+		//Oldest first so history stays in frame order
+		for (int i = 0; i < FRAME_LATENCY; i++)
+		{
+			Frame& frame = m_frames[(m_frame + i) % FRAME_LATENCY];
+			if (frame.pending)
+				collect(frame, true);
+			frame.pending = false;
+			frame.count = 0;
+		}
+	}
+
+	void GpuProfiler::clear()
+	{
+		m_passes.clear();
+		m_passIndices.clear();
+		m_droppedFrames = 0;
+		//Queries already issued would refer to the old passes
+		for (Frame& frame : m_frames)
+		{
+			frame.pending = false;
+			frame.count = 0;
+		}
+	}
+
+	long long GpuProfiler::getLastFragments(const std::string& name)const
+	{
+		auto it = m_passIndices.find(name);
+		return it == m_passIndices.end() ? 0 : m_passes[it->second].lastFragments;
+	}
+
+	float GpuProfiler::percentile(const Pass& pass, float p)const
+	{
+		int count = std::min(pass.samples, HISTORY_SIZE);
+		if (count == 0)
+			return 0.0f;
+		std::vector<float> sorted(pass.history, pass.history + count);
+		int index = std::min(count - 1, (int)(p * count));
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	}
+
+	std::vector<GpuPassStats> GpuProfiler::getPassStats()const
+	{
+		std::vector<GpuPassStats> stats;
+		for (const Pass& pass : m_passes)
+		{
+			GpuPassStats passStats;
+			passStats.name = pass.name;
+			passStats.samples = pass.samples;
+			passStats.lastMs = pass.lastMs;
+			passStats.minMs = pass.minMs;
+			passStats.meanMs = pass.samples > 0 ? (float)(pass.totalMs / pass.samples) : 0.0f;
+			passStats.p99Ms = percentile(pass, 0.99f);
+			passStats.lastFragments = pass.lastFragments;
+			passStats.meanFragments = pass.samples > 0 ? pass.totalFragments / pass.samples : 0.0;
+			stats.push_back(passStats);
+		}
+		return stats;
+	}
+
+	void GpuProfiler::drawUI(const char* title)const
+	{
+		ImGui::Begin(title);
+		if (!m_supported) {
+			ImGui::Text("Timer queries not supported");
+			ImGui::End();
+			return;
+		}
+
+		float totalMs = 0.0f;
+		for (const Pass& pass : m_passes)
+		{
+			totalMs += pass.lastMs;
+		}
+		ImGui::Text("Total: %.3f ms  (%d frames dropped)", totalMs, m_droppedFrames);
+		for (const Pass& pass : m_passes)
+		{
+			ImGui::Separator();
+			ImGui::Text("%s: %.3f ms, %lld fragments", pass.name.c_str(), pass.lastMs, pass.lastFragments);
+			ImGui::Text("min %.3f  mean %.3f  p99 %.3f", pass.minMs, pass.samples > 0 ? pass.totalMs / pass.samples : 0.0, percentile(pass, 0.99f));
+			//History is a ring, the head is the oldest sample once it has wrapped
+			int count = std::min(pass.samples, HISTORY_SIZE);
+			int offset = pass.samples >= HISTORY_SIZE ? pass.historyHead : 0;
+			ImGui::PlotLines(("##" + pass.name).c_str(), pass.history, count, offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+		}
+		ImGui::End();
+	}
+
+	bool GpuProfiler::exportCSV(const char* filePath)const
+	{
+		FILE* file = fopen(filePath, "w");
+		if (!file) {
+			printf("GpuProfiler: failed to open %s\n", filePath);
+			return false;
+		}
+		fprintf(file, "pass,samples,min_ms,mean_ms,p99_ms,mean_fragments\n");
+		for (const GpuPassStats& stats : getPassStats())
+		{
+			//Quotes inside a quoted field are doubled
+			std::string name;
+			for (char c : stats.name)
+			{
+				name += c;
+				if (c == '"')
+					name += c;
+			}
+			fprintf(file, "\"%s\",%d,%.4f,%.4f,%.4f,%.0f\n", name.c_str(), stats.samples, stats.minMs, stats.meanMs, stats.p99Ms, stats.meanFragments);
+		}
+		fclose(file);
+		return true;
+	}
+
+	bool GpuProfiler::exportJSON(const char* filePath)const
+	{
+		FILE* file = fopen(filePath, "w");
+		if (!file) {
+			printf("GpuProfiler: failed to open %s\n", filePath);
+			return false;
+		}
+		std::vector<GpuPassStats> passStats = getPassStats();
+		fprintf(file, "{\n\t\"droppedFrames\": %d,\n\t\"passes\": [\n", m_droppedFrames);
+		for (size_t i = 0; i < passStats.size(); i++)
+		{
+			const GpuPassStats& stats = passStats[i];
+			fprintf(file, "\t\t{ \"name\": %s, \"samples\": %d, \"minMs\": %.4f, \"meanMs\": %.4f, \"p99Ms\": %.4f, \"meanFragments\": %.0f }%s\n",
+				jsonString(stats.name).c_str(), stats.samples, stats.minMs, stats.meanMs, stats.p99Ms, stats.meanFragments, i + 1 < passStats.size() ? "," : "");
+		}
+		fprintf(file, "\t]\n}\n");
+		fclose(file);
+		return true;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../ew/external/glad.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	struct GpuPassStats {
+		std::string name;
+		int samples;
+		float lastMs;
+		float minMs;
+		float meanMs;
+		float p99Ms; //Over the last HISTORY_SIZE samples
+		long long lastFragments; //Samples that passed the depth test, shaded fragments with early-Z
+		double meanFragments;
+	};
+
+	// Per-pass GPU timings from GL_TIME_ELAPSED queries, and fragment counts from GL_SAMPLES_PASSED
+	// queries, which divided by the target's pixel count give the pass's overdraw.
+	// Each frame gets its own set of queries from a ring of FRAME_LATENCY frames,
+	// results are read FRAME_LATENCY frames later and only if already available, so it never stalls.
+	// Doesn't need a window, drawUI is optional.
+	//
+	// Each frame: beginFrame(), beginPass()/endPass() around each pass, endFrame()
+	class GpuProfiler {
+	public:
+		static const int FRAME_LATENCY = 4;
+		static const int MAX_PASSES_PER_FRAME = 32;
+		static const int HISTORY_SIZE = 256;
+
+		GpuProfiler();
+		~GpuProfiler();
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		void beginFrame();
+		void endFrame();
+		// Time elapsed queries can't nest, beginning a pass ends the open one
+		void beginPass(const std::string& name);
+		// Does nothing without an open pass
+		void endPass();
+
+		// Waits for every pending frame, e.g. before exporting at shutdown
+		void resolve();
+		void clear();
+
+		// Passes in first seen order
+		std::vector<GpuPassStats> getPassStats()const;
+		inline bool isSupported()const { return m_supported; }
+		inline int getDroppedFrames()const { return m_droppedFrames; }
+		// Fragments of the pass's latest collected frame, 0 for unknown passes
+		long long getLastFragments(const std::string& name)const;
+
+		// Settings window with the last/min/mean/p99 of every pass and a history graph
+		void drawUI(const char* title = "GPU Timings")const;
+		bool exportCSV(const char* filePath)const;
+		bool exportJSON(const char* filePath)const;
+	private:
+		struct Pass {
+			std::string name;
+			float history[HISTORY_SIZE] = {};
+			int historyHead = 0;
+			int samples = 0;
+			double totalMs = 0.0;
+			float minMs = 0.0f;
+			float lastMs = 0.0f;
+			double totalFragments = 0.0;
+			long long lastFragments = 0;
+		};
+		struct Frame {
+			unsigned int queries[MAX_PASSES_PER_FRAME];
+			unsigned int fragmentQueries[MAX_PASSES_PER_FRAME];
+			int passes[MAX_PASSES_PER_FRAME];
+			int count = 0;
+			bool pending = false;
+		};
+
+		bool m_supported = false;
+		Frame m_frames[FRAME_LATENCY];
+		int m_frame = 0;
+		bool m_passOpen = false;
+		int m_droppedFrames = 0;
+		std::vector<Pass> m_passes;
+		std::map<std::string, int> m_passIndices;
+
+		bool collect(Frame& frame, bool wait);
+		float percentile(const Pass& pass, float p)const;
+	};
+}
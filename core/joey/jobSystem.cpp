@@ -0,0 +1,176 @@
+#include "jobSystem.h"
+#include "cpuProfiler.h"
+#include <algorithm>
+#include <string>
+
+namespace joey
+{
+	//Which system and queue the current thread works for, -1 if it isn't a worker
+	static thread_local const JobSystem* t_system = nullptr;
+	static thread_local int t_queue = -1;
+
+	JobSystem::JobSystem(int workerCount)
+	{
+		if (workerCount < 0)
+			workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+		for (int i = 0; i <= workerCount; i++)
+		{
+			m_queues.push_back(new WorkQueue());
+		}
+		for (int i = 0; i < workerCount; i++)
+		{
+			m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+		for (WorkQueue* queue : m_queues)
+		{
+			delete queue;
+		}
+	}
+
+	int JobSystem::currentQueue()const
+	{
+		return t_system == this ? t_queue : (int)m_workers.size();
+	}
+
+	void JobSystem::run(Job job, JobCounter* counter, JobCounter* dependency)
+	{
+		if (counter)
+			counter->m_count.fetch_add(1, std::memory_order_relaxed);
+		if (dependency) {
+			//finish() decrements under the same lock, so either it sees this or we see zero
+			std::lock_guard<std::mutex> lock(dependency->m_mutex);
+			if (!dependency->isDone()) {
+				dependency->m_continuations.push_back({ std::move(job), counter });
+				return;
+			}
+		}
+		push({ std::move(job), counter });
+	}
+
+	void JobSystem::push(QueuedJob job)
+	{
+		WorkQueue& queue = *m_queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+		m_queued.fetch_add(1, std::memory_order_release);
+		//Taking the lock orders this against a worker that just found nothing and is about to sleep
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wake.notify_one();
+	}
+
+	bool JobSystem::tryRunOne(int queueIndex)
+	{
+		QueuedJob job;
+		bool found = false;
+		{
+			//Newest first from our own queue, it's the most likely to still be in cache
+			WorkQueue& own = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty()) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				found = true;
+			}
+		}
+		for (int i = 1; !found && i < (int)m_queues.size(); i++)
+		{
+			//Oldest first from everyone else's, those tend to be the biggest pieces of work
+			WorkQueue& victim = *m_queues[(queueIndex + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.jobs.empty()) {
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+		m_queued.fetch_sub(1, std::memory_order_relaxed);
+		job.job();
+		finish(job.counter);
+		return true;
+	}
+
+	void JobSystem::finish(JobCounter* counter)
+	{
+		if (!counter)
+			return;
+		std::vector<std::pair<Job, JobCounter*>> continuations;
+		{
+			//Decremented under the lock, wait() takes it once more so the counter can't be destroyed while held here
+			std::lock_guard<std::mutex> lock(counter->m_mutex);
+			if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				continuations.swap(counter->m_continuations);
+		}
+		for (auto& continuation : continuations)
+		{
+			push({ std::move(continuation.first), continuation.second });
+		}
+	}
+
+	void JobSystem::wait(JobCounter& counter)
+	{
+		JOEY_CPU_ZONE("JobSystem::wait");
+		int queueIndex = currentQueue();
+		while (!counter.isDone())
+		{
+			if (!tryRunOne(queueIndex))
+				std::this_thread::yield();
+		}
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+	}
+
+	void JobSystem::parallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& body)
+	{
+		if (count <= 0)
+			return;
+		if (grainSize <= 0)
+			grainSize = std::max(count / (getThreadCount() * 4), 1);
+		if (grainSize >= count) {
+			body(0, count);
+			return;
+		}
+		JobCounter counter;
+		for (int begin = 0; begin < count; begin += grainSize)
+		{
+			int end = std::min(begin + grainSize, count);
+			run([&body, begin, end]() { body(begin, end); }, &counter);
+		}
+		wait(counter);
+	}
+
+	void JobSystem::workerLoop(int index)
+	{
+		t_system = this;
+		t_queue = index;
+		std::string name = "Worker " + std::to_string(index);
+		cpuProfilerSetThreadName(name.c_str());
+		while (true)
+		{
+			if (tryRunOne(index))
+				continue;
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wake.wait(lock, [this]() { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+			//Queued work is still run on shutdown so nothing waiting on it hangs
+			if (m_stop && m_queued.load() == 0)
+				return;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace joey
+{
+	typedef std::function<void()> Job;
+
+	// Number of unfinished jobs that were run() with it. Jobs queued with a counter as
+	// their dependency are held back until it reaches zero. Must outlive those jobs,
+	// only destroy it after JobSystem::wait() on it returns
+	class JobCounter {
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+		inline bool isDone()const { return m_count.load(std::memory_order_acquire) == 0; }
+	private:
+		friend class JobSystem;
+		std::atomic<int> m_count{ 0 };
+		std::mutex m_mutex;
+		std::vector<std::pair<Job, JobCounter*>> m_continuations;
+	};
+
+	// Work stealing scheduler. Each worker owns a deque, pushes and pops its own jobs at the back
+	// and steals the oldest job from the front of another's when it runs dry.
+	// Threads that aren't workers submit to a shared queue and run jobs while they wait()
+	class JobSystem {
+	public:
+		// -1 = one worker per hardware thread, minus the thread that creates the system.
+		// 0 runs everything on whichever thread waits
+		explicit JobSystem(int workerCount = -1);
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// counter is incremented now and decremented when job returns.
+		// dependency, if any, must reach zero before job starts
+		void run(Job job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+		// Runs queued jobs on the calling thread until counter reaches zero
+		void wait(JobCounter& counter);
+		// body(begin, end) over [0, count) in chunks of grainSize, blocks until all are done.
+		// grainSize 0 picks roughly 4 chunks per thread
+		void parallelFor(int count, int grainSize, const std::function<void(int begin, int end)>& body);
+
+		// Workers plus the calling thread
+		inline int getThreadCount()const { return (int)m_workers.size() + 1; }
+	private:
+		struct QueuedJob {
+			Job job;
+			JobCounter* counter;
+		};
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<QueuedJob> jobs;
+		};
+
+		void push(QueuedJob job);
+		bool tryRunOne(int queueIndex);
+		void finish(JobCounter* counter);
+		void workerLoop(int index);
+		int currentQueue()const;
+
+		std::vector<std::thread> m_workers;
+		//One per worker, the last is shared by every other thread
+		std::vector<WorkQueue*> m_queues;
+		std::atomic<int> m_queued{ 0 };
+		std::atomic<bool> m_stop{ false };
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+	};
+}
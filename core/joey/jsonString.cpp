@@ -0,0 +1,25 @@
+#include "jsonString.h"
+#include <stdio.h>
+
+namespace joey
+{
+	std::string jsonString(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') {
+				quoted += '\\';
+				quoted += c;
+			}
+			else if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+				quoted += escaped;
+			}
+			else
+				quoted += c;
+		}
+		return quoted + "\"";
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+namespace joey
+{
+	// text as a quoted JSON string, with quotes, backslashes and control characters escaped
+	std::string jsonString(const std::string& text);
+}
@@ -0,0 +1,129 @@
+#include "materialTextures.h"
+#include "jobSystem.h"
+#include "../ew/external/glad.h"
+#include "../ew/external/stb_image.h"
+#include <stdio.h>
+#include <algorithm>
+
+namespace joey
+{
+	static const int INITIAL_LAYERS = 1;
+
+	static int getTextureFormat(int numComponents)
+	{
+		switch (numComponents) {
+		case 1: return GL_RED;
+		case 2: return GL_RG;
+		case 3: return GL_RGB;
+		default: return GL_RGBA;
+		}
+	}
+
+	MaterialTextures::MaterialTextures(int layerWidth, int layerHeight)
+		: m_width(layerWidth), m_height(layerHeight)
+	{
+		m_mipLevels = 1;
+		while ((std::max(m_width, m_height) >> m_mipLevels) > 0)
+			m_mipLevels++;
+		glCreateFramebuffers(1, &m_readFbo);
+		glCreateFramebuffers(1, &m_drawFbo);
+	}
+
+	MaterialTextures::~MaterialTextures()
+	{
+		glDeleteTextures(1, &m_texture);
+		glDeleteFramebuffers(1, &m_readFbo);
+		glDeleteFramebuffers(1, &m_drawFbo);
+	}
+
+	std::vector<int> MaterialTextures::load(const std::vector<std::string>& filePaths, JobSystem* jobs)
+	{
+		struct Image {
+			unsigned char* data = nullptr;
+			int width = 0;
+			int height = 0;
+			int numComponents = 0;
+		};
+		std::vector<Image> images(filePaths.size());
+		auto decode = [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				Image& image = images[i];
+				image.data = stbi_load(filePaths[i].c_str(), &image.width, &image.height, &image.numComponents, 0);
+				if (!image.data)
+					printf("Failed to load image %s\n", filePaths[i].c_str());
+			}
+		};
+		if (jobs)
+			jobs->parallelFor((int)images.size(), 1, decode);
+		else
+			decode(0, (int)images.size());
+
+		//GL calls have to stay on the thread that owns the context
+		reserve(m_layerCount + (int)images.size());
+		std::vector<int> materials;
+		for (Image& image : images)
+		{
+			uploadLayer(m_layerCount, image.data, image.width, image.height, image.numComponents);
+			stbi_image_free(image.data);
+			materials.push_back(m_layerCount++);
+		}
+		glGenerateTextureMipmap(m_texture);
+		return materials;
+	}
+
+	void MaterialTextures::reserve(int layers)
+	{
+		if (layers <= m_layerCapacity)
+			return;
+		int capacity = std::max(layers, std::max(m_layerCapacity * 2, INITIAL_LAYERS));
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+		glTextureStorage3D(texture, m_mipLevels, GL_RGBA8, m_width, m_height, capacity);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (m_texture) {
+			//Storage is immutable, growing means copying the existing layers with their mips
+			for (int level = 0; level < m_mipLevels && m_layerCount > 0; level++)
+			{
+				int width = std::max(m_width >> level, 1);
+				int height = std::max(m_height >> level, 1);
+				glCopyImageSubData(m_texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+					texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, m_layerCount);
+			}
+			glDeleteTextures(1, &m_texture);
+		}
+		m_texture = texture;
+		m_layerCapacity = capacity;
+	}
+
+	void MaterialTextures::uploadLayer(int layer, const unsigned char* data, int width, int height, int numComponents)
+	{
+		if (!data) {
+			//What sampling the missing texture used to give
+			float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			glClearTexSubImage(m_texture, 0, 0, 0, layer, m_width, m_height, 1, GL_RGBA, GL_FLOAT, black);
+			return;
+		}
+		int format = getTextureFormat(numComponents);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (width == m_width && height == m_height) {
+			glTextureSubImage3D(m_texture, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, data);
+		}
+		else {
+			//Scaled to the layer size by a linear blit from a temporary texture
+			unsigned int source;
+			glCreateTextures(GL_TEXTURE_2D, 1, &source);
+			glTextureStorage2D(source, 1, GL_RGBA8, width, height);
+			glTextureSubImage2D(source, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+			glNamedFramebufferTexture(m_readFbo, GL_COLOR_ATTACHMENT0, source, 0);
+			glNamedFramebufferTextureLayer(m_drawFbo, GL_COLOR_ATTACHMENT0, m_texture, 0, layer);
+			glBlitNamedFramebuffer(m_readFbo, m_drawFbo, 0, 0, width, height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			glNamedFramebufferTexture(m_readFbo, GL_COLOR_ATTACHMENT0, 0, 0);
+			glDeleteTextures(1, &source);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	class JobSystem;
+
+	// Every material's color texture as a layer of one GL_TEXTURE_2D_ARRAY, so a single binding
+	// serves all of them and draws with different materials can share a multi draw. The material
+	// index in the per-draw data is the layer (see drawData.glsl).
+	// Images that are not layer sized are scaled on upload, the array grows as layers are added
+	class MaterialTextures {
+	public:
+		MaterialTextures(int layerWidth, int layerHeight);
+		~MaterialTextures();
+		MaterialTextures(const MaterialTextures&) = delete;
+		MaterialTextures& operator=(const MaterialTextures&) = delete;
+
+		// Decodes on jobs when given, uploads on the calling thread. Returns each file's material,
+		// files that fail to load still get one, cleared to black
+		std::vector<int> load(const std::vector<std::string>& filePaths, JobSystem* jobs = nullptr);
+
+		// Replaced when load() has to grow the array
+		inline unsigned int getTexture()const { return m_texture; }
+		inline int getLayerCount()const { return m_layerCount; }
+		inline int getLayerWidth()const { return m_width; }
+		inline int getLayerHeight()const { return m_height; }
+	private:
+		void reserve(int layers);
+		void uploadLayer(int layer, const unsigned char* data, int width, int height, int numComponents);
+
+		unsigned int m_texture = 0;
+		unsigned int m_readFbo = 0;
+		unsigned int m_drawFbo = 0;
+		int m_width;
+		int m_height;
+		int m_mipLevels;
+		int m_layerCount = 0;
+		int m_layerCapacity = 0;
+	};
+}
@@ -0,0 +1,276 @@
+#include "pointCloud.h"
+#include "jobSystem.h"
+#include "cpuProfiler.h"
+#include "renderStats.h"
+#include "../ew/external/glad.h"
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace joey
+{
+	//Frames the GPU may still be drawing, a slot drawn this recently is never overwritten
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	PointCloud::PointCloud(const std::string& octreePath, const PointCloudSettings& settings, JobSystem* jobs, ShaderCache* shaderCache)
+		: m_settings(settings),
+		m_jobs(jobs),
+		m_shader(shaderCache
+			? ew::Shader("assets/core/pointCloud.vert", "assets/core/pointCloud.frag", shaderCache)
+			: ew::Shader("assets/core/pointCloud.vert", "assets/core/pointCloud.frag")),
+		m_path(octreePath)
+	{
+		FILE* file = fopen(octreePath.c_str(), "rb");
+		OctreeFileHeader header;
+		if (!file || fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "JPCO", 4) != 0
+			|| header.version != OCTREE_FILE_VERSION || header.nodeCount == 0) {
+			printf("PointCloud: %s is not a point cloud octree, build it with buildPointCloudOctree\n", octreePath.c_str());
+			if (file)
+				fclose(file);
+			return;
+		}
+		std::vector<OctreeFileNode> fileNodes(header.nodeCount);
+		if (!seekPointCloudFile(file, header.nodeTableOffset) || fread(fileNodes.data(), sizeof(OctreeFileNode), fileNodes.size(), file) != fileNodes.size()) {
+			printf("PointCloud: %s is truncated\n", octreePath.c_str());
+			fclose(file);
+			return;
+		}
+		//Without jobs, reads happen on this thread through one handle
+		if (m_jobs)
+			fclose(file);
+		else
+			m_file = file;
+
+		m_nodes.resize(fileNodes.size());
+		for (size_t i = 0; i < fileNodes.size(); i++)
+		{
+			m_nodes[i].file = fileNodes[i];
+		}
+		m_pointCount = header.pointCount;
+		m_nodeCapacity = header.nodeCapacity;
+		m_dataOffset = sizeof(header);
+		memcpy(m_origin, header.origin, sizeof(m_origin));
+		m_rootMin = glm::vec3(header.rootMin[0], header.rootMin[1], header.rootMin[2]);
+		m_rootSize = header.rootSize;
+
+		size_t slotBytes = sizeof(CloudPoint) * m_nodeCapacity;
+		m_slotCount = (int)std::min<size_t>(std::max<size_t>(m_settings.gpuBytes / slotBytes, 1), m_nodes.size());
+		if ((size_t)m_slotCount * m_nodeCapacity < (size_t)m_settings.pointBudget && (size_t)m_slotCount < m_nodes.size())
+			printf("PointCloud: %d slots hold fewer points than the point budget, raise gpuBytes\n", m_slotCount);
+		m_slotOwners.assign(m_slotCount, -1);
+		glCreateBuffers(1, &m_vbo);
+		glNamedBufferStorage(m_vbo, slotBytes * m_slotCount, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+		glCreateVertexArrays(1, &m_vao);
+		glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(CloudPoint, position));
+		glVertexArrayAttribFormat(m_vao, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(CloudPoint, color));
+		for (int i = 0; i < 2; i++)
+		{
+			glVertexArrayAttribBinding(m_vao, i, 0);
+			glEnableVertexArrayAttrib(m_vao, i);
+		}
+		glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(CloudPoint));
+
+		m_loads.resize(std::max(m_settings.maxLoadsInFlight, 1));
+		for (Load& load : m_loads)
+		{
+			load.counter.reset(new JobCounter());
+		}
+	}
+
+	PointCloud::~PointCloud()
+	{
+		//Jobs write into m_loads
+		for (Load& load : m_loads)
+		{
+			if (m_jobs && load.node >= 0)
+				m_jobs->wait(*load.counter);
+		}
+		if (m_file)
+			fclose(m_file);
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+	}
+
+	int PointCloud::acquireSlot()
+	{
+		//A free slot, else the one drawn longest ago, as long as that's before any frame still in flight
+		int oldest = -1;
+		for (int slot = 0; slot < m_slotCount; slot++)
+		{
+			int owner = m_slotOwners[slot];
+			if (owner < 0)
+				return slot;
+			if (m_nodes[owner].lastDrawn <= m_frame - FRAMES_IN_FLIGHT && (oldest < 0 || m_nodes[owner].lastDrawn < m_nodes[m_slotOwners[oldest]].lastDrawn))
+				oldest = slot;
+		}
+		if (oldest >= 0) {
+			Node& evicted = m_nodes[m_slotOwners[oldest]];
+			evicted.state = NodeState::ON_DISK;
+			evicted.slot = -1;
+			m_slotOwners[oldest] = -1;
+			m_stats.residentNodes--;
+			m_stats.evictions++;
+		}
+		return oldest;
+	}
+
+	void PointCloud::uploadFinishedLoads()
+	{
+		m_stats.nodesUploaded = 0;
+		m_stats.bytesUploaded = 0;
+		for (Load& load : m_loads)
+		{
+			if (load.node < 0 || !load.counter->isDone())
+				continue;
+			Node& node = m_nodes[load.node];
+			size_t bytes = sizeof(CloudPoint) * load.points.size();
+			//At least one node a frame, so a budget below one node still makes progress
+			if (m_stats.nodesUploaded > 0 && m_stats.bytesUploaded + bytes > m_settings.uploadBytesPerFrame)
+				continue;
+			//A failed read or a full buffer sends the node back to disk, it's requested again while it's needed
+			int slot = load.points.size() == node.file.pointCount ? acquireSlot() : -1;
+			if (slot >= 0) {
+				glNamedBufferSubData(m_vbo, sizeof(CloudPoint) * m_nodeCapacity * slot, bytes, load.points.data());
+				node.state = NodeState::RESIDENT;
+				node.slot = slot;
+				m_slotOwners[slot] = load.node;
+				m_stats.residentNodes++;
+				m_stats.nodesUploaded++;
+				m_stats.bytesUploaded += bytes;
+			}
+			else
+				node.state = NodeState::ON_DISK;
+			load.node = -1;
+			m_stats.loadsInFlight--;
+		}
+	}
+
+	void PointCloud::update(const ew::Camera& camera, float viewportHeight)
+	{
+		if (m_nodes.empty())
+			return;
+		JOEY_CPU_ZONE("PointCloud::update");
+		m_frame++;
+		uploadFinishedLoads();
+
+		Frustum frustum = Frustum::fromMatrix(camera.projectionMatrix() * camera.viewMatrix());
+		//Pixels covered by one world unit at distance 1
+		float projection = viewportHeight / (2.0f * tanf(glm::radians(camera.fov) * 0.5f));
+		float sampleSpacing = 1.0f / sqrtf((float)m_nodeCapacity);
+		struct Candidate {
+			float pixels; //Projected size of the node's bounding sphere
+			int node;
+			bool operator<(const Candidate& other)const { return pixels < other.pixels; }
+		};
+		auto candidate = [&](int index) {
+			const OctreeFileNode& node = m_nodes[index].file;
+			glm::vec3 center = glm::vec3(node.min[0], node.min[1], node.min[2]) + node.size * 0.5f;
+			float radius = node.size * 0.8660254f;
+			float distance = glm::length(center - camera.position) - radius;
+			float pixels = distance > 0.0f ? radius * 2.0f * projection / distance : 1e30f;
+			return Candidate{ pixels, index };
+		};
+
+		//Largest on screen first, until the budget runs out. A node's points are a sample of its whole
+		//subtree, so drawing it and its ancestors is already a thinner copy of everything under it
+		std::vector<Candidate> queue;
+		std::vector<Candidate> requests;
+		queue.push_back(candidate(0));
+		m_visible.clear();
+		m_stats.drawnPoints = 0;
+		m_stats.budgetReached = false;
+		while (!queue.empty())
+		{
+			std::pop_heap(queue.begin(), queue.end());
+			Candidate next = queue.back();
+			queue.pop_back();
+			Node& node = m_nodes[next.node];
+			const OctreeFileNode& file = node.file;
+			if (!frustum.intersectsAABB(glm::vec3(file.min[0], file.min[1], file.min[2]), glm::vec3(file.min[0], file.min[1], file.min[2]) + file.size))
+				continue;
+			if (m_stats.drawnPoints + (int)file.pointCount > m_settings.pointBudget) {
+				m_stats.budgetReached = true;
+				break;
+			}
+			//Children only ever draw on top of their parent
+			if (node.state != NodeState::RESIDENT) {
+				if (node.state == NodeState::ON_DISK)
+					requests.push_back(next);
+				continue;
+			}
+			m_visible.push_back(next.node);
+			m_stats.drawnPoints += file.pointCount;
+			node.lastDrawn = m_frame;
+
+			//Roughly sqrt(capacity) points across the node at every level, refine while they're further apart than pointSize
+			if (next.pixels * sampleSpacing <= m_settings.pointSize)
+				continue;
+			for (int i = 0; i < 8; i++)
+			{
+				if (file.children[i] < 0)
+					continue;
+				queue.push_back(candidate(file.children[i]));
+				std::push_heap(queue.begin(), queue.end());
+			}
+		}
+		m_stats.visibleNodes = (int)m_visible.size();
+		m_firsts.resize(m_visible.size());
+		m_counts.resize(m_visible.size());
+		for (size_t i = 0; i < m_visible.size(); i++)
+		{
+			const Node& node = m_nodes[m_visible[i]];
+			m_firsts[i] = node.slot * (int)m_nodeCapacity;
+			m_counts[i] = (int)node.file.pointCount;
+		}
+
+		//Biggest missing nodes first, into whichever loads are free
+		std::sort(requests.begin(), requests.end(), [](const Candidate& a, const Candidate& b) { return a.pixels > b.pixels; });
+		size_t request = 0;
+		for (Load& load : m_loads)
+		{
+			if (request == requests.size())
+				break;
+			if (load.node >= 0)
+				continue;
+			load.node = requests[request++].node;
+			Node& node = m_nodes[load.node];
+			node.state = NodeState::LOADING;
+			m_stats.loadsInFlight++;
+			uint64_t offset = m_dataOffset + sizeof(CloudPoint) * node.file.firstPoint;
+			uint32_t count = node.file.pointCount;
+			if (!m_jobs) {
+				load.points.resize(count);
+				if (!seekPointCloudFile(m_file, offset) || fread(load.points.data(), sizeof(CloudPoint), count, m_file) != count)
+					load.points.clear();
+				continue;
+			}
+			//Each read has its own handle, so they can run side by side
+			Load* target = &load;
+			std::string path = m_path;
+			m_jobs->run([target, path, offset, count]() {
+				target->points.resize(count);
+				FILE* file = fopen(path.c_str(), "rb");
+				if (!file || !seekPointCloudFile(file, offset) || fread(target->points.data(), sizeof(CloudPoint), count, file) != count)
+					target->points.clear();
+				if (file)
+					fclose(file);
+			}, load.counter.get());
+		}
+	}
+
+	void PointCloud::draw(const glm::mat4& viewProjection)const
+	{
+		if (m_visible.empty())
+			return;
+		m_shader.use();
+		m_shader.setMat4("_ViewProjection", viewProjection);
+		m_shader.setFloat("_PointSize", m_settings.pointSize);
+		glEnable(GL_PROGRAM_POINT_SIZE);
+		bindVertexArray(m_vao);
+		renderStatsMultiDraw(GL_POINTS, (int)m_visible.size(), m_stats.drawnPoints);
+		glMultiDrawArrays(GL_POINTS, m_firsts.data(), m_counts.data(), (int)m_visible.size());
+		glDisable(GL_PROGRAM_POINT_SIZE);
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../ew/camera.h"
+#include "../ew/shader.h"
+#include "pointCloudBuilder.h"
+#include "frustum.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	class JobSystem;
+	class JobCounter;
+	class ShaderCache;
+
+	struct PointCloudSettings {
+		int pointBudget = 5 * 1000 * 1000; //Points drawn per frame at most
+		size_t gpuBytes = 256 * 1024 * 1024; //Resident node data, split into one slot per node
+		size_t uploadBytesPerFrame = 16 * 1024 * 1024; //Loaded nodes past this wait for the next frame
+		int maxLoadsInFlight = 8; //Node reads running on the job system at once
+		float pointSize = 2.0f; //Pixels. Nodes are refined until their points are about this far apart
+	};
+
+	struct PointCloudStats {
+		int visibleNodes = 0; //Drawn last frame
+		int drawnPoints = 0;
+		int residentNodes = 0;
+		int loadsInFlight = 0;
+		int nodesUploaded = 0; //Last frame
+		size_t bytesUploaded = 0;
+		int evictions = 0; //In total
+		bool budgetReached = false; //Nodes were left out last frame to stay within pointBudget
+	};
+
+	// Out-of-core renderer for octree files from buildPointCloudOctree. Only the node hierarchy is kept in
+	// memory. Each update() ranks the nodes in view by their size on screen and picks the largest until
+	// pointBudget is spent, refining a node only while its points would be further apart than pointSize.
+	// Picked nodes that aren't on the GPU are read from disk on the job system and uploaded, a few per frame,
+	// into fixed slots of one buffer, evicting the least recently drawn. Coarse nodes stand in until their
+	// children arrive, so a frame never waits on the disk. jobs must outlive the cloud, its
+	// destructor waits for the loads still in flight
+	class PointCloud {
+	public:
+		PointCloud(const std::string& octreePath, const PointCloudSettings& settings = PointCloudSettings(),
+			JobSystem* jobs = nullptr, ShaderCache* shaderCache = nullptr);
+		~PointCloud();
+		PointCloud(const PointCloud&) = delete;
+		PointCloud& operator=(const PointCloud&) = delete;
+
+		// False if the file couldn't be read
+		inline bool isLoaded()const { return !m_nodes.empty(); }
+		// Selects this frame's nodes for a perspective camera and a viewport viewportHeight pixels tall,
+		// queues loads for the missing ones and uploads finished ones within the frame's budget
+		void update(const ew::Camera& camera, float viewportHeight);
+		// Every selected node in one multi draw, depth tested and written
+		void draw(const glm::mat4& viewProjection)const;
+
+		inline const PointCloudStats& getStats()const { return m_stats; }
+		inline PointCloudSettings& getSettings() { return m_settings; }
+		inline uint64_t getPointCount()const { return m_pointCount; }
+		inline int getNodeCount()const { return (int)m_nodes.size(); }
+		inline int getSlotCount()const { return m_slotCount; }
+		// Points are relative to the source file's origin, which is added back to get its coordinates
+		inline const double* getOrigin()const { return m_origin; }
+		inline glm::vec3 getBoundsMin()const { return m_rootMin; }
+		inline glm::vec3 getBoundsMax()const { return m_rootMin + glm::vec3(m_rootSize); }
+	private:
+		enum class NodeState { ON_DISK, LOADING, RESIDENT };
+		struct Node {
+			OctreeFileNode file;
+			NodeState state = NodeState::ON_DISK;
+			int slot = -1;
+			int lastDrawn = -1000; //Frame
+		};
+		//A node read on the job system, uploaded once the job is done
+		struct Load {
+			int node = -1;
+			std::vector<CloudPoint> points;
+			std::unique_ptr<JobCounter> counter;
+		};
+
+		void uploadFinishedLoads();
+		int acquireSlot();
+
+		PointCloudSettings m_settings;
+		JobSystem* m_jobs;
+		ew::Shader m_shader;
+		std::string m_path;
+		std::vector<Node> m_nodes;
+		uint64_t m_pointCount = 0;
+		uint32_t m_nodeCapacity = 0;
+		uint64_t m_dataOffset = 0;
+		double m_origin[3] = {};
+		glm::vec3 m_rootMin = glm::vec3(0);
+		float m_rootSize = 0.0f;
+		FILE* m_file = nullptr; //Reads without a job system
+
+		int m_slotCount = 0;
+		std::vector<int> m_slotOwners; //Node per slot, -1 when free
+		std::vector<Load> m_loads;
+		std::vector<int> m_visible; //Node indices drawn this frame
+		std::vector<int> m_firsts;
+		std::vector<int> m_counts;
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		int m_frame = 0;
+		PointCloudStats m_stats;
+	};
+}
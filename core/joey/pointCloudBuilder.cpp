@@ -0,0 +1,601 @@
+#include "pointCloudBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <functional>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace joey
+{
+	//PLY scalar types, both spellings, and their sizes
+	static const char* PLY_TYPES[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double",
+		"int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+	static const int PLY_TYPE_BYTES[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+	enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+	bool seekPointCloudFile(FILE* file, uint64_t offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+		return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+	}
+
+	static double readPlyScalar(const unsigned char* data, int type, bool swap)
+	{
+		unsigned char bytes[8];
+		int size = PLY_TYPE_BYTES[type];
+		for (int i = 0; i < size; i++)
+		{
+			bytes[i] = data[swap ? size - 1 - i : i];
+		}
+		switch (type)
+		{
+		case PLY_INT8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+		case PLY_UINT8: return bytes[0];
+		case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+		default: { double v; memcpy(&v, bytes, 8); return v; }
+		}
+	}
+
+	//Integer channels are 0-255, floating point ones 0-1
+	static uint32_t packColor(const double rgb[3], bool normalized)
+	{
+		uint32_t color = 0xFF000000;
+		for (int i = 0; i < 3; i++)
+		{
+			double value = normalized ? rgb[i] * 255.0 : rgb[i];
+			color |= (uint32_t)std::min(std::max(value, 0.0), 255.0) << (i * 8);
+		}
+		return color;
+	}
+
+	PointCloudReader::~PointCloudReader()
+	{
+		if (m_file)
+			fclose(m_file);
+	}
+
+	bool PointCloudReader::open(const std::string& filePath)
+	{
+		if (m_file)
+			fclose(m_file);
+		m_file = fopen(filePath.c_str(), "rb");
+		if (!m_file) {
+			printf("PointCloudReader: can't open %s\n", filePath.c_str());
+			return false;
+		}
+		std::string extension = filePath.substr(filePath.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		m_pointCount = 0;
+		m_pointsRead = 0;
+		m_properties.clear();
+		m_vertexBytes = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			m_positionProperty[i] = m_colorProperty[i] = -1;
+		}
+		if (extension == "ply") {
+			if (!readPlyHeader()) {
+				printf("PointCloudReader: %s is not a PLY with vertex x, y and z\n", filePath.c_str());
+				fclose(m_file);
+				m_file = nullptr;
+				return false;
+			}
+		}
+		else
+			m_format = Format::XYZ;
+		m_dataStart = ftell(m_file);
+		return true;
+	}
+
+	bool PointCloudReader::readLine(std::string& line)
+	{
+		line.clear();
+		char buffer[512];
+		while (fgets(buffer, sizeof(buffer), m_file))
+		{
+			line += buffer;
+			if (line.back() == '\n')
+				break;
+		}
+		while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+		{
+			line.pop_back();
+		}
+		return !line.empty() || !feof(m_file);
+	}
+
+	bool PointCloudReader::readPlyHeader()
+	{
+		std::string line;
+		if (!readLine(line) || line != "ply")
+			return false;
+		//Only the vertex element matters, and only if it comes first
+		bool inVertex = false, vertexSeen = false;
+		while (readLine(line))
+		{
+			char word[64] = {}, type[64] = {}, name[64] = {};
+			if (sscanf(line.c_str(), "%63s", word) != 1)
+				continue;
+			if (strcmp(word, "end_header") == 0)
+				break;
+			if (strcmp(word, "format") == 0) {
+				sscanf(line.c_str(), "%*s %63s", type);
+				if (strcmp(type, "ascii") == 0) m_format = Format::PLY_ASCII;
+				else if (strcmp(type, "binary_little_endian") == 0) m_format = Format::PLY_BINARY_LE;
+				else if (strcmp(type, "binary_big_endian") == 0) m_format = Format::PLY_BINARY_BE;
+				else return false;
+			}
+			else if (strcmp(word, "element") == 0) {
+				unsigned long long count = 0;
+				sscanf(line.c_str(), "%*s %63s %llu", name, &count);
+				inVertex = !vertexSeen && strcmp(name, "vertex") == 0;
+				if (inVertex) {
+					m_pointCount = count;
+					vertexSeen = true;
+				}
+				else if (!vertexSeen)
+					return false;
+			}
+			else if (strcmp(word, "property") == 0 && inVertex) {
+				if (sscanf(line.c_str(), "%*s %63s %63s", type, name) != 2 || strcmp(type, "list") == 0)
+					return false;
+				int typeIndex = -1;
+				for (int i = 0; i < 16; i++)
+				{
+					if (strcmp(type, PLY_TYPES[i]) == 0)
+						typeIndex = i % 8;
+				}
+				if (typeIndex < 0)
+					return false;
+				int property = (int)m_properties.size();
+				if (strcmp(name, "x") == 0) m_positionProperty[0] = property;
+				else if (strcmp(name, "y") == 0) m_positionProperty[1] = property;
+				else if (strcmp(name, "z") == 0) m_positionProperty[2] = property;
+				else if (strcmp(name, "red") == 0 || strcmp(name, "r") == 0) m_colorProperty[0] = property;
+				else if (strcmp(name, "green") == 0 || strcmp(name, "g") == 0) m_colorProperty[1] = property;
+				else if (strcmp(name, "blue") == 0 || strcmp(name, "b") == 0) m_colorProperty[2] = property;
+				m_properties.push_back({ typeIndex, m_vertexBytes });
+				m_vertexBytes += PLY_TYPE_BYTES[typeIndex];
+			}
+		}
+		return vertexSeen && m_positionProperty[0] >= 0 && m_positionProperty[1] >= 0 && m_positionProperty[2] >= 0;
+	}
+
+	bool PointCloudReader::rewind()
+	{
+		m_pointsRead = 0;
+		return m_file && fseek(m_file, m_dataStart, SEEK_SET) == 0;
+	}
+
+	size_t PointCloudReader::read(SourcePoint* points, size_t maxCount)
+	{
+		if (!m_file)
+			return 0;
+		bool hasColor = m_colorProperty[0] >= 0 && m_colorProperty[1] >= 0 && m_colorProperty[2] >= 0;
+		if (m_format == Format::PLY_BINARY_LE || m_format == Format::PLY_BINARY_BE) {
+			size_t count = (size_t)std::min<uint64_t>(maxCount, m_pointCount - m_pointsRead);
+			m_block.resize(count * m_vertexBytes);
+			count = fread(m_block.data(), m_vertexBytes, count, m_file);
+			bool swap = m_format == Format::PLY_BINARY_BE;
+			bool normalized = hasColor && m_properties[m_colorProperty[0]].type >= PLY_FLOAT32;
+			for (size_t i = 0; i < count; i++)
+			{
+				const unsigned char* vertex = &m_block[i * m_vertexBytes];
+				double rgb[3] = { 255.0, 255.0, 255.0 };
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const Property& position = m_properties[m_positionProperty[axis]];
+					points[i].position[axis] = readPlyScalar(vertex + position.offset, position.type, swap);
+					if (hasColor) {
+						const Property& color = m_properties[m_colorProperty[axis]];
+						rgb[axis] = readPlyScalar(vertex + color.offset, color.type, swap);
+					}
+				}
+				points[i].color = packColor(rgb, normalized);
+			}
+			m_pointsRead += count;
+			return count;
+		}
+
+		//Text, a line per point. PLY columns follow the properties, XYZ ends with r g b when it has six or more
+		size_t count = 0;
+		std::string line;
+		bool normalized = m_format == Format::PLY_ASCII && hasColor && m_properties[m_colorProperty[0]].type >= PLY_FLOAT32;
+		//Columns past the last one used aren't parsed
+		int needed = 3;
+		for (int i = 0; i < 3; i++)
+		{
+			needed = std::max(needed, std::max(m_positionProperty[i], m_colorProperty[i]) + 1);
+		}
+		while (count < maxCount && (m_format == Format::XYZ || m_pointsRead < m_pointCount) && readLine(line))
+		{
+			if (line.empty() || line[0] == '#' || line[0] == '/')
+				continue;
+			double values[64];
+			int columns = 0;
+			const char* cursor = line.c_str();
+			while (columns < 64 && (m_format == Format::XYZ || columns < needed))
+			{
+				while (*cursor == ' ' || *cursor == '\t' || *cursor == ',' || *cursor == ';')
+				{
+					cursor++;
+				}
+				char* end;
+				values[columns] = strtod(cursor, &end);
+				if (end == cursor)
+					break;
+				cursor = end;
+				columns++;
+			}
+			SourcePoint& point = points[count];
+			double rgb[3] = { 255.0, 255.0, 255.0 };
+			if (m_format == Format::XYZ) {
+				if (columns < 3)
+					continue;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					point.position[axis] = values[axis];
+					if (columns >= 6)
+						rgb[axis] = values[columns - 3 + axis];
+				}
+			}
+			else {
+				if (columns < needed)
+					continue;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					point.position[axis] = values[m_positionProperty[axis]];
+					if (hasColor)
+						rgb[axis] = values[m_colorProperty[axis]];
+				}
+				m_pointsRead++;
+			}
+			point.color = packColor(rgb, normalized);
+			count++;
+		}
+		return count;
+	}
+
+	//Stands in for a random number per point. Hashing the point itself makes a node's sample
+	//independent of the order points arrive in
+	static uint32_t pointPriority(const CloudPoint& point)
+	{
+		uint32_t words[4];
+		memcpy(words, &point, sizeof(words));
+		uint32_t h = 0x9E3779B9u;
+		for (uint32_t word : words)
+		{
+			h ^= word;
+			h ^= h >> 16;
+			h *= 0x85EBCA6Bu;
+			h ^= h >> 13;
+			h *= 0xC2B2AE35u;
+			h ^= h >> 16;
+		}
+		return h;
+	}
+
+	static int octantOf(const glm::vec3& position, const glm::vec3& middle)
+	{
+		return (position.x >= middle.x ? 1 : 0) | (position.y >= middle.y ? 2 : 0) | (position.z >= middle.z ? 4 : 0);
+	}
+
+	//Up to maxCount points, 0 once there are none left
+	typedef std::function<size_t(CloudPoint* points, size_t maxCount)> PointSource;
+
+	class OctreeBuilder {
+	public:
+		OctreeBuilder(const PointCloudBuildSettings& settings, FILE* output, const std::string& spillPath, PointCloudBuildStats& stats)
+			: m_settings(settings), m_output(output), m_spillPath(spillPath), m_stats(stats)
+		{
+		}
+
+		int buildInMemory(CloudPoint* begin, CloudPoint* end, const glm::vec3& min, float size, int depth);
+		int buildStreamed(const PointSource& source, uint64_t count, const glm::vec3& min, float size, int depth);
+		inline const std::vector<OctreeFileNode>& getNodes()const { return m_nodes; }
+		inline bool failed()const { return m_failed; }
+		inline uint64_t getPointsWritten()const { return m_pointsWritten; }
+	private:
+		int addNode(const glm::vec3& min, float size, int depth, const CloudPoint* points, uint32_t count);
+
+		const PointCloudBuildSettings& m_settings;
+		FILE* m_output;
+		std::string m_spillPath;
+		PointCloudBuildStats& m_stats;
+		std::vector<OctreeFileNode> m_nodes;
+		uint64_t m_pointsWritten = 0;
+		bool m_failed = false;
+	};
+
+	int OctreeBuilder::addNode(const glm::vec3& min, float size, int depth, const CloudPoint* points, uint32_t count)
+	{
+		OctreeFileNode node;
+		memcpy(node.min, &min, sizeof(node.min));
+		node.size = size;
+		node.firstPoint = m_pointsWritten;
+		node.pointCount = count;
+		for (int i = 0; i < 8; i++)
+		{
+			node.children[i] = -1;
+		}
+		node.depth = depth;
+		if (fwrite(points, sizeof(CloudPoint), count, m_output) != count)
+			m_failed = true;
+		m_pointsWritten += count;
+		m_nodes.push_back(node);
+		m_stats.depth = std::max(m_stats.depth, depth);
+		return (int)m_nodes.size() - 1;
+	}
+
+	int OctreeBuilder::buildInMemory(CloudPoint* begin, CloudPoint* end, const glm::vec3& min, float size, int depth)
+	{
+		size_t count = end - begin;
+		uint32_t kept = (uint32_t)std::min<size_t>(count, m_settings.nodeCapacity);
+		if (count > kept) {
+			std::nth_element(begin, begin + kept, end, [](const CloudPoint& a, const CloudPoint& b) {
+				return pointPriority(a) < pointPriority(b);
+			});
+		}
+		int node = addNode(min, size, depth, begin, kept);
+		if (count == kept)
+			return node;
+		if (depth >= m_settings.maxDepth) {
+			m_stats.droppedPoints += count - kept;
+			return node;
+		}
+
+		//The rest split by octant in place, bounds[i] to bounds[i + 1] is octant i
+		glm::vec3 middle = min + size * 0.5f;
+		CloudPoint* bounds[9];
+		bounds[0] = begin + kept;
+		bounds[8] = end;
+		bounds[4] = std::partition(bounds[0], bounds[8], [&](const CloudPoint& p) { return p.position.z < middle.z; });
+		for (int half = 0; half < 8; half += 4)
+		{
+			bounds[half + 2] = std::partition(bounds[half], bounds[half + 4], [&](const CloudPoint& p) { return p.position.y < middle.y; });
+		}
+		for (int quarter = 0; quarter < 8; quarter += 2)
+		{
+			bounds[quarter + 1] = std::partition(bounds[quarter], bounds[quarter + 2], [&](const CloudPoint& p) { return p.position.x < middle.x; });
+		}
+		float half = size * 0.5f;
+		for (int i = 0; i < 8; i++)
+		{
+			if (bounds[i] == bounds[i + 1])
+				continue;
+			glm::vec3 childMin = min + glm::vec3(i & 1 ? half : 0.0f, i & 2 ? half : 0.0f, i & 4 ? half : 0.0f);
+			int child = buildInMemory(bounds[i], bounds[i + 1], childMin, half, depth + 1);
+			m_nodes[node].children[i] = child;
+		}
+		return node;
+	}
+
+	int OctreeBuilder::buildStreamed(const PointSource& source, uint64_t count, const glm::vec3& min, float size, int depth)
+	{
+		//Nothing after a failed write or read is kept, stop early
+		if (m_failed)
+			return -1;
+		if (count <= m_settings.memoryPoints) {
+			std::vector<CloudPoint> points((size_t)count);
+			size_t read = 0, block;
+			while (read < points.size() && (block = source(points.data() + read, points.size() - read)) > 0)
+			{
+				read += block;
+			}
+			//A spill file shorter than what went into it lost points
+			if (read != count) {
+				printf("buildPointCloudOctree: read %zu of %llu points back\n", read, (unsigned long long)count);
+				m_failed = true;
+				return -1;
+			}
+			return buildInMemory(points.data(), points.data() + read, min, size, depth);
+		}
+		m_stats.spillPasses++;
+
+		//The node keeps the lowest priorities seen so far in a max heap, everything else spills to its octant's file
+		typedef std::pair<uint32_t, CloudPoint> Ranked;
+		auto lower = [](const Ranked& a, const Ranked& b) { return a.first < b.first; };
+		std::vector<Ranked> kept;
+		kept.reserve(m_settings.nodeCapacity);
+		glm::vec3 middle = min + size * 0.5f;
+		bool lastLevel = depth >= m_settings.maxDepth;
+		FILE* spills[8] = {};
+		uint64_t spillCounts[8] = {};
+		std::vector<CloudPoint> spillBlocks[8];
+		auto flushSpill = [&](int octant) {
+			//After a failure the build is thrown away, don't keep writing
+			if (!spills[octant] && !m_failed) {
+				std::string path = m_spillPath + std::to_string(depth) + "_" + std::to_string(octant);
+				spills[octant] = fopen(path.c_str(), "wb");
+				if (!spills[octant]) {
+					printf("buildPointCloudOctree: can't write %s\n", path.c_str());
+					m_failed = true;
+				}
+			}
+			if (spills[octant] && fwrite(spillBlocks[octant].data(), sizeof(CloudPoint), spillBlocks[octant].size(), spills[octant]) != spillBlocks[octant].size()) {
+				printf("buildPointCloudOctree: failed writing a spill file, is the disk full?\n");
+				m_failed = true;
+			}
+			spillBlocks[octant].clear();
+		};
+		auto spill = [&](const CloudPoint& point) {
+			if (lastLevel) {
+				m_stats.droppedPoints++;
+				return;
+			}
+			int octant = octantOf(point.position, middle);
+			spillBlocks[octant].push_back(point);
+			spillCounts[octant]++;
+			if (spillBlocks[octant].size() >= 16 * 1024)
+				flushSpill(octant);
+		};
+
+		std::vector<CloudPoint> block(64 * 1024);
+		size_t blockCount;
+		uint64_t seen = 0;
+		while ((blockCount = source(block.data(), block.size())) > 0)
+		{
+			seen += blockCount;
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				Ranked ranked = { pointPriority(block[i]), block[i] };
+				if (kept.size() < m_settings.nodeCapacity) {
+					kept.push_back(ranked);
+					std::push_heap(kept.begin(), kept.end(), lower);
+				}
+				else if (ranked.first < kept.front().first) {
+					spill(kept.front().second);
+					std::pop_heap(kept.begin(), kept.end(), lower);
+					kept.back() = ranked;
+					std::push_heap(kept.begin(), kept.end(), lower);
+				}
+				else
+					spill(block[i]);
+			}
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			if (!spillBlocks[i].empty())
+				flushSpill(i);
+			if (spills[i] && fclose(spills[i]) != 0)
+				m_failed = true;
+		}
+		if (seen != count) {
+			printf("buildPointCloudOctree: read %llu of %llu points\n", (unsigned long long)seen, (unsigned long long)count);
+			m_failed = true;
+		}
+
+		std::vector<CloudPoint> points(kept.size());
+		for (size_t i = 0; i < kept.size(); i++)
+		{
+			points[i] = kept[i].second;
+		}
+		int node = addNode(min, size, depth, points.data(), (uint32_t)points.size());
+		points = std::vector<CloudPoint>();
+		kept = std::vector<Ranked>();
+
+		//Children one at a time, each reads its file back and may spill again
+		float half = size * 0.5f;
+		for (int i = 0; i < 8; i++)
+		{
+			if (spillCounts[i] == 0)
+				continue;
+			std::string path = m_spillPath + std::to_string(depth) + "_" + std::to_string(i);
+			FILE* file = m_failed ? nullptr : fopen(path.c_str(), "rb");
+			if (!file && !m_failed) {
+				printf("buildPointCloudOctree: can't read %s back\n", path.c_str());
+				m_failed = true;
+			}
+			else if (file) {
+				glm::vec3 childMin = min + glm::vec3(i & 1 ? half : 0.0f, i & 2 ? half : 0.0f, i & 4 ? half : 0.0f);
+				int child = buildStreamed([file](CloudPoint* out, size_t maxCount) { return fread(out, sizeof(CloudPoint), maxCount, file); },
+					spillCounts[i], childMin, half, depth + 1);
+				m_nodes[node].children[i] = child;
+				fclose(file);
+			}
+			remove(path.c_str());
+		}
+		return node;
+	}
+
+	bool buildPointCloudOctree(const std::string& inputPath, const std::string& outputPath, const PointCloudBuildSettings& settings, PointCloudBuildStats* stats)
+	{
+		auto start = std::chrono::steady_clock::now();
+		PointCloudBuildStats localStats;
+		PointCloudBuildStats& buildStats = stats ? *stats : localStats;
+		buildStats = PointCloudBuildStats();
+
+		PointCloudReader reader;
+		if (!reader.open(inputPath))
+			return false;
+
+		//First pass for the bounds, the cloud is stored relative to their center
+		std::vector<SourcePoint> block(64 * 1024);
+		double boundsMin[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL }, boundsMax[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+		uint64_t count = 0;
+		size_t blockCount;
+		while ((blockCount = reader.read(block.data(), block.size())) > 0)
+		{
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					boundsMin[axis] = std::min(boundsMin[axis], block[i].position[axis]);
+					boundsMax[axis] = std::max(boundsMax[axis], block[i].position[axis]);
+				}
+			}
+			count += blockCount;
+		}
+		if (count == 0) {
+			printf("buildPointCloudOctree: no points in %s\n", inputPath.c_str());
+			return false;
+		}
+
+		OctreeFileHeader header = {};
+		memcpy(header.magic, "JPCO", 4);
+		header.version = OCTREE_FILE_VERSION;
+		header.nodeCapacity = settings.nodeCapacity;
+		double extent = 0.0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			header.origin[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5;
+			extent = std::max(extent, boundsMax[axis] - boundsMin[axis]);
+		}
+		//A little larger, so float rounding can't put points outside the root
+		header.rootSize = (float)(extent * 1.001 + 1e-3);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			header.rootMin[axis] = -header.rootSize * 0.5f;
+		}
+
+		FILE* output = fopen(outputPath.c_str(), "wb");
+		if (!output) {
+			printf("buildPointCloudOctree: can't write %s\n", outputPath.c_str());
+			return false;
+		}
+		fwrite(&header, sizeof(header), 1, output);
+
+		reader.rewind();
+		OctreeBuilder builder(settings, output, outputPath + ".spill", buildStats);
+		PointSource source = [&](CloudPoint* points, size_t maxCount) {
+			size_t read = reader.read(block.data(), std::min(maxCount, block.size()));
+			for (size_t i = 0; i < read; i++)
+			{
+				points[i].position = glm::vec3((float)(block[i].position[0] - header.origin[0]),
+					(float)(block[i].position[1] - header.origin[1]), (float)(block[i].position[2] - header.origin[2]));
+				points[i].color = block[i].color;
+			}
+			return read;
+		};
+		glm::vec3 rootMin = glm::vec3(header.rootMin[0], header.rootMin[1], header.rootMin[2]);
+		builder.buildStreamed(source, count, rootMin, header.rootSize, 0);
+
+		const std::vector<OctreeFileNode>& nodes = builder.getNodes();
+		header.nodeCount = (uint32_t)nodes.size();
+		//What actually reached the file, the node table follows it
+		header.pointCount = builder.getPointsWritten();
+		header.nodeTableOffset = sizeof(header) + header.pointCount * sizeof(CloudPoint);
+		bool written = fwrite(nodes.data(), sizeof(OctreeFileNode), nodes.size(), output) == nodes.size();
+		written = written && seekPointCloudFile(output, 0) && fwrite(&header, sizeof(header), 1, output) == 1;
+		fclose(output);
+		if (!written || builder.failed()) {
+			printf("buildPointCloudOctree: failed writing %s\n", outputPath.c_str());
+			remove(outputPath.c_str());
+			return false;
+		}
+
+		buildStats.points = header.pointCount;
+		buildStats.nodes = (int)nodes.size();
+		buildStats.seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+}
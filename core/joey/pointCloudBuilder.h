@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	// One point as stored in an octree file and on the GPU, relative to the cloud's origin
+	struct CloudPoint {
+		glm::vec3 position;
+		uint32_t color; //RGBA8, red in the lowest byte
+	};
+
+	// Point straight from a source file, at full precision so georeferenced coordinates survive
+	struct SourcePoint {
+		double position[3];
+		uint32_t color;
+	};
+
+	// Streams points out of a PLY (ascii or binary, vertex x/y/z with optional red/green/blue) or an
+	// XYZ text file ("x y z [r g b]" per line), a block at a time. Never holds more than one block
+	class PointCloudReader {
+	public:
+		PointCloudReader() = default;
+		~PointCloudReader();
+		PointCloudReader(const PointCloudReader&) = delete;
+		PointCloudReader& operator=(const PointCloudReader&) = delete;
+
+		// Picks the format by extension, false with a printed error if the file can't be read
+		bool open(const std::string& filePath);
+		// Back to the first point
+		bool rewind();
+		// Up to maxCount points into points, 0 at the end of the file
+		size_t read(SourcePoint* points, size_t maxCount);
+		// Known up front for PLY, 0 for XYZ
+		inline uint64_t getPointCount()const { return m_pointCount; }
+	private:
+		enum class Format { PLY_ASCII, PLY_BINARY_LE, PLY_BINARY_BE, XYZ };
+		struct Property {
+			int type; //Index into the PLY scalar types, see pointCloudBuilder.cpp
+			int offset; //Bytes into a binary vertex
+		};
+
+		bool readPlyHeader();
+		bool readLine(std::string& line);
+
+		FILE* m_file = nullptr;
+		Format m_format = Format::XYZ;
+		long m_dataStart = 0;
+		uint64_t m_pointCount = 0;
+		uint64_t m_pointsRead = 0;
+		std::vector<Property> m_properties;
+		int m_vertexBytes = 0;
+		int m_positionProperty[3] = { -1, -1, -1 };
+		int m_colorProperty[3] = { -1, -1, -1 };
+		std::vector<unsigned char> m_block;
+	};
+
+	struct PointCloudBuildSettings {
+		unsigned int nodeCapacity = 20000; //Points kept by each node, also the GPU slot size
+		size_t memoryPoints = 8 * 1024 * 1024; //Subtrees larger than this are split through temporary files
+		int maxDepth = 20; //Nodes this deep keep nodeCapacity points and drop the rest
+	};
+
+	struct PointCloudBuildStats {
+		uint64_t points = 0;
+		uint64_t droppedPoints = 0; //Past maxDepth, usually duplicates
+		int nodes = 0;
+		int depth = 0;
+		int spillPasses = 0; //Subtrees that went through temporary files
+		float seconds = 0.0f;
+	};
+
+	// Sorts a point cloud file into an octree file for joey::PointCloud. Each node keeps a random subsample
+	// of nodeCapacity points of its subtree and passes the rest on to its children, so drawing a node and
+	// its ancestors is a uniform thinning of the cloud. Which points a node keeps depends only on the points,
+	// not the file order. Subtrees larger than memoryPoints are streamed through temporary files next to
+	// outputPath, so any size of cloud builds in bounded memory. False with a printed error on failure
+	bool buildPointCloudOctree(const std::string& inputPath, const std::string& outputPath,
+		const PointCloudBuildSettings& settings = PointCloudBuildSettings(), PointCloudBuildStats* stats = nullptr);
+
+	//Octree file layout: OctreeFileHeader, every node's points, then nodeCount OctreeFileNodes
+	struct OctreeFileHeader {
+		char magic[4]; //"JPCO"
+		uint32_t version;
+		uint32_t nodeCount;
+		uint32_t nodeCapacity;
+		uint64_t pointCount;
+		uint64_t nodeTableOffset;
+		double origin[3]; //Added to every point to get back source coordinates
+		float rootMin[3];
+		float rootSize;
+	};
+
+	struct OctreeFileNode {
+		float min[3];
+		float size;
+		uint64_t firstPoint; //In points from the end of the header
+		uint32_t pointCount;
+		int32_t children[8]; //Node indices, -1 for none. Child i covers octant x = i & 1, y = i & 2, z = i & 4
+		int32_t depth;
+	};
+
+	const uint32_t OCTREE_FILE_VERSION = 1;
+
+	// fseek to an absolute offset, past 2 GB too
+	bool seekPointCloudFile(FILE* file, uint64_t offset);
+}
@@ -0,0 +1,290 @@
+#include "pointShadowAtlas.h"
+#include "frustum.h"
+#include "cpuProfiler.h"
+#include "renderStats.h"
+#include "../ew/external/glad.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+
+namespace joey
+{
+	//std140 layout of RenderFace in pointShadow.geom
+	struct GPURenderFace {
+		glm::mat4 viewProjection;
+		glm::vec4 lightPosRadius;
+		int layer[4];
+	};
+
+	//Standard cube map orientation, +X -X +Y -Y +Z -Z
+	static const glm::vec3 FACE_DIRECTIONS[6] = {
+		glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0),
+		glm::vec3(0, 1, 0), glm::vec3(0, -1, 0),
+		glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+	};
+	static const glm::vec3 FACE_UPS[6] = {
+		glm::vec3(0, -1, 0), glm::vec3(0, -1, 0),
+		glm::vec3(0, 0, 1), glm::vec3(0, 0, -1),
+		glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+	};
+
+	PointShadowAtlas::PointShadowAtlas(int maxLights, int faceSize, int slotCount, ShaderCache* shaderCache)
+		: m_maxLights(maxLights),
+		m_faceSize(faceSize),
+		m_slotCount(slotCount > 0 ? slotCount : maxLights * 6),
+		m_shader(shaderCache
+			? ew::Shader("assets/core/pointShadow.vert", "assets/core/pointShadow.geom", "assets/core/pointShadow.frag", shaderCache)
+			: ew::Shader("assets/core/pointShadow.vert", "assets/core/pointShadow.geom", "assets/core/pointShadow.frag"))
+	{
+		m_faces.resize(maxLights * 6);
+		m_gpuFaces.resize(maxLights * 6);
+		for (GPUFace& gpuFace : m_gpuFaces)
+		{
+			gpuFace.viewProjection = glm::mat4(1.0f);
+			gpuFace.layer[0] = -1;
+		}
+		m_lights.resize(maxLights);
+		m_slotOwners.assign(m_slotCount, -1);
+		for (int i = m_slotCount - 1; i >= 0; i--)
+		{
+			m_freeSlots.push_back(i);
+		}
+
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_texture);
+		glTextureStorage3D(m_texture, 1, GL_DEPTH_COMPONENT16, faceSize, faceSize, m_slotCount);
+		//Only ever sampled through sampler2DArrayShadow
+		glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		//Layered attachment, gl_Layer picks the slot
+		glCreateFramebuffers(1, &m_fbo);
+		glNamedFramebufferTexture(m_fbo, GL_DEPTH_ATTACHMENT, m_texture, 0);
+		glNamedFramebufferDrawBuffer(m_fbo, GL_NONE);
+		glNamedFramebufferReadBuffer(m_fbo, GL_NONE);
+
+		glCreateBuffers(1, &m_faceBuffer);
+		glNamedBufferStorage(m_faceBuffer, sizeof(GPUFace) * m_faces.size(), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &m_renderBuffer);
+		glNamedBufferStorage(m_renderBuffer, sizeof(GPURenderFace) * MAX_FACES_PER_PASS, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	PointShadowAtlas::~PointShadowAtlas()
+	{
+		glDeleteBuffers(1, &m_renderBuffer);
+		glDeleteBuffers(1, &m_faceBuffer);
+		glDeleteFramebuffers(1, &m_fbo);
+		glDeleteTextures(1, &m_texture);
+	}
+
+	void PointShadowAtlas::invalidate()
+	{
+		for (Face& face : m_faces)
+		{
+			face.dirty = true;
+		}
+	}
+
+	/// <summary>
+	/// Gives faceIndex a slot, evicting the resident face whose light currently matters least.
+	/// Fails if every resident face belongs to a light at least as important.
+	/// </summary>
+	bool PointShadowAtlas::acquireSlot(int faceIndex)
+	{
+		if (m_faces[faceIndex].slot >= 0)
+			return true;
+
+		if (m_freeSlots.empty())
+		{
+			int victimSlot = -1;
+			float victimPriority = m_lights[faceIndex / 6].priority;
+			for (int slot = 0; slot < m_slotCount; slot++)
+			{
+				if (m_faces[m_slotOwners[slot]].queued)
+					continue;
+				float priority = m_lights[m_slotOwners[slot] / 6].priority;
+				if (priority < victimPriority)
+				{
+					victimPriority = priority;
+					victimSlot = slot;
+				}
+			}
+			if (victimSlot < 0)
+				return false;
+
+			Face& victim = m_faces[m_slotOwners[victimSlot]];
+			victim.slot = -1;
+			victim.dirty = true;
+			m_gpuFaces[m_slotOwners[victimSlot]].layer[0] = -1;
+			m_faceBufferDirty = true;
+			m_slotOwners[victimSlot] = -1;
+			m_freeSlots.push_back(victimSlot);
+		}
+
+		int slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		m_slotOwners[slot] = faceIndex;
+		m_faces[faceIndex].slot = slot;
+		return true;
+	}
+
+	void PointShadowAtlas::update(const PointShadowLight* lights, int numLights, const ew::Camera& camera, int faceBudget)
+	{
+		JOEY_CPU_ZONE("PointShadowAtlas::update");
+		numLights = std::min(numLights, m_maxLights);
+		//Anything picked last frame but never rendered is picked again below
+		for (int faceIndex : m_refreshList)
+		{
+			m_faces[faceIndex].queued = false;
+		}
+		m_refreshList.clear();
+
+		Frustum frustum = Frustum::fromMatrix(camera.projectionMatrix() * camera.viewMatrix());
+		float viewHeight = camera.orthographic ? camera.orthoHeight * 0.5f : tanf(glm::radians(camera.fov) * 0.5f);
+
+		//Slightly wider than 90 degrees so filtering at face edges stays inside the face
+		float faceFov = 2.0f * atanf(1.0f + 2.0f / m_faceSize);
+
+		for (int i = 0; i < numLights; i++)
+		{
+			const PointShadowLight& light = lights[i];
+			CachedLight& cached = m_lights[i];
+			if (light.radius <= 0.0f)
+			{
+				cached.priority = 0.0f;
+				continue;
+			}
+
+			if (!cached.valid || cached.position != light.position || cached.radius != light.radius)
+			{
+				cached.position = light.position;
+				cached.radius = light.radius;
+				cached.valid = true;
+
+				glm::mat4 projection = glm::perspective(faceFov, 1.0f, 0.01f, light.radius);
+				for (int f = 0; f < 6; f++)
+				{
+					Face& face = m_faces[i * 6 + f];
+					face.viewProjection = projection * glm::lookAt(light.position, light.position + FACE_DIRECTIONS[f], FACE_UPS[f]);
+					face.dirty = true;
+				}
+			}
+
+			//Screen influence: rough projected size of the light's sphere, 0 when off screen
+			float influence = 0.0f;
+			if (frustum.intersectsSphere(light.position, light.radius))
+			{
+				float distance = glm::length(light.position - camera.position);
+				float extent = camera.orthographic ? viewHeight : distance * viewHeight;
+				influence = distance <= light.radius ? 1.0f : glm::clamp(light.radius / extent, 0.0f, 1.0f);
+			}
+			cached.priority = light.importance * influence;
+		}
+		for (int i = numLights; i < m_maxLights; i++)
+		{
+			m_lights[i].priority = 0.0f;
+		}
+
+		//Gather stale faces of visible lights, oldest and most important first
+		std::vector<std::pair<float, int>> candidates;
+		m_dirtyFaces = 0;
+		for (int i = 0; i < numLights * 6; i++)
+		{
+			Face& face = m_faces[i];
+			if (!face.dirty)
+				continue;
+			m_dirtyFaces++;
+			float priority = m_lights[i / 6].priority;
+			if (priority > 0.0f)
+			{
+				candidates.push_back(std::make_pair(priority * (1.0f + face.age), i));
+			}
+			face.age++;
+		}
+		int count = std::min(faceBudget, (int)candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+			[](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+
+		for (int i = 0; i < count; i++)
+		{
+			int faceIndex = candidates[i].second;
+			if (!acquireSlot(faceIndex))
+				continue;
+			m_faces[faceIndex].queued = true;
+			m_refreshList.push_back(faceIndex);
+		}
+	}
+
+	void PointShadowAtlas::render(const std::function<void(const ew::Shader&)>& drawCasters)
+	{
+		JOEY_CPU_ZONE("PointShadowAtlas::render");
+		m_facesRendered = 0;
+		if (m_refreshList.empty())
+			return;
+
+		int prevFbo, prevViewport[4], prevCullFace;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+		glGetIntegerv(GL_VIEWPORT, prevViewport);
+		glGetIntegerv(GL_CULL_FACE_MODE, &prevCullFace);
+
+		bindFramebuffer(m_fbo);
+		glViewport(0, 0, m_faceSize, m_faceSize);
+		glCullFace(GL_BACK);
+
+		//Only the refreshed layers are cleared, cached faces stay untouched
+		float clearDepth = 1.0f;
+		for (int faceIndex : m_refreshList)
+		{
+			glClearTexSubImage(m_texture, 0, 0, 0, m_faces[faceIndex].slot, m_faceSize, m_faceSize, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &clearDepth);
+		}
+
+		m_shader.use();
+		glBindBufferBase(GL_UNIFORM_BUFFER, RENDER_FACE_BINDING, m_renderBuffer);
+		for (size_t first = 0; first < m_refreshList.size(); first += MAX_FACES_PER_PASS)
+		{
+			int count = std::min((int)(m_refreshList.size() - first), MAX_FACES_PER_PASS);
+			GPURenderFace renderFaces[MAX_FACES_PER_PASS];
+			for (int i = 0; i < count; i++)
+			{
+				int faceIndex = m_refreshList[first + i];
+				const CachedLight& light = m_lights[faceIndex / 6];
+				renderFaces[i].viewProjection = m_faces[faceIndex].viewProjection;
+				renderFaces[i].lightPosRadius = glm::vec4(light.position, light.radius);
+				renderFaces[i].layer[0] = m_faces[faceIndex].slot;
+			}
+			glNamedBufferSubData(m_renderBuffer, 0, sizeof(GPURenderFace) * count, renderFaces);
+			m_shader.setInt("_FaceCount", count);
+			drawCasters(m_shader);
+		}
+
+		for (int faceIndex : m_refreshList)
+		{
+			Face& face = m_faces[faceIndex];
+			face.dirty = false;
+			face.queued = false;
+			face.age = 0;
+			m_gpuFaces[faceIndex].viewProjection = face.viewProjection;
+			m_gpuFaces[faceIndex].layer[0] = face.slot;
+		}
+		m_facesRendered = (int)m_refreshList.size();
+		m_refreshList.clear();
+		m_faceBufferDirty = true;
+
+		bindFramebuffer(prevFbo);
+		glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+		glCullFace(prevCullFace);
+	}
+
+	void PointShadowAtlas::bind(int textureUnit)
+	{
+		if (m_faceBufferDirty)
+		{
+			glNamedBufferSubData(m_faceBuffer, 0, sizeof(GPUFace) * m_gpuFaces.size(), m_gpuFaces.data());
+			m_faceBufferDirty = false;
+		}
+		bindTextureUnit(textureUnit, m_texture);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FACE_BUFFER_BINDING, m_faceBuffer);
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include "../ew/camera.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+namespace joey
+{
+	class ShaderCache;
+
+	struct PointShadowLight {
+		glm::vec3 position;
+		float radius;
+		float importance = 1.0f; //Scales refresh priority, e.g. light brightness
+	};
+
+	// Omnidirectional shadows for many point lights in one depth texture array.
+	// Every cube face gets a layer ("slot") of the atlas. Faces are only re-rendered when their light
+	// moved or the scene was invalidated, at most faceBudget per frame, most important first.
+	// Casters are drawn once per frame and a geometry shader routes each triangle to every refreshed face.
+	class PointShadowAtlas {
+	public:
+		static const int FACE_BUFFER_BINDING = 3; //std430 PointShadowFaces in pointShadowSample.glsl
+		static const int RENDER_FACE_BINDING = 4; //std140 PointShadowRenderFaces in pointShadow.geom
+		static const int MAX_FACES_PER_PASS = 32; //Geometry shader invocations
+
+		// slotCount 0 = one slot for every face of maxLights lights. With a shader cache the
+		// program is built through it, its finish() has to run before the first render()
+		PointShadowAtlas(int maxLights, int faceSize = 256, int slotCount = 0, ShaderCache* shaderCache = nullptr);
+		~PointShadowAtlas();
+		PointShadowAtlas(const PointShadowAtlas&) = delete;
+		PointShadowAtlas& operator=(const PointShadowAtlas&) = delete;
+
+		// Picks the faces to refresh this frame and uploads the lookup buffer
+		void update(const PointShadowLight* lights, int numLights, const ew::Camera& camera, int faceBudget);
+		// Renders the faces picked by update(). drawCasters should set _Model and draw every shadow caster
+		void render(const std::function<void(const ew::Shader&)>& drawCasters);
+		// Marks every face stale, e.g. after shadow casters moved
+		void invalidate();
+		// Uploads pending face changes and binds the atlas texture + face lookup buffer for pointShadowSample.glsl
+		void bind(int textureUnit);
+
+		inline unsigned int getTexture()const { return m_texture; }
+		inline int getFaceSize()const { return m_faceSize; }
+		inline int getSlotCount()const { return m_slotCount; }
+		inline int getFacesRendered()const { return m_facesRendered; }
+		inline int getResidentFaces()const { return m_slotCount - (int)m_freeSlots.size(); }
+		inline int getDirtyFaces()const { return m_dirtyFaces; }
+		inline size_t getMemoryBytes()const { return (size_t)m_faceSize * m_faceSize * m_slotCount * 2; }
+	private:
+		struct Face {
+			glm::mat4 viewProjection;
+			int slot = -1;
+			bool dirty = true;
+			bool queued = false; //In this frame's refresh list
+			int age = 0; //Frames spent waiting while dirty
+		};
+		//std430 layout of PointShadowFace in pointShadowSample.glsl
+		struct GPUFace {
+			glm::mat4 viewProjection; //As last rendered, so stale faces stay consistent
+			int layer[4];
+		};
+		struct CachedLight {
+			glm::vec3 position;
+			float radius = 0.0f;
+			float priority = 0.0f;
+			bool valid = false;
+		};
+
+		int m_maxLights;
+		int m_faceSize;
+		int m_slotCount;
+		unsigned int m_texture = 0;
+		unsigned int m_fbo = 0;
+		unsigned int m_faceBuffer = 0; //Sampling side, 6 faces per light
+		unsigned int m_renderBuffer = 0; //Render side, faces of the current pass
+		ew::Shader m_shader;
+
+		std::vector<Face> m_faces;
+		std::vector<GPUFace> m_gpuFaces;
+		std::vector<CachedLight> m_lights;
+		std::vector<int> m_freeSlots;
+		std::vector<int> m_slotOwners; //Face index per slot, -1 if free
+		std::vector<int> m_refreshList; //Face indices to render this frame
+		bool m_faceBufferDirty = true;
+		int m_facesRendered = 0;
+		int m_dirtyFaces = 0;
+
+		bool acquireSlot(int faceIndex);
+	};
+}
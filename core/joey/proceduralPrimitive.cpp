@@ -0,0 +1,30 @@
+#include "proceduralPrimitive.h"
+#include "renderStats.h"
+
+namespace joey
+{
+	//Core profile draws need a vertex array bound even when it has no attributes
+	static unsigned int s_emptyVertexArray = 0;
+
+	int proceduralVertexCount(ProceduralShape shape, int subdivisions)
+	{
+		switch (shape)
+		{
+		case ProceduralShape::PLANE:
+		case ProceduralShape::SPHERE:
+			return subdivisions * subdivisions * 6;
+		case ProceduralShape::CYLINDER:
+			//Two cap fans and a row of quads
+			return subdivisions * 12;
+		}
+		return 0;
+	}
+
+	void drawProcedural(ProceduralShape shape, int subdivisions, int instanceCount, int baseInstance)
+	{
+		if (!s_emptyVertexArray)
+			glCreateVertexArrays(1, &s_emptyVertexArray);
+		bindVertexArray(s_emptyVertexArray);
+		drawArraysInstanced(GL_TRIANGLES, 0, proceduralVertexCount(shape, subdivisions), instanceCount, baseInstance);
+	}
+}
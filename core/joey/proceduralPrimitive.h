@@ -0,0 +1,19 @@
+#pragma once
+
+namespace joey
+{
+	// Shapes of core/procedural.glsl, matching ew's procGen meshes
+	enum class ProceduralShape {
+		PLANE,
+		SPHERE,
+		CYLINDER
+	};
+
+	// Vertices per instance, as a non indexed triangle list
+	int proceduralVertexCount(ProceduralShape shape, int subdivisions);
+
+	// Instances of a shape with no vertex or index buffers, the bound shader builds each vertex from
+	// gl_VertexID with the same subdivisions (see core/procedural.glsl). Instance i reads draw data
+	// baseInstance + i (CURRENT_INSTANCE in drawData.glsl)
+	void drawProcedural(ProceduralShape shape, int subdivisions, int instanceCount, int baseInstance = 0);
+}
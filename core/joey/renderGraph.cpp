@@ -0,0 +1,420 @@
+#include "renderGraph.h"
+#include "gpuProfiler.h"
+#include "cpuProfiler.h"
+#include "renderStats.h"
+#include <stdio.h>
+#include <set>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace joey
+{
+	void RGPass::read(RGHandle texture)
+	{
+		m_reads.push_back(texture);
+	}
+
+	RGHandle RGPass::writeColor(RGHandle target, bool clear, const glm::vec4& clearColor)
+	{
+		Attachment attachment = { target, clear, clearColor };
+		m_colorWrites.push_back(attachment);
+		return m_graph->newVersion(target, m_index);
+	}
+
+	RGHandle RGPass::writeDepth(RGHandle target, bool clear)
+	{
+		m_depthWrite = { target, clear, glm::vec4(1.0f) };
+		return m_graph->newVersion(target, m_index);
+	}
+
+	RGHandle RGPass::write(RGHandle target)
+	{
+		m_writes.push_back(target);
+		return m_graph->newVersion(target, m_index);
+	}
+
+	RenderGraph::RenderGraph(RenderTargetPool* pool)
+		: m_pool(pool)
+	{
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		reset();
+		flushFramebuffers();
+	}
+
+	RGHandle RenderGraph::createTexture(const std::string& name, unsigned int width, unsigned int height, int format, int filter)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.width = width;
+		resource.height = height;
+		resource.format = format;
+		resource.filter = filter;
+		resource.producers.push_back(-1);
+		m_resources.push_back(resource);
+
+		RGHandle handle;
+		handle.resource = (int)m_resources.size() - 1;
+		return handle;
+	}
+
+	RGHandle RenderGraph::importTexture(const std::string& name, unsigned int texture, unsigned int width, unsigned int height)
+	{
+		RGHandle handle = createTexture(name, width, height, 0);
+		m_resources[handle.resource].texture = texture;
+		m_resources[handle.resource].imported = true;
+		return handle;
+	}
+
+	RGHandle RenderGraph::importBackbuffer(unsigned int width, unsigned int height)
+	{
+		RGHandle handle = importTexture("Backbuffer", 0, width, height);
+		m_resources[handle.resource].backbuffer = true;
+		return handle;
+	}
+
+	RGPass& RenderGraph::addPass(const std::string& name, const std::function<void(RenderGraph&)>& execute)
+	{
+		std::unique_ptr<RGPass> pass(new RGPass());
+		pass->m_graph = this;
+		pass->m_index = (int)m_passes.size();
+		pass->m_name = name;
+#if JOEY_CPU_PROFILER
+		//Interning locks, outside of the zones it would otherwise be timed in
+		pass->m_zoneName = cpuProfilerIntern(name);
+#endif
+		pass->m_execute = execute;
+		m_passes.push_back(std::move(pass));
+		return *m_passes.back();
+	}
+
+	void RenderGraph::markOutput(RGHandle handle)
+	{
+		Resource& resource = m_resources[handle.resource];
+		resource.output = true;
+		int producer = producerOf(handle);
+		if (producer >= 0)
+			m_passes[producer]->m_sideEffect = true;
+	}
+
+	RGHandle RenderGraph::newVersion(RGHandle handle, int producer)
+	{
+		Resource& resource = m_resources[handle.resource];
+		if (handle.version != resource.versionCount - 1) {
+			printf("RenderGraph: %s written from an old version\n", resource.name.c_str());
+		}
+		resource.producers.push_back(producer);
+		resource.versionCount++;
+
+		RGHandle next;
+		next.resource = handle.resource;
+		next.version = resource.versionCount - 1;
+		return next;
+	}
+
+	int RenderGraph::producerOf(RGHandle handle)const
+	{
+		return m_resources[handle.resource].producers[handle.version];
+	}
+
+	/// <summary>
+	/// Marks passes alive by walking back from passes with side effects (backbuffer writes,
+	/// outputs, setSideEffect) through the producers of everything they consume.
+	/// </summary>
+	void RenderGraph::cull()
+	{
+		std::vector<int> stack;
+		for (const std::unique_ptr<RGPass>& pass : m_passes)
+		{
+			pass->m_alive = false;
+			bool root = pass->m_sideEffect;
+			for (const RGPass::Attachment& attachment : pass->m_colorWrites)
+			{
+				root |= m_resources[attachment.input.resource].backbuffer;
+			}
+			if (root)
+				stack.push_back(pass->m_index);
+		}
+
+		while (!stack.empty())
+		{
+			RGPass& pass = *m_passes[stack.back()];
+			stack.pop_back();
+			if (pass.m_alive)
+				continue;
+			pass.m_alive = true;
+
+			std::vector<RGHandle> needed = pass.m_reads;
+			needed.insert(needed.end(), pass.m_writes.begin(), pass.m_writes.end());
+			//Cleared targets don't need whoever wrote them before
+			for (const RGPass::Attachment& attachment : pass.m_colorWrites)
+			{
+				if (!attachment.clear)
+					needed.push_back(attachment.input);
+			}
+			if (pass.m_depthWrite.input.isValid() && !pass.m_depthWrite.clear)
+				needed.push_back(pass.m_depthWrite.input);
+
+			for (RGHandle handle : needed)
+			{
+				int producer = producerOf(handle);
+				if (producer >= 0 && !m_passes[producer]->m_alive)
+					stack.push_back(producer);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Topological order of the alive passes, ties broken by declaration order.
+	/// A write also waits for every reader of the version it overwrites.
+	/// </summary>
+	void RenderGraph::sort()
+	{
+		size_t count = m_passes.size();
+		std::vector<std::set<int>> dependencies(count);
+		for (const std::unique_ptr<RGPass>& pass : m_passes)
+		{
+			if (!pass->m_alive)
+				continue;
+
+			std::vector<RGHandle> inputs = pass->m_reads;
+			std::vector<RGHandle> writeInputs = pass->m_writes;
+			for (const RGPass::Attachment& attachment : pass->m_colorWrites)
+			{
+				writeInputs.push_back(attachment.input);
+			}
+			if (pass->m_depthWrite.input.isValid())
+				writeInputs.push_back(pass->m_depthWrite.input);
+			inputs.insert(inputs.end(), writeInputs.begin(), writeInputs.end());
+
+			for (RGHandle handle : inputs)
+			{
+				int producer = producerOf(handle);
+				if (producer >= 0 && producer != pass->m_index && m_passes[producer]->m_alive)
+					dependencies[pass->m_index].insert(producer);
+			}
+			//Write after read on the same storage
+			for (RGHandle handle : writeInputs)
+			{
+				for (const std::unique_ptr<RGPass>& reader : m_passes)
+				{
+					if (reader.get() == pass.get() || !reader->m_alive)
+						continue;
+					for (RGHandle read : reader->m_reads)
+					{
+						if (read.resource == handle.resource && read.version == handle.version)
+							dependencies[pass->m_index].insert(reader->m_index);
+					}
+				}
+			}
+		}
+
+		m_order.clear();
+		std::vector<bool> scheduled(count, false);
+		bool progress = true;
+		while (progress)
+		{
+			progress = false;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (scheduled[i] || !m_passes[i]->m_alive)
+					continue;
+				bool ready = true;
+				for (int dependency : dependencies[i])
+				{
+					ready &= scheduled[dependency];
+				}
+				if (ready) {
+					scheduled[i] = true;
+					m_order.push_back((int)i);
+					progress = true;
+					break;
+				}
+			}
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			if (m_passes[i]->m_alive && !scheduled[i]) {
+				printf("RenderGraph: dependency cycle at pass %s\n", m_passes[i]->m_name.c_str());
+				m_order.push_back((int)i);
+			}
+		}
+	}
+
+	void RenderGraph::computeLifetimes()
+	{
+		for (size_t position = 0; position < m_order.size(); position++)
+		{
+			const RGPass& pass = *m_passes[m_order[position]];
+			std::vector<RGHandle> used = pass.m_reads;
+			used.insert(used.end(), pass.m_writes.begin(), pass.m_writes.end());
+			for (const RGPass::Attachment& attachment : pass.m_colorWrites)
+			{
+				used.push_back(attachment.input);
+			}
+			if (pass.m_depthWrite.input.isValid())
+				used.push_back(pass.m_depthWrite.input);
+
+			for (RGHandle handle : used)
+			{
+				Resource& resource = m_resources[handle.resource];
+				if (resource.firstUse < 0)
+					resource.firstUse = (int)position;
+				resource.lastUse = (int)position;
+			}
+		}
+		for (Resource& resource : m_resources)
+		{
+			if (resource.output && resource.firstUse >= 0)
+				resource.lastUse = (int)m_order.size();
+		}
+	}
+
+	void RenderGraph::execute()
+	{
+		JOEY_CPU_ZONE("RenderGraph::execute");
+		cull();
+		sort();
+		computeLifetimes();
+
+		if (m_pool->getGeneration() != m_poolGeneration) {
+			flushFramebuffers();
+			m_poolGeneration = m_pool->getGeneration();
+		}
+
+		m_stats = RenderGraphStats();
+		m_stats.passesDeclared = (int)m_passes.size();
+		m_stats.passesCulled = (int)(m_passes.size() - m_order.size());
+		std::set<unsigned int> physicalTextures;
+
+		for (size_t position = 0; position < m_order.size(); position++)
+		{
+			for (Resource& resource : m_resources)
+			{
+				if (resource.imported || resource.firstUse != (int)position)
+					continue;
+				resource.texture = m_pool->acquireTexture(resource.width, resource.height, resource.format, resource.filter);
+				size_t bytes = (size_t)resource.width * resource.height * getFormatBytesPerPixel(resource.format);
+				m_stats.unaliasedBytes += bytes;
+				m_stats.transientTextures++;
+				if (physicalTextures.insert(resource.texture).second)
+					m_stats.physicalBytes += bytes;
+			}
+
+			RGPass& pass = *m_passes[m_order[position]];
+			JOEY_CPU_ZONE(pass.m_zoneName);
+			if (m_profiler)
+				m_profiler->beginPass(pass.m_name);
+			renderStatsBeginPass(pass.m_name);
+			bindPassTarget(pass);
+			pass.m_execute(*this);
+			renderStatsEndPass();
+			if (m_profiler)
+				m_profiler->endPass();
+
+			//Done with it, later passes may get the same texture back from the pool
+			for (Resource& resource : m_resources)
+			{
+				if (resource.imported || resource.lastUse != (int)position)
+					continue;
+				m_pool->releaseTexture(resource.texture);
+			}
+		}
+		m_stats.physicalTextures = (int)physicalTextures.size();
+
+		m_passLog.clear();
+		for (int index : m_order)
+		{
+			m_passLog.push_back(m_passes[index]->m_name);
+		}
+		for (const std::unique_ptr<RGPass>& pass : m_passes)
+		{
+			if (!pass->m_alive)
+				m_passLog.push_back(pass->m_name + " (culled)");
+		}
+	}
+
+	/// <summary>
+	/// Binds (and clears) the pass's attachments. Passes without attachments keep the current binding.
+	/// </summary>
+	unsigned int RenderGraph::bindPassTarget(const RGPass& pass)
+	{
+		std::vector<unsigned int> key;
+		unsigned int width = 0, height = 0;
+		bool backbuffer = false;
+		for (const RGPass::Attachment& attachment : pass.m_colorWrites)
+		{
+			const Resource& resource = m_resources[attachment.input.resource];
+			backbuffer |= resource.backbuffer;
+			key.push_back(resource.texture);
+			width = resource.width;
+			height = resource.height;
+		}
+		if (pass.m_depthWrite.input.isValid()) {
+			const Resource& resource = m_resources[pass.m_depthWrite.input.resource];
+			backbuffer |= resource.backbuffer;
+			width = resource.width;
+			height = resource.height;
+		}
+		if (width == 0)
+			return 0;
+
+		unsigned int fbo = 0;
+		if (!backbuffer) {
+			//Depth last, so a color-only and a depth-only target never share a key
+			key.push_back(pass.m_depthWrite.input.isValid() ? m_resources[pass.m_depthWrite.input.resource].texture : 0);
+			key.push_back((unsigned int)pass.m_colorWrites.size());
+			auto it = m_framebuffers.find(key);
+			if (it != m_framebuffers.end()) {
+				fbo = it->second;
+			}
+			else {
+				Framebuffer framebuffer = createFramebufferFromTextures(width, height, key.data(), (int)pass.m_colorWrites.size(), key[key.size() - 2]);
+				fbo = framebuffer.fbo;
+				m_framebuffers[key] = fbo;
+			}
+		}
+
+		bindFramebuffer(fbo);
+		glViewport(0, 0, width, height);
+		for (size_t i = 0; i < pass.m_colorWrites.size(); i++)
+		{
+			if (pass.m_colorWrites[i].clear)
+				glClearNamedFramebufferfv(fbo, GL_COLOR, (int)i, glm::value_ptr(pass.m_colorWrites[i].clearColor));
+		}
+		if (pass.m_depthWrite.input.isValid() && pass.m_depthWrite.clear) {
+			//Depth clears respect the write mask
+			float clearDepth = 1.0f;
+			glDepthMask(GL_TRUE);
+			glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &clearDepth);
+		}
+		return fbo;
+	}
+
+	void RenderGraph::reset()
+	{
+		for (Resource& resource : m_resources)
+		{
+			if (resource.output && !resource.imported && resource.texture)
+				m_pool->releaseTexture(resource.texture);
+		}
+		m_resources.clear();
+		m_passes.clear();
+		m_order.clear();
+	}
+
+	unsigned int RenderGraph::getTexture(RGHandle handle)const
+	{
+		return m_resources[handle.resource].texture;
+	}
+
+	void RenderGraph::flushFramebuffers()
+	{
+		for (auto& entry : m_framebuffers)
+		{
+			glDeleteFramebuffers(1, &entry.second);
+		}
+		m_framebuffers.clear();
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "renderTargetPool.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	// A texture at one point of the frame. Every write returns a new version,
+	// so passes can be declared in any order and still be sorted correctly
+	struct RGHandle {
+		int resource = -1;
+		int version = 0;
+		inline bool isValid()const { return resource >= 0; }
+	};
+
+	class RenderGraph;
+	class GpuProfiler;
+
+	class RGPass {
+	public:
+		// Sampled by this pass
+		void read(RGHandle texture);
+		// Attached as color target i (in call order). clear = previous contents are not needed
+		RGHandle writeColor(RGHandle target, bool clear = false, const glm::vec4& clearColor = glm::vec4(0.0f));
+		// Attached as the depth target. Writing an existing depth version shares it instead of copying
+		RGHandle writeDepth(RGHandle target, bool clear = false);
+		// Written through the pass's own framebuffer, e.g. an imported texture array
+		RGHandle write(RGHandle target);
+		// Never culled, e.g. passes with effects outside of the graph
+		inline void setSideEffect() { m_sideEffect = true; }
+	private:
+		friend class RenderGraph;
+		struct Attachment {
+			RGHandle input;
+			bool clear;
+			glm::vec4 clearColor;
+		};
+		RenderGraph* m_graph = nullptr;
+		int m_index = 0;
+		std::string m_name;
+		const char* m_zoneName = nullptr; //Interned m_name, for the CPU zone around execute
+		std::function<void(RenderGraph&)> m_execute;
+		std::vector<RGHandle> m_reads;
+		std::vector<RGHandle> m_writes; //Inputs of write(), not attached
+		std::vector<Attachment> m_colorWrites;
+		Attachment m_depthWrite = { RGHandle(), false, glm::vec4(0.0f) };
+		bool m_sideEffect = false;
+		bool m_alive = false;
+	};
+
+	struct RenderGraphStats {
+		int passesDeclared = 0;
+		int passesCulled = 0;
+		int transientTextures = 0; //Distinct graph textures used this frame
+		int physicalTextures = 0; //Pool textures actually backing them
+		size_t physicalBytes = 0; //Pool memory backing them
+		size_t unaliasedBytes = 0; //What one texture per transient would cost
+	};
+
+	// Per-frame render graph. Passes declare what they read and write,
+	// execute() orders them by dependency, drops passes nobody consumes, and backs
+	// transient textures with pool textures only for the span of passes that use them,
+	// so textures with disjoint lifetimes share storage. Sharing needs the same size and format,
+	// a texture is only reused by one first used after the last pass of the other.
+	//
+	// Each frame: reset(), declare resources and passes, execute()
+	class RenderGraph {
+	public:
+		explicit RenderGraph(RenderTargetPool* pool);
+		~RenderGraph();
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		RGHandle createTexture(const std::string& name, unsigned int width, unsigned int height, int format, int filter = GL_LINEAR);
+		// Persistent texture owned elsewhere. Writing it does not keep a pass alive on its own
+		RGHandle importTexture(const std::string& name, unsigned int texture, unsigned int width, unsigned int height);
+		// The default framebuffer. Passes writing it are never culled
+		RGHandle importBackbuffer(unsigned int width, unsigned int height);
+
+		RGPass& addPass(const std::string& name, const std::function<void(RenderGraph&)>& execute);
+		// Keeps this version's producer alive and its texture valid until the next reset(), e.g. for UI previews
+		void markOutput(RGHandle handle);
+
+		// Times every executed pass under its name. nullptr to stop
+		inline void setProfiler(GpuProfiler* profiler) { m_profiler = profiler; }
+
+		void execute();
+		// Releases outputs of the previous frame and clears all declarations
+		void reset();
+
+		// Texture backing a handle. Valid inside passes that use it and for outputs until reset()
+		unsigned int getTexture(RGHandle handle)const;
+		inline const RenderGraphStats& getStats()const { return m_stats; }
+		// Pass names in execution order, culled passes last with a (culled) suffix
+		inline const std::vector<std::string>& getPassLog()const { return m_passLog; }
+	private:
+		friend class RGPass;
+		struct Resource {
+			std::string name;
+			unsigned int width;
+			unsigned int height;
+			int format;
+			int filter;
+			unsigned int texture = 0;
+			bool imported = false;
+			bool backbuffer = false;
+			bool output = false;
+			int versionCount = 1;
+			std::vector<int> producers; //Pass that produced each version, -1 for the initial contents
+			int firstUse = -1;
+			int lastUse = -1;
+		};
+
+		RenderTargetPool* m_pool;
+		GpuProfiler* m_profiler = nullptr;
+		std::vector<Resource> m_resources;
+		std::vector<std::unique_ptr<RGPass>> m_passes;
+		std::vector<int> m_order;
+		std::vector<std::string> m_passLog;
+		RenderGraphStats m_stats;
+
+		//Framebuffers keyed by their attachments, rebuilt when the pool deletes textures
+		std::map<std::vector<unsigned int>, unsigned int> m_framebuffers;
+		int m_poolGeneration = -1;
+
+		RGHandle newVersion(RGHandle handle, int producer);
+		int producerOf(RGHandle handle)const;
+		void cull();
+		void sort();
+		void computeLifetimes();
+		unsigned int bindPassTarget(const RGPass& pass);
+		void flushFramebuffers();
+	};
+}
@@ -0,0 +1,150 @@
+#include "renderQueue.h"
+#include "renderStats.h"
+#include "streamBuffer.h"
+#include "../ew/shader.h"
+#include <stdio.h>
+#include <algorithm>
+
+namespace joey
+{
+	static const int PASS_SHIFT = 60;
+	static const int STATE_SHIFT = 48;
+	static const int MATERIAL_SHIFT = 40;
+	static const int MESH_SHIFT = 24;
+	static const unsigned long long STATE_MASK = 0xFFF;
+	static const unsigned int DEPTH_MAX = 0xFFFFFF;
+
+	int RenderQueue::addState(const RenderState& state)
+	{
+		if ((int)m_states.size() >= MAX_STATES) {
+			printf("RenderQueue out of states (%d)\n", MAX_STATES);
+			return 0;
+		}
+		m_states.push_back(state);
+		return (int)m_states.size() - 1;
+	}
+
+	void RenderQueue::clearStates()
+	{
+		m_states.clear();
+	}
+
+	unsigned long long RenderQueue::makeKey(int pass, int state, int material, int mesh, float depth)
+	{
+		unsigned int quantizedDepth = (unsigned int)(std::min(std::max(depth, 0.0f), 1.0f) * DEPTH_MAX);
+		return ((unsigned long long)(pass & 0xF) << PASS_SHIFT)
+			| ((unsigned long long)(state & STATE_MASK) << STATE_SHIFT)
+			| ((unsigned long long)(material & 0xFF) << MATERIAL_SHIFT)
+			| ((unsigned long long)(mesh & 0xFFFF) << MESH_SHIFT)
+			| quantizedDepth;
+	}
+
+	void RenderQueue::clear()
+	{
+		m_items.clear();
+		m_batchCount = 0;
+		m_sorted = true;
+	}
+
+	void RenderQueue::submit(unsigned long long key, int mesh, int baseInstance)
+	{
+		m_items.push_back({ key, mesh, baseInstance });
+		m_sorted = false;
+	}
+
+	void RenderQueue::sort()
+	{
+		if (m_sorted)
+			return;
+		//LSD radix sort, a byte per pass. All histograms come from one read of the keys and
+		//bytes every key shares (usually pass and state) are skipped
+		const int DIGITS = 8;
+		size_t count = m_items.size();
+		size_t histograms[DIGITS][256] = {};
+		for (const Item& item : m_items)
+		{
+			for (int d = 0; d < DIGITS; d++)
+			{
+				histograms[d][(item.key >> (d * 8)) & 0xFF]++;
+			}
+		}
+		m_scratch.resize(count);
+		for (int d = 0; d < DIGITS; d++)
+		{
+			size_t* histogram = histograms[d];
+			if (histogram[(m_items[0].key >> (d * 8)) & 0xFF] == count)
+				continue;
+			size_t offset = 0;
+			for (int bucket = 0; bucket < 256; bucket++)
+			{
+				size_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+			for (const Item& item : m_items)
+			{
+				m_scratch[histogram[(item.key >> (d * 8)) & 0xFF]++] = item;
+			}
+			m_items.swap(m_scratch);
+		}
+		m_sorted = true;
+	}
+
+	void RenderQueue::applyState(int state)
+	{
+		const RenderState& renderState = m_states[state];
+		if (renderState.shader)
+			renderState.shader->use();
+		for (int unit = 0; unit < RenderState::MAX_TEXTURES; unit++)
+		{
+			if (renderState.textures[unit])
+				bindTextureUnit(unit, renderState.textures[unit]);
+		}
+	}
+
+	void RenderQueue::execute(int pass, const GeometryPool& pool, StreamBuffer& commands)
+	{
+		sort();
+		unsigned long long passKey = (unsigned long long)(pass & 0xF) << PASS_SHIFT;
+		auto keyLess = [](const Item& item, unsigned long long key) { return item.key < key; };
+		size_t first = std::lower_bound(m_items.begin(), m_items.end(), passKey, keyLess) - m_items.begin();
+		size_t end = first;
+		while (end < m_items.size() && (m_items[end].key >> PASS_SHIFT) == (unsigned long long)(pass & 0xF))
+			end++;
+
+		pool.bind();
+		while (first < end)
+		{
+			int state = (int)((m_items[first].key >> STATE_SHIFT) & STATE_MASK);
+			size_t runEnd = first + 1;
+			while (runEnd < end && (int)((m_items[runEnd].key >> STATE_SHIFT) & STATE_MASK) == state)
+				runEnd++;
+			if (state < (int)m_states.size())
+				applyState(state);
+			m_batchCount++;
+
+			int runCount = (int)(runEnd - first);
+			size_t offset = 0;
+			DrawElementsIndirectCommand* runCommands = commands.allocate<DrawElementsIndirectCommand>(runCount, &offset);
+			if (runCommands) {
+				long long indexCount = 0;
+				for (int i = 0; i < runCount; i++)
+				{
+					runCommands[i] = pool.getCommand(m_items[first + i].mesh, m_items[first + i].baseInstance);
+					indexCount += runCommands[i].count;
+				}
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.getBuffer());
+				renderStatsMultiDraw(GL_TRIANGLES, runCount, indexCount);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, runCount, 0);
+			}
+			else {
+				//Stream buffer is full, still draw everything
+				for (size_t i = first; i < runEnd; i++)
+				{
+					pool.draw(m_items[i].mesh, m_items[i].baseInstance);
+				}
+			}
+			first = runEnd;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "geometryPool.h"
+#include <vector>
+
+namespace ew {
+	class Shader;
+}
+
+namespace joey
+{
+	class StreamBuffer;
+
+	// What a run of queued draws needs bound. Textures by unit, 0 leaves the unit alone
+	struct RenderState {
+		static const int MAX_TEXTURES = 4;
+		const ew::Shader* shader = nullptr;
+		unsigned int textures[MAX_TEXTURES] = {};
+	};
+
+	// Draws submitted in any order with a 64 bit sort key, radix sorted once per frame and issued
+	// pass by pass. Consecutive draws with the same state become one multi draw, so state only
+	// changes where the key's state field does and the state cache drops whatever stays the same.
+	// Key, high to low bits: pass 4 | state 12 | material 8 | mesh 16 | depth 24
+	class RenderQueue {
+	public:
+		static const int MAX_PASSES = 16;
+		static const int MAX_STATES = 4096;
+
+		// Index for the key's state field, valid until clearStates()
+		int addState(const RenderState& state);
+		void clearStates();
+
+		// depth is normalized to [0, 1], nearer first among draws of the same mesh
+		static unsigned long long makeKey(int pass, int state, int material, int mesh, float depth);
+
+		void clear();
+		// baseInstance indexes the bound draw data, as in DrawList::add
+		void submit(unsigned long long key, int mesh, int baseInstance);
+		// Radix sort of everything submitted since clear()
+		void sort();
+		// Draws the pass's items from the pool. Indirect commands are written to the stream buffer,
+		// uniforms the state's shader needs must already be set
+		void execute(int pass, const GeometryPool& pool, StreamBuffer& commands);
+
+		inline int getItemCount()const { return (int)m_items.size(); }
+		// Multi draws and state runs issued since clear()
+		inline int getBatchCount()const { return m_batchCount; }
+	private:
+		struct Item {
+			unsigned long long key;
+			int mesh;
+			int baseInstance;
+		};
+		void applyState(int state);
+
+		std::vector<RenderState> m_states;
+		std::vector<Item> m_items;
+		std::vector<Item> m_scratch;
+		int m_batchCount = 0;
+		bool m_sorted = true;
+	};
+}
@@ -0,0 +1,163 @@
+#include "renderStats.h"
+#include <imgui.h>
+
+namespace joey
+{
+	void RenderCounters::add(const RenderCounters& other)
+	{
+		drawCalls += other.drawCalls;
+		indirectCommands += other.indirectCommands;
+		triangles += other.triangles;
+		programBinds += other.programBinds;
+		redundantProgramBinds += other.redundantProgramBinds;
+		textureBinds += other.textureBinds;
+		redundantTextureBinds += other.redundantTextureBinds;
+		vertexArrayBinds += other.vertexArrayBinds;
+		redundantVertexArrayBinds += other.redundantVertexArrayBinds;
+		framebufferBinds += other.framebufferBinds;
+		uniformUploads += other.uniformUploads;
+		redundantUniformUploads += other.redundantUniformUploads;
+		skippedStateChanges += other.skippedStateChanges;
+	}
+
+	static RenderCounters s_frame;
+	static RenderCounters s_lastFrame;
+	static std::vector<PassRenderCounters> s_passes;
+	static std::vector<PassRenderCounters> s_lastPasses;
+	static int s_currentPass = -1;
+
+	void renderStatsBeginFrame()
+	{
+		s_lastFrame = s_frame;
+		s_lastPasses.swap(s_passes);
+		s_frame = RenderCounters();
+		s_passes.clear();
+		s_currentPass = -1;
+		//Anything may have rebound state since, e.g. ImGui
+		stateCacheInvalidate();
+	}
+
+	void renderStatsBeginPass(const std::string& name)
+	{
+		PassRenderCounters pass;
+		pass.name = name;
+		s_passes.push_back(pass);
+		s_currentPass = (int)s_passes.size() - 1;
+	}
+
+	void renderStatsEndPass()
+	{
+		s_currentPass = -1;
+	}
+
+	const RenderCounters& getFrameRenderCounters()
+	{
+		return s_lastFrame;
+	}
+
+	const std::vector<PassRenderCounters>& getPassRenderCounters()
+	{
+		return s_lastPasses;
+	}
+
+#if JOEY_RENDER_STATS
+	//Applies a change to the frame and the current pass
+	template<typename Function>
+	static inline void count(Function function)
+	{
+		function(s_frame);
+		if (s_currentPass >= 0)
+			function(s_passes[s_currentPass].counters);
+	}
+
+	void renderStatsDraw(GLenum mode, int count)
+	{
+		long long triangles = 0;
+		if (mode == GL_TRIANGLES)
+			triangles = count / 3;
+		else if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN)
+			triangles = count > 2 ? count - 2 : 0;
+		joey::count([&](RenderCounters& c) { c.drawCalls++; c.triangles += triangles; });
+	}
+
+	void renderStatsMultiDraw(GLenum mode, int commandCount, long long indexCount)
+	{
+		long long triangles = mode == GL_TRIANGLES ? indexCount / 3 : 0;
+		joey::count([&](RenderCounters& c) { c.drawCalls++; c.indirectCommands += commandCount; c.triangles += triangles; });
+	}
+
+	//Redundant calls are skipped rather than issued while the state cache is enabled
+	static inline void countRedundant(RenderCounters& c, bool redundant)
+	{
+		if (redundant && isStateCacheEnabled())
+			c.skippedStateChanges++;
+	}
+
+	void renderStatsProgram(bool redundant)
+	{
+		count([&](RenderCounters& c) { c.programBinds++; c.redundantProgramBinds += redundant; countRedundant(c, redundant); });
+	}
+
+	void renderStatsTexture(bool redundant)
+	{
+		count([&](RenderCounters& c) { c.textureBinds++; c.redundantTextureBinds += redundant; countRedundant(c, redundant); });
+	}
+
+	void renderStatsVertexArray(bool redundant)
+	{
+		count([&](RenderCounters& c) { c.vertexArrayBinds++; c.redundantVertexArrayBinds += redundant; countRedundant(c, redundant); });
+	}
+
+	void renderStatsFramebuffer(unsigned int framebuffer)
+	{
+		count([&](RenderCounters& c) { c.framebufferBinds++; });
+	}
+
+	void renderStatsUniform(bool redundant)
+	{
+		count([&](RenderCounters& c) { c.uniformUploads++; c.redundantUniformUploads += redundant; countRedundant(c, redundant); });
+	}
+#endif
+
+	void drawRenderStatsUI(const char* title)
+	{
+		ImGui::Begin(title);
+#if !JOEY_RENDER_STATS
+		ImGui::Text("Counters compiled out, configure with JOEY_RENDER_STATS=ON");
+#endif
+		const RenderCounters& frame = s_lastFrame;
+		ImGui::Text("Draws: %d (%d indirect)  Triangles: %lld", frame.drawCalls, frame.indirectCommands, frame.triangles);
+		ImGui::Text("Programs: %d (%d redundant)", frame.programBinds, frame.redundantProgramBinds);
+		ImGui::Text("Textures: %d (%d redundant)", frame.textureBinds, frame.redundantTextureBinds);
+		ImGui::Text("VAOs: %d (%d redundant)", frame.vertexArrayBinds, frame.redundantVertexArrayBinds);
+		ImGui::Text("FBOs: %d", frame.framebufferBinds);
+		ImGui::Text("Uniforms: %d (%d redundant)", frame.uniformUploads, frame.redundantUniformUploads);
+		ImGui::Text("Skipped by state cache: %d%s", frame.skippedStateChanges, isStateCacheEnabled() ? "" : " (cache off)");
+
+		if (ImGui::BeginTable("Passes", 7)) {
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("Draws");
+			ImGui::TableSetupColumn("Tris");
+			ImGui::TableSetupColumn("Programs");
+			ImGui::TableSetupColumn("Textures");
+			ImGui::TableSetupColumn("VAOs");
+			ImGui::TableSetupColumn("Uniforms");
+			ImGui::TableHeadersRow();
+			for (const PassRenderCounters& pass : s_lastPasses)
+			{
+				const RenderCounters& c = pass.counters;
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%s", pass.name.c_str());
+				ImGui::TableNextColumn(); ImGui::Text("%d", c.drawCalls);
+				ImGui::TableNextColumn(); ImGui::Text("%lld", c.triangles);
+				ImGui::TableNextColumn(); ImGui::Text("%d/%d", c.redundantProgramBinds, c.programBinds);
+				ImGui::TableNextColumn(); ImGui::Text("%d/%d", c.redundantTextureBinds, c.textureBinds);
+				ImGui::TableNextColumn(); ImGui::Text("%d/%d", c.redundantVertexArrayBinds, c.vertexArrayBinds);
+				ImGui::TableNextColumn(); ImGui::Text("%d/%d", c.redundantUniformUploads, c.uniformUploads);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::TextDisabled("Pass columns are redundant/total");
+		ImGui::End();
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../ew/external/glad.h"
+#include "stateCache.h"
+#include <string>
+#include <vector>
+
+// Compiled in by the JOEY_RENDER_STATS CMake option. When off, the record functions are empty
+// and the bind/draw wrappers below are plain GL calls
+#ifndef JOEY_RENDER_STATS
+#define JOEY_RENDER_STATS 0
+#endif
+
+namespace joey
+{
+	struct RenderCounters {
+		int drawCalls = 0;
+		int indirectCommands = 0; //Draws issued through multi draw indirect, each multi draw is one drawCall
+		long long triangles = 0;
+		int programBinds = 0;
+		int redundantProgramBinds = 0; //Program was already bound
+		int textureBinds = 0;
+		int redundantTextureBinds = 0; //Unit already had that texture
+		int vertexArrayBinds = 0;
+		int redundantVertexArrayBinds = 0;
+		int framebufferBinds = 0;
+		int uniformUploads = 0;
+		int redundantUniformUploads = 0; //Same value as the last upload to that location
+		int skippedStateChanges = 0; //Redundant binds and uploads the state cache did not issue
+
+		void add(const RenderCounters& other);
+	};
+
+	struct PassRenderCounters {
+		std::string name;
+		RenderCounters counters;
+	};
+
+	// Counts what a frame issues. Hooked into ew::Mesh::draw, ew::Shader::use/set* and the
+	// wrappers below. Redundancy is judged by the state cache (stateCache.h), which is invalidated here
+	void renderStatsBeginFrame();
+	// Attributes everything until renderStatsEndPass to this pass as well as the frame
+	void renderStatsBeginPass(const std::string& name);
+	void renderStatsEndPass();
+
+	// Last complete frame
+	const RenderCounters& getFrameRenderCounters();
+	const std::vector<PassRenderCounters>& getPassRenderCounters();
+	// Window with the last frame's totals and a row per pass
+	void drawRenderStatsUI(const char* title = "Render Stats");
+
+#if JOEY_RENDER_STATS
+	void renderStatsDraw(GLenum mode, int count);
+	// One glMultiDraw*Indirect of commandCount draws, indexCount summed over them
+	void renderStatsMultiDraw(GLenum mode, int commandCount, long long indexCount);
+	void renderStatsProgram(bool redundant);
+	void renderStatsTexture(bool redundant);
+	void renderStatsVertexArray(bool redundant);
+	void renderStatsFramebuffer(unsigned int framebuffer);
+	void renderStatsUniform(bool redundant);
+#else
+	inline void renderStatsDraw(GLenum mode, int count) {}
+	inline void renderStatsMultiDraw(GLenum mode, int commandCount, long long indexCount) {}
+	inline void renderStatsProgram(bool redundant) {}
+	inline void renderStatsTexture(bool redundant) {}
+	inline void renderStatsVertexArray(bool redundant) {}
+	inline void renderStatsFramebuffer(unsigned int framebuffer) {}
+	inline void renderStatsUniform(bool redundant) {}
+#endif
+
+	// Counted versions of the GL calls, redundant ones are skipped while the state cache is enabled
+	inline void useProgram(unsigned int program)
+	{
+		bool redundant = stateCacheProgram(program);
+		renderStatsProgram(redundant);
+		if (!redundant || !isStateCacheEnabled())
+			glUseProgram(program);
+	}
+	inline void bindTextureUnit(int unit, unsigned int texture)
+	{
+		bool redundant = stateCacheTexture(unit, texture);
+		renderStatsTexture(redundant);
+		if (!redundant || !isStateCacheEnabled())
+			glBindTextureUnit(unit, texture);
+	}
+	inline void bindVertexArray(unsigned int vertexArray)
+	{
+		bool redundant = stateCacheVertexArray(vertexArray);
+		renderStatsVertexArray(redundant);
+		if (!redundant || !isStateCacheEnabled())
+			glBindVertexArray(vertexArray);
+	}
+	// For ew::Shader::set*, false when the upload can be skipped
+	inline bool uniformNeeded(unsigned int program, int location, const void* value, int size)
+	{
+		bool redundant = stateCacheUniform(program, location, value, size);
+		renderStatsUniform(redundant);
+		return !redundant || !isStateCacheEnabled();
+	}
+	inline void bindFramebuffer(unsigned int framebuffer)
+	{
+		renderStatsFramebuffer(framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	inline void drawArrays(GLenum mode, int first, int count)
+	{
+		renderStatsDraw(mode, count);
+		glDrawArrays(mode, first, count);
+	}
+	// baseInstance reaches the shader as gl_BaseInstanceARB, instances add gl_InstanceID to it
+	inline void drawArraysInstanced(GLenum mode, int first, int count, int instanceCount, int baseInstance = 0)
+	{
+		renderStatsDraw(mode, count * instanceCount);
+		glDrawArraysInstancedBaseInstance(mode, first, count, instanceCount, baseInstance);
+	}
+}
@@ -0,0 +1,159 @@
+#include "renderTargetPool.h"
+#include <stdio.h>
+
+namespace joey
+{
+	RenderTargetPool::~RenderTargetPool()
+	{
+		for (const Entry& entry : m_entries)
+		{
+			glDeleteTextures(1, &entry.texture);
+		}
+	}
+
+	unsigned int RenderTargetPool::acquireTexture(unsigned int width, unsigned int height, int format, int filter)
+	{
+		for (Entry& entry : m_entries)
+		{
+			if (entry.inUse || entry.width != width || entry.height != height || entry.format != format)
+				continue;
+			entry.inUse = true;
+			entry.lastUsedFrame = m_frame;
+			//Previous owner may have changed sampling state, e.g. border color on a shadow map
+			glTextureParameteri(entry.texture, GL_TEXTURE_MIN_FILTER, filter);
+			glTextureParameteri(entry.texture, GL_TEXTURE_MAG_FILTER, filter);
+			glTextureParameteri(entry.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(entry.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(entry.texture, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+			return entry.texture;
+		}
+
+		Entry entry;
+		entry.texture = createRenderTexture(width, height, format, filter);
+		entry.width = width;
+		entry.height = height;
+		entry.format = format;
+		entry.inUse = true;
+		entry.lastUsedFrame = m_frame;
+		m_entries.push_back(entry);
+		return entry.texture;
+	}
+
+	void RenderTargetPool::releaseTexture(unsigned int texture)
+	{
+		Entry* entry = findEntry(texture);
+		if (entry == nullptr) {
+			printf("RenderTargetPool: texture %u was not acquired from this pool\n", texture);
+			return;
+		}
+		entry->inUse = false;
+		entry->lastUsedFrame = m_frame;
+	}
+
+	Framebuffer RenderTargetPool::acquireFramebuffer(unsigned int width, unsigned int height, const int* colorFormats, int numColors, int depthFormat, int filter)
+	{
+		unsigned int colorTextures[MAX_COLOR_ATTACHMENTS];
+		for (int i = 0; i < numColors && i < MAX_COLOR_ATTACHMENTS; i++)
+		{
+			colorTextures[i] = acquireTexture(width, height, colorFormats[i], filter);
+		}
+		unsigned int depthTexture = depthFormat ? acquireTexture(width, height, depthFormat, GL_NEAREST) : 0;
+		return createFramebufferFromTextures(width, height, colorTextures, numColors, depthTexture);
+	}
+
+	void RenderTargetPool::releaseFramebuffer(Framebuffer* framebuffer)
+	{
+		for (unsigned int i = 0; i < framebuffer->numColorBuffers; i++)
+		{
+			releaseTexture(framebuffer->colorBuffer[i]);
+		}
+		if (framebuffer->depthBuffer) {
+			releaseTexture(framebuffer->depthBuffer);
+		}
+		glDeleteFramebuffers(1, &framebuffer->fbo);
+		*framebuffer = Framebuffer();
+	}
+
+	void RenderTargetPool::resizeFramebuffer(Framebuffer* framebuffer, unsigned int width, unsigned int height)
+	{
+		if (framebuffer->width == width && framebuffer->height == height)
+			return;
+
+		int colorFormats[MAX_COLOR_ATTACHMENTS];
+		int numColors = framebuffer->numColorBuffers;
+		int filter = GL_LINEAR;
+		for (int i = 0; i < numColors; i++)
+		{
+			colorFormats[i] = findEntry(framebuffer->colorBuffer[i])->format;
+		}
+		if (numColors > 0) {
+			glGetTextureParameteriv(framebuffer->colorBuffer[0], GL_TEXTURE_MAG_FILTER, &filter);
+		}
+		int depthFormat = framebuffer->depthBuffer ? findEntry(framebuffer->depthBuffer)->format : 0;
+
+		releaseFramebuffer(framebuffer);
+		*framebuffer = acquireFramebuffer(width, height, colorFormats, numColors, depthFormat, filter);
+	}
+
+	void RenderTargetPool::freeWhere(bool (*shouldFree)(const Entry& entry, int frame, int framesToKeep), int framesToKeep)
+	{
+		for (size_t i = 0; i < m_entries.size();)
+		{
+			if (!m_entries[i].inUse && shouldFree(m_entries[i], m_frame, framesToKeep)) {
+				glDeleteTextures(1, &m_entries[i].texture);
+				m_generation++;
+				m_entries[i] = m_entries.back();
+				m_entries.pop_back();
+			}
+			else {
+				i++;
+			}
+		}
+	}
+
+	void RenderTargetPool::endFrame(int framesToKeep)
+	{
+		freeWhere([](const Entry& entry, int frame, int framesToKeep) {
+			return frame - entry.lastUsedFrame >= framesToKeep;
+		}, framesToKeep);
+		m_frame++;
+	}
+
+	void RenderTargetPool::trim()
+	{
+		freeWhere([](const Entry& entry, int frame, int framesToKeep) {
+			return true;
+		}, 0);
+	}
+
+	size_t RenderTargetPool::getAllocatedBytes()const
+	{
+		size_t bytes = 0;
+		for (const Entry& entry : m_entries)
+		{
+			bytes += (size_t)entry.width * entry.height * getFormatBytesPerPixel(entry.format);
+		}
+		return bytes;
+	}
+
+	size_t RenderTargetPool::getInUseBytes()const
+	{
+		size_t bytes = 0;
+		for (const Entry& entry : m_entries)
+		{
+			if (entry.inUse)
+				bytes += (size_t)entry.width * entry.height * getFormatBytesPerPixel(entry.format);
+		}
+		return bytes;
+	}
+
+	RenderTargetPool::Entry* RenderTargetPool::findEntry(unsigned int texture)
+	{
+		for (Entry& entry : m_entries)
+		{
+			if (entry.texture == texture)
+				return &entry;
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "framebuffer.h"
+#include <vector>
+
+namespace joey
+{
+	// Recycles render target textures by (width, height, format).
+	// Released textures stay pooled for a few frames so per-frame transient targets
+	// and resize reallocation reuse storage instead of creating new textures every time.
+	class RenderTargetPool {
+	public:
+		RenderTargetPool() {};
+		~RenderTargetPool();
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+		// Returns an unused pooled texture matching the request, or allocates one
+		unsigned int acquireTexture(unsigned int width, unsigned int height, int format, int filter = GL_LINEAR);
+		void releaseTexture(unsigned int texture);
+
+		// Framebuffer with pooled attachments. depthFormat 0 for no depth attachment
+		Framebuffer acquireFramebuffer(unsigned int width, unsigned int height, const int* colorFormats, int numColors, int depthFormat, int filter = GL_LINEAR);
+		// Returns the attachments to the pool and deletes the fbo
+		void releaseFramebuffer(Framebuffer* framebuffer);
+		// Reacquires every attachment at the new size with the same formats and filtering
+		void resizeFramebuffer(Framebuffer* framebuffer, unsigned int width, unsigned int height);
+
+		// Call once per frame. Frees pooled textures that went unused for framesToKeep frames
+		void endFrame(int framesToKeep = 3);
+		// Frees every texture not currently acquired
+		void trim();
+
+		size_t getAllocatedBytes()const;
+		size_t getInUseBytes()const;
+		inline int getTextureCount()const { return (int)m_entries.size(); }
+		// Bumped whenever a texture is deleted, so cached framebuffers know to rebuild
+		inline int getGeneration()const { return m_generation; }
+	private:
+		struct Entry {
+			unsigned int texture;
+			unsigned int width;
+			unsigned int height;
+			int format;
+			bool inUse;
+			int lastUsedFrame;
+		};
+		std::vector<Entry> m_entries;
+		int m_frame = 0;
+		int m_generation = 0;
+
+		Entry* findEntry(unsigned int texture);
+		void freeWhere(bool (*shouldFree)(const Entry& entry, int frame, int framesToKeep), int framesToKeep);
+	};
+}
@@ -0,0 +1,129 @@
+#include "renderThread.h"
+#include "cpuProfiler.h"
+#include <chrono>
+
+namespace joey
+{
+	static long long nowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//Spin briefly, then back off so an idle thread doesn't hold a core
+	static void backoff(int& spins)
+	{
+		if (++spins < 64)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	RenderThread::RenderThread(std::function<void()> start, std::function<void()> stop, int framesAhead)
+		: m_framesAhead(framesAhead < 0 ? 0 : framesAhead)
+	{
+		m_ring = new unsigned char[RING_BYTES];
+		m_thread = std::thread(&RenderThread::threadLoop, this, std::move(start), std::move(stop));
+	}
+
+	RenderThread::~RenderThread()
+	{
+		submit([this]() { m_running = false; });
+		m_thread.join();
+		delete[] m_ring;
+	}
+
+	void RenderThread::waitForSpace(size_t bytes)
+	{
+		size_t write = m_writePos.load(std::memory_order_relaxed);
+		if (write + bytes - m_readPos.load(std::memory_order_acquire) <= RING_BYTES)
+			return;
+		JOEY_CPU_ZONE("RenderThread ring full");
+		long long start = nowNs();
+		int spins = 0;
+		while (write + bytes - m_readPos.load(std::memory_order_acquire) > RING_BYTES)
+		{
+			backoff(spins);
+		}
+		m_stallMs += (nowNs() - start) / 1000000.0;
+	}
+
+	unsigned char* RenderThread::reserve(size_t bytes)
+	{
+		size_t write = m_writePos.load(std::memory_order_relaxed);
+		size_t offset = write % RING_BYTES;
+		//Commands never wrap, pad out the end of the ring instead
+		if (offset + bytes > RING_BYTES) {
+			size_t padding = RING_BYTES - offset;
+			waitForSpace(padding);
+			CommandHeader* header = (CommandHeader*)(m_ring + offset);
+			header->size = padding;
+			header->execute = nullptr;
+			m_writePos.store(write + padding, std::memory_order_release);
+			offset = 0;
+		}
+		waitForSpace(bytes);
+		return m_ring + offset;
+	}
+
+	void RenderThread::endFrame()
+	{
+		submit([this]() {
+			long long end = nowNs();
+			if (m_frameStartNs >= 0)
+				m_lastRenderMs.store((float)((end - m_frameStartNs) / 1000000.0), std::memory_order_relaxed);
+			m_frameStartNs = -1;
+			m_framesCompleted.fetch_add(1, std::memory_order_release);
+		});
+		m_framesSubmitted++;
+
+		long long allowedBehind = m_synchronous ? 0 : m_framesAhead;
+		if (m_framesSubmitted - m_framesCompleted.load(std::memory_order_acquire) > allowedBehind) {
+			JOEY_CPU_ZONE("RenderThread wait");
+			long long start = nowNs();
+			int spins = 0;
+			while (m_framesSubmitted - m_framesCompleted.load(std::memory_order_acquire) > allowedBehind)
+			{
+				backoff(spins);
+			}
+			m_stallMs += (nowNs() - start) / 1000000.0;
+		}
+		m_lastStallMs = (float)m_stallMs;
+		m_stallMs = 0.0;
+	}
+
+	void RenderThread::flush()
+	{
+		int spins = 0;
+		while (m_readPos.load(std::memory_order_acquire) != m_writePos.load(std::memory_order_relaxed))
+		{
+			backoff(spins);
+		}
+	}
+
+	void RenderThread::threadLoop(std::function<void()> start, std::function<void()> stop)
+	{
+		cpuProfilerSetThreadName("Render");
+		if (start)
+			start();
+		int spins = 0;
+		while (m_running)
+		{
+			size_t read = m_readPos.load(std::memory_order_relaxed);
+			if (read == m_writePos.load(std::memory_order_acquire)) {
+				backoff(spins);
+				continue;
+			}
+			spins = 0;
+			CommandHeader* header = (CommandHeader*)(m_ring + read % RING_BYTES);
+			if (header->execute) {
+				if (m_frameStartNs < 0)
+					m_frameStartNs = nowNs();
+				header->execute(header + 1);
+			}
+			//Hands the bytes back to the submitter
+			m_readPos.store(read + header->size, std::memory_order_release);
+		}
+		if (stop)
+			stop();
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace joey
+{
+	// Owns a thread that replays commands recorded by one other thread, e.g. to keep the GL
+	// context off the simulation thread. Commands are copied into a single producer /
+	// single consumer byte ring, so submitting never locks. Any callable works as a command,
+	// capture what the frame needs by value since the submitter has moved on when it runs
+	class RenderThread {
+	public:
+		static const size_t RING_BYTES = 1 << 20;
+
+		// start runs first on the new thread, e.g. to make a context current, stop runs last.
+		// framesAhead bounds how many frames endFrame() lets the submitter get in front
+		RenderThread(std::function<void()> start, std::function<void()> stop, int framesAhead = 1);
+		// Runs everything already submitted, then stop
+		~RenderThread();
+		RenderThread(const RenderThread&) = delete;
+		RenderThread& operator=(const RenderThread&) = delete;
+
+		template<typename Command>
+		void submit(Command&& command);
+		// Ends the submitted frame. Blocks while the render thread is more than framesAhead frames
+		// behind, or until it finishes this one in synchronous mode
+		void endFrame();
+		// Blocks until every submitted command has run
+		void flush();
+
+		// Render each frame before returning from endFrame, for debugging ordering problems
+		inline void setSynchronous(bool synchronous) { m_synchronous = synchronous; }
+		inline bool isSynchronous()const { return m_synchronous; }
+
+		// Time the submitter spent blocked in the last frame, on a full ring or too many frames ahead
+		inline float getLastStallMs()const { return m_lastStallMs; }
+		// Render thread time from the first command of the last finished frame to its end
+		inline float getLastRenderMs()const { return m_lastRenderMs.load(std::memory_order_relaxed); }
+		inline long long getFramesCompleted()const { return m_framesCompleted.load(std::memory_order_acquire); }
+	private:
+		//Precedes every command in the ring. execute == nullptr pads to the end of the ring
+		struct alignas(16) CommandHeader {
+			size_t size;
+			void (*execute)(void* command);
+		};
+
+		template<typename Command>
+		static void execute(void* command)
+		{
+			Command* typed = (Command*)command;
+			(*typed)();
+			typed->~Command();
+		}
+
+		unsigned char* reserve(size_t bytes);
+		void waitForSpace(size_t bytes);
+		void threadLoop(std::function<void()> start, std::function<void()> stop);
+
+		unsigned char* m_ring;
+		//Total bytes ever written / consumed, the ring offset is these modulo RING_BYTES
+		std::atomic<size_t> m_writePos{ 0 };
+		std::atomic<size_t> m_readPos{ 0 };
+		std::atomic<long long> m_framesCompleted{ 0 };
+		long long m_framesSubmitted = 0;
+		int m_framesAhead;
+		bool m_synchronous = false;
+		bool m_running = true; //Render thread only
+		double m_stallMs = 0.0;
+		float m_lastStallMs = 0.0f;
+		std::atomic<float> m_lastRenderMs{ 0.0f };
+		long long m_frameStartNs = -1; //Render thread only
+		std::thread m_thread;
+	};
+
+	template<typename Command>
+	void RenderThread::submit(Command&& command)
+	{
+		typedef typename std::decay<Command>::type Stored;
+		static_assert(alignof(Stored) <= alignof(CommandHeader), "Over-aligned render command");
+		static_assert(sizeof(Stored) + sizeof(CommandHeader) <= RING_BYTES / 4, "Render command too large for the ring");
+		size_t bytes = (sizeof(CommandHeader) + sizeof(Stored) + alignof(CommandHeader) - 1) & ~(alignof(CommandHeader) - 1);
+		unsigned char* memory = reserve(bytes);
+		CommandHeader* header = (CommandHeader*)memory;
+		header->size = bytes;
+		header->execute = &RenderThread::execute<Stored>;
+		new (memory + sizeof(CommandHeader)) Stored(std::forward<Command>(command));
+		//Publishes the command, pairs with the acquire in threadLoop
+		m_writePos.store(m_writePos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+}
@@ -0,0 +1,223 @@
+#include "shaderCache.h"
+#include "stateCache.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//GL_KHR_parallel_shader_compile, not in the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace joey
+{
+	typedef std::chrono::steady_clock Clock;
+
+	static float millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	//FNV-1a, with a separator so ("ab", "c") and ("a", "bc") differ
+	static unsigned long long hashString(unsigned long long hash, const char* text)
+	{
+		for (const char* c = text; c && *c; c++)
+		{
+			hash ^= (unsigned char)*c;
+			hash *= 1099511628211ull;
+		}
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+		return hash;
+	}
+
+	static bool hasExtension(const char* name)
+	{
+		int count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (int i = 0; i < count; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension && strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	ShaderCache::ShaderCache(const std::string& directory)
+		: m_directory(directory)
+	{
+		m_parallelCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+		int binaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+		m_binaries = !m_directory.empty() && binaryFormats > 0;
+		//Binaries are only valid for the driver that made them
+		m_driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+		if (m_binaries) {
+#ifdef _WIN32
+			_mkdir(m_directory.c_str());
+#else
+			mkdir(m_directory.c_str(), 0755);
+#endif
+		}
+	}
+
+	ShaderCache::~ShaderCache()
+	{
+		finish();
+	}
+
+	unsigned int ShaderCache::request(const std::string& name, const char* vertexSource, const char* geometrySource, const char* fragmentSource)
+	{
+		Clock::time_point start = Clock::now();
+		unsigned long long key = 14695981039346656037ull;
+		key = hashString(key, m_driver.c_str());
+		key = hashString(key, vertexSource);
+		key = hashString(key, geometrySource);
+		key = hashString(key, fragmentSource);
+
+		unsigned int program = glCreateProgram();
+		//May reuse a deleted program's id
+		stateCacheForgetProgram(program);
+		if (m_binaries && loadBinary(program, key)) {
+			m_hits++;
+			m_buildMs += millisecondsSince(start);
+			return program;
+		}
+		m_misses++;
+
+		//No status queries here, the first one would wait for the compile to finish
+		Pending pending;
+		pending.name = name;
+		pending.program = program;
+		pending.key = key;
+		pending.shaderCount = 0;
+		const char* sources[3] = { vertexSource, geometrySource, fragmentSource };
+		const GLenum types[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+		for (int i = 0; i < 3; i++)
+		{
+			if (!sources[i])
+				continue;
+			unsigned int shader = glCreateShader(types[i]);
+			glShaderSource(shader, 1, &sources[i], NULL);
+			glCompileShader(shader);
+			glAttachShader(program, shader);
+			pending.shaders[pending.shaderCount++] = shader;
+		}
+		if (m_binaries)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program);
+		m_pending.push_back(pending);
+		m_buildMs += millisecondsSince(start);
+		return program;
+	}
+
+	bool ShaderCache::poll()
+	{
+		if (!m_parallelCompile) {
+			finish();
+			return true;
+		}
+		for (const Pending& pending : m_pending)
+		{
+			int done = 0;
+			glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				return false;
+		}
+		return true;
+	}
+
+	void ShaderCache::finish()
+	{
+		if (m_pending.empty())
+			return;
+		Clock::time_point start = Clock::now();
+		for (const Pending& pending : m_pending)
+		{
+			for (int i = 0; i < pending.shaderCount; i++)
+			{
+				int success;
+				glGetShaderiv(pending.shaders[i], GL_COMPILE_STATUS, &success);
+				if (!success) {
+					char infoLog[512];
+					glGetShaderInfoLog(pending.shaders[i], 512, NULL, infoLog);
+					printf("Failed to compile shader (%s): %s", pending.name.c_str(), infoLog);
+				}
+			}
+			int success;
+			glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+			if (!success) {
+				char infoLog[512];
+				glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
+				printf("Failed to link shader program (%s): %s", pending.name.c_str(), infoLog);
+			}
+			else if (m_binaries) {
+				saveBinary(pending.program, pending.key);
+			}
+			for (int i = 0; i < pending.shaderCount; i++)
+			{
+				glDetachShader(pending.program, pending.shaders[i]);
+				glDeleteShader(pending.shaders[i]);
+			}
+		}
+		m_pending.clear();
+		m_buildMs += millisecondsSince(start);
+	}
+
+	std::string ShaderCache::getPath(unsigned long long key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.bin", key);
+		return m_directory + name;
+	}
+
+	//File layout: GLenum binary format, then the binary
+	bool ShaderCache::loadBinary(unsigned int program, unsigned long long key)
+	{
+		FILE* file = fopen(getPath(key).c_str(), "rb");
+		if (!file)
+			return false;
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		unsigned int format = 0;
+		std::vector<char> binary(size > (long)sizeof(format) ? size - sizeof(format) : 0);
+		bool read = !binary.empty() && fread(&format, sizeof(format), 1, file) == 1 && fread(binary.data(), 1, binary.size(), file) == binary.size();
+		fclose(file);
+		if (!read)
+			return false;
+		glProgramBinary(program, format, binary.data(), (int)binary.size());
+		//Drivers reject binaries from other versions, the program is then linked from source
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		return success != 0;
+	}
+
+	void ShaderCache::saveBinary(unsigned int program, unsigned long long key)
+	{
+		int length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, NULL, &format, binary.data());
+		FILE* file = fopen(getPath(key).c_str(), "wb");
+		if (!file) {
+			printf("Failed to write shader cache %s\n", getPath(key).c_str());
+			return;
+		}
+		unsigned int format32 = format;
+		fwrite(&format32, sizeof(format32), 1, file);
+		fwrite(binary.data(), 1, binary.size(), file);
+		fclose(file);
+	}
+}
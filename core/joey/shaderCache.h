@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace joey
+{
+	// Builds programs without waiting on each one and keeps their linked binaries on disk.
+	// request() hands back the program right away: either loaded from a cached binary, or with its
+	// stages compiled and linked but not yet checked, so the driver can work on all of them at once
+	// (on its own threads with GL_KHR_parallel_shader_compile) while the caller loads other assets.
+	// Binaries are keyed by a hash of the sources and the driver's vendor, renderer and version
+	class ShaderCache {
+	public:
+		// An empty directory disables the on-disk cache
+		ShaderCache(const std::string& directory = "shaderCache");
+		~ShaderCache();
+		ShaderCache(const ShaderCache&) = delete;
+		ShaderCache& operator=(const ShaderCache&) = delete;
+
+		// geometrySource may be nullptr. name is only used in error messages
+		unsigned int request(const std::string& name, const char* vertexSource, const char* geometrySource, const char* fragmentSource);
+		// True once every requested program has finished linking. Never blocks with
+		// GL_KHR_parallel_shader_compile, without it this is finish()
+		bool poll();
+		// Waits for every requested program, reports errors and writes new binaries
+		void finish();
+
+		inline bool hasParallelCompile()const { return m_parallelCompile; }
+		inline int getHitCount()const { return m_hits; }
+		inline int getMissCount()const { return m_misses; }
+		// Milliseconds spent in request() and finish() together
+		inline float getBuildMs()const { return m_buildMs; }
+	private:
+		struct Pending {
+			std::string name;
+			unsigned int program;
+			unsigned int shaders[3];
+			int shaderCount;
+			unsigned long long key;
+		};
+		bool loadBinary(unsigned int program, unsigned long long key);
+		void saveBinary(unsigned int program, unsigned long long key);
+		std::string getPath(unsigned long long key)const;
+
+		std::string m_directory;
+		std::string m_driver;
+		bool m_binaries = false;
+		bool m_parallelCompile = false;
+		std::vector<Pending> m_pending;
+		int m_hits = 0;
+		int m_misses = 0;
+		float m_buildMs = 0.0f;
+	};
+}
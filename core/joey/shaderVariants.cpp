@@ -0,0 +1,71 @@
+#include "shaderVariants.h"
+#include "shaderCache.h"
+
+namespace joey
+{
+	//FNV-1a over names and values, so picking a variant doesn't build a string every frame
+	static unsigned long long hashPermutation(std::initializer_list<ShaderDefine> permutation)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (const ShaderDefine& define : permutation)
+		{
+			for (const char* c = define.name; *c; c++)
+			{
+				hash ^= (unsigned char)*c;
+				hash *= 1099511628211ull;
+			}
+			hash ^= (unsigned int)define.value;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	ShaderVariants::ShaderVariants(const std::string& vertexShader, const std::string& fragmentShader, ShaderCache* cache)
+		: m_vertexShader(vertexShader), m_fragmentShader(fragmentShader), m_cache(cache)
+	{
+	}
+
+	void ShaderVariants::destroy()
+	{
+		for (auto& variant : m_variants)
+		{
+			variant.second.destroy();
+		}
+		m_variants.clear();
+	}
+
+	void ShaderVariants::setDefine(const char* name, int value)
+	{
+		m_defines += "#define " + std::string(name) + " " + std::to_string(value) + "\n";
+	}
+
+	const ew::Shader& ShaderVariants::get(std::initializer_list<ShaderDefine> permutation)
+	{
+		unsigned long long key = hashPermutation(permutation);
+		auto variant = m_variants.find(key);
+		if (variant != m_variants.end())
+			return variant->second;
+		const ew::Shader& shader = build(key, permutation);
+		//Needed right now anyway, this reports its errors
+		if (m_cache)
+			m_cache->finish();
+		return shader;
+	}
+
+	void ShaderVariants::prepare(std::initializer_list<ShaderDefine> permutation)
+	{
+		unsigned long long key = hashPermutation(permutation);
+		if (m_variants.find(key) == m_variants.end())
+			build(key, permutation);
+	}
+
+	const ew::Shader& ShaderVariants::build(unsigned long long key, std::initializer_list<ShaderDefine> permutation)
+	{
+		std::string defines = m_defines;
+		for (const ShaderDefine& define : permutation)
+		{
+			defines += "#define " + std::string(define.name) + " " + std::to_string(define.value) + "\n";
+		}
+		return m_variants.emplace(key, ew::Shader(m_vertexShader, m_fragmentShader, m_cache, defines)).first->second;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+
+namespace joey
+{
+	class ShaderCache;
+
+	struct ShaderDefine {
+		const char* name;
+		int value;
+	};
+
+	// Specialized builds of one vertex + fragment pair, picked by #defines instead of uniforms, so
+	// each variant only contains the code paths it uses. A variant is built the first time its
+	// permutation is asked for and kept. Defines go in after #version (ew::loadShaderSourceFromFile)
+	class ShaderVariants {
+	public:
+		// Variants build through cache when given, so they get its binaries
+		ShaderVariants(const std::string& vertexShader, const std::string& fragmentShader, ShaderCache* cache = nullptr);
+		ShaderVariants(const ShaderVariants&) = delete;
+		ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+		// Defined in every variant, for constants shared with C++. Set before the first get()
+		void setDefine(const char* name, int value);
+
+		// The variant for these permutation defines, built on first use. Same names in the same order
+		// on every call, the key doesn't sort them
+		const ew::Shader& get(std::initializer_list<ShaderDefine> permutation);
+		// Starts building a variant without waiting for it, so a later get() doesn't stall
+		void prepare(std::initializer_list<ShaderDefine> permutation);
+
+		// Deletes every variant built so far
+		void destroy();
+
+		inline int getVariantCount()const { return (int)m_variants.size(); }
+	private:
+		const ew::Shader& build(unsigned long long key, std::initializer_list<ShaderDefine> permutation);
+
+		std::string m_vertexShader;
+		std::string m_fragmentShader;
+		ShaderCache* m_cache;
+		std::string m_defines;
+		std::unordered_map<unsigned long long, ew::Shader> m_variants;
+	};
+}
@@ -0,0 +1,120 @@
+#include "shadow.h"
+#include "renderStats.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+
+namespace joey
+{
+	const char* shadowFilterName(ShadowFilter filter)
+	{
+		switch (filter) {
+		case ShadowFilter::MANUAL_3X3:
+			return "Manual 3x3";
+		case ShadowFilter::HARDWARE_PCF:
+			return "Hardware PCF";
+		case ShadowFilter::GATHER_4:
+			return "Gather 4-tap";
+		case ShadowFilter::GATHER_16:
+			return "Gather 16-tap";
+		case ShadowFilter::POISSON:
+			return "Poisson disk";
+		default:
+			return "Unknown";
+		}
+	}
+
+	unsigned int createShadowCompareSampler()
+	{
+		unsigned int sampler;
+		glCreateSamplers(1, &sampler);
+		//Linear + compare mode makes one texture() call a bilinear 2x2 PCF
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glSamplerParameteri(sampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		//Outside of the light frustum counts as lit
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+		return sampler;
+	}
+
+	void bindShadowMap(unsigned int shadowMap, unsigned int compareSampler, int rawUnit, int compareUnit)
+	{
+		bindTextureUnit(rawUnit, shadowMap);
+		glBindSampler(rawUnit, 0);
+		bindTextureUnit(compareUnit, shadowMap);
+		glBindSampler(compareUnit, compareSampler);
+	}
+
+	void setShadowUniforms(const ew::Shader& shader, int rawUnit, int compareUnit, float filterRadius)
+	{
+		shader.setInt("_ShadowMap", rawUnit);
+		shader.setInt("_ShadowMapCmp", compareUnit);
+		shader.setFloat("_ShadowFilterRadius", filterRadius);
+	}
+
+	/// <summary>
+	/// Times drawPass with every shadow filter at a fixed resolution.
+	/// Each frame waits on its query, this is meant to be run on demand and not every frame.
+	/// </summary>
+	std::vector<ShadowFilterTiming> benchmarkShadowFilters(const std::function<void(ShadowFilter)>& drawPass,
+		unsigned int width, unsigned int height, int frames)
+	{
+		const int WARMUP_FRAMES = 5;
+
+		int prevFbo, prevViewport[4];
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+		glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+		//Same format as the HDR targets the lighting pass normally writes to
+		unsigned int fbo, colorTexture, query;
+		glCreateFramebuffers(1, &fbo);
+		glCreateTextures(GL_TEXTURE_2D, 1, &colorTexture);
+		glTextureStorage2D(colorTexture, 1, GL_RGBA16F, width, height);
+		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+		glGenQueries(1, &query);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+
+		std::vector<ShadowFilterTiming> results;
+		printf("Shadow filter benchmark (%ux%u, %d frames)\n", width, height, frames);
+		for (int i = 0; i < (int)ShadowFilter::COUNT; i++)
+		{
+			ShadowFilter filter = (ShadowFilter)i;
+			for (int f = 0; f < WARMUP_FRAMES; f++)
+			{
+				drawPass(filter);
+			}
+			glFinish();
+
+			GLuint64 totalNs = 0;
+			for (int f = 0; f < frames; f++)
+			{
+				glBeginQuery(GL_TIME_ELAPSED, query);
+				drawPass(filter);
+				glEndQuery(GL_TIME_ELAPSED);
+
+				GLuint64 elapsedNs = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+				totalNs += elapsedNs;
+			}
+
+			ShadowFilterTiming timing;
+			timing.filter = filter;
+			timing.gpuMs = (float)((double)totalNs / frames / 1000000.0);
+			results.push_back(timing);
+			printf("  %-14s %8.3f ms\n", shadowFilterName(filter), timing.gpuMs);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+		glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+		glDeleteQueries(1, &query);
+		glDeleteTextures(1, &colorTexture);
+		glDeleteFramebuffers(1, &fbo);
+		return results;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include "shaderVariants.h"
+#include <functional>
+#include <vector>
+
+namespace joey
+{
+	// Values match the SHADOW_FILTER_* defines in assets/core/shadow.glsl
+	enum class ShadowFilter {
+		MANUAL_3X3 = 0, //9 texture() + step() taps on the raw depth (original)
+		HARDWARE_PCF = 1, //1 sampler2DShadow tap, bilinear comparison
+		GATHER_4 = 2, //1 textureGather, 2x2 texels
+		GATHER_16 = 3, //4 textureGathers, 4x4 texels
+		POISSON = 4, //4-16 Poisson disk comparison taps with early out
+		COUNT
+	};
+
+	const char* shadowFilterName(ShadowFilter filter);
+
+	// Compiles filter into shadow.glsl, pass it to ShaderVariants::get
+	inline ShaderDefine shadowFilterDefine(ShadowFilter filter) { return { "SHADOW_FILTER", (int)filter }; }
+
+	// Sampler object for the comparison binding (_ShadowMapCmp) of a depth texture
+	unsigned int createShadowCompareSampler();
+
+	// Binds the depth texture raw to rawUnit and through compareSampler to compareUnit
+	void bindShadowMap(unsigned int shadowMap, unsigned int compareSampler, int rawUnit, int compareUnit);
+
+	// Sets the uniforms declared by shadow.glsl. Shader must be in use
+	void setShadowUniforms(const ew::Shader& shader, int rawUnit, int compareUnit, float filterRadius = 1.5f);
+
+	struct ShadowFilterTiming {
+		ShadowFilter filter;
+		float gpuMs; //Mean GL_TIME_ELAPSED of one drawPass
+	};
+
+	// Renders drawPass once per frame into an offscreen width x height target for every filter
+	// and reports the mean GPU time of each. drawPass must set up its own shader and draw, a
+	// variant built lazily on its first call is compiled during warm-up and not timed
+	std::vector<ShadowFilterTiming> benchmarkShadowFilters(const std::function<void(ShadowFilter)>& drawPass,
+		unsigned int width = 1920, unsigned int height = 1080, int frames = 100);
+}
@@ -0,0 +1,99 @@
+#include "stateCache.h"
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+namespace joey
+{
+	static const int MAX_TEXTURE_UNITS = 32;
+	static const int MAX_UNIFORM_SIZE = 64; //mat4
+
+	struct UniformValue {
+		unsigned char data[MAX_UNIFORM_SIZE];
+		int size = 0;
+	};
+
+	//Matches no real object, so the first bind after invalidating is never skipped
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+	static bool s_enabled = true;
+	static unsigned int s_program = UNKNOWN;
+	static unsigned int s_vertexArray = UNKNOWN;
+	static unsigned int s_textures[MAX_TEXTURE_UNITS];
+	static bool s_texturesKnown = false;
+	//Last value per location, per program. Uniforms are mostly set right after use(), so the
+	//program's table is looked up once and kept until another program's uniforms are set
+	static std::unordered_map<unsigned int, std::vector<UniformValue>> s_uniforms;
+	static unsigned int s_uniformProgram = 0;
+	static std::vector<UniformValue>* s_uniformValues = nullptr;
+
+	bool stateCacheProgram(unsigned int program)
+	{
+		bool redundant = program == s_program;
+		s_program = program;
+		return redundant;
+	}
+
+	bool stateCacheVertexArray(unsigned int vertexArray)
+	{
+		bool redundant = vertexArray == s_vertexArray;
+		s_vertexArray = vertexArray;
+		return redundant;
+	}
+
+	bool stateCacheTexture(int unit, unsigned int texture)
+	{
+		if (unit < 0 || unit >= MAX_TEXTURE_UNITS)
+			return false;
+		if (!s_texturesKnown) {
+			memset(s_textures, 0xFF, sizeof(s_textures));
+			s_texturesKnown = true;
+		}
+		bool redundant = s_textures[unit] == texture;
+		s_textures[unit] = texture;
+		return redundant;
+	}
+
+	bool stateCacheUniform(unsigned int program, int location, const void* value, int size)
+	{
+		if (location < 0 || size > MAX_UNIFORM_SIZE)
+			return false;
+		if (!s_uniformValues || s_uniformProgram != program) {
+			s_uniformProgram = program;
+			s_uniformValues = &s_uniforms[program];
+		}
+		if ((int)s_uniformValues->size() <= location)
+			s_uniformValues->resize(location + 1);
+		UniformValue& last = (*s_uniformValues)[location];
+		bool redundant = last.size == size && memcmp(last.data, value, size) == 0;
+		memcpy(last.data, value, size);
+		last.size = size;
+		return redundant;
+	}
+
+	void stateCacheInvalidate()
+	{
+		s_program = UNKNOWN;
+		s_vertexArray = UNKNOWN;
+		s_texturesKnown = false;
+	}
+
+	void stateCacheForgetProgram(unsigned int program)
+	{
+		if (s_uniformValues && s_uniformProgram == program)
+			s_uniformValues = nullptr;
+		s_uniforms.erase(program);
+		if (s_program == program)
+			s_program = UNKNOWN;
+	}
+
+	void setStateCacheEnabled(bool enabled)
+	{
+		s_enabled = enabled;
+	}
+
+	bool isStateCacheEnabled()
+	{
+		return s_enabled;
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace joey
+{
+	// Shadow copy of the bindings and uniform values set through ew::Shader and the wrappers in
+	// renderStats.h, so calls that would change nothing can be skipped. Each function records the
+	// new state and returns whether the call was redundant.
+	// Only sees calls made through it, invalidate after anything else binds (loaders, ImGui)
+	bool stateCacheProgram(unsigned int program);
+	bool stateCacheVertexArray(unsigned int vertexArray);
+	bool stateCacheTexture(int unit, unsigned int texture);
+	bool stateCacheUniform(unsigned int program, int location, const void* value, int size);
+	// Forgets bindings. Uniform values are kept, they belong to the program objects
+	void stateCacheInvalidate();
+	// Forgets a program's uniform values. GL reuses deleted ids, so call it on every program created or deleted
+	void stateCacheForgetProgram(unsigned int program);
+
+	// Disabled still tracks redundancy for the stats but issues every call, for A/B comparisons
+	void setStateCacheEnabled(bool enabled);
+	bool isStateCacheEnabled();
+}
@@ -0,0 +1,146 @@
+#include "staticBatch.h"
+#include "geometryPool.h"
+#include "streamBuffer.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace joey
+{
+	StaticBatch::StaticBatch(float chunkSize, unsigned int maxChunkVertices)
+		: m_chunkSize(chunkSize), m_maxChunkVertices(maxChunkVertices)
+	{
+	}
+
+	void StaticBatch::add(const ew::MeshData& meshData, const glm::mat4& model, int material)
+	{
+		m_instances.push_back({ &meshData, model, material });
+	}
+
+	void StaticBatch::build(GeometryPool& pool)
+	{
+		clear(pool);
+
+		//Cell of each instance from its world space bounds' center
+		struct Placement {
+			int instance;
+			int cellX;
+			int cellZ;
+		};
+		std::vector<Placement> placements(m_instances.size());
+		for (size_t i = 0; i < m_instances.size(); i++)
+		{
+			const Instance& instance = m_instances[i];
+			glm::vec3 localMin = glm::vec3(0), localMax = glm::vec3(0);
+			if (!instance.meshData->vertices.empty()) {
+				localMin = localMax = instance.meshData->vertices[0].pos;
+				for (const ew::Vertex& v : instance.meshData->vertices)
+				{
+					localMin = glm::min(localMin, v.pos);
+					localMax = glm::max(localMax, v.pos);
+				}
+			}
+			glm::vec3 center = glm::vec3(instance.model * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+			placements[i] = { (int)i, (int)floorf(center.x / m_chunkSize), (int)floorf(center.z / m_chunkSize) };
+		}
+		std::stable_sort(placements.begin(), placements.end(), [this](const Placement& a, const Placement& b) {
+			int materialA = m_instances[a.instance].material, materialB = m_instances[b.instance].material;
+			if (materialA != materialB) return materialA < materialB;
+			if (a.cellX != b.cellX) return a.cellX < b.cellX;
+			return a.cellZ < b.cellZ;
+		});
+
+		//One chunk is merged at a time and uploaded before the next starts
+		ew::MeshData merged;
+		StaticChunk chunk;
+		auto flush = [&]() {
+			if (merged.vertices.empty())
+				return;
+			chunk.vertexCount = (unsigned int)merged.vertices.size();
+			chunk.mesh = pool.add(merged);
+			if (chunk.mesh < 0)
+				printf("StaticBatch: dropped a chunk of %d instances\n", chunk.instanceCount);
+			else
+				m_chunks.push_back(chunk);
+			merged.vertices.clear();
+			merged.indices.clear();
+			chunk = StaticChunk();
+		};
+		for (size_t i = 0; i < placements.size(); i++)
+		{
+			const Placement& placement = placements[i];
+			const Instance& instance = m_instances[placement.instance];
+			const ew::MeshData& meshData = *instance.meshData;
+			bool sameCell = i > 0 && instance.material == m_instances[placements[i - 1].instance].material
+				&& placement.cellX == placements[i - 1].cellX && placement.cellZ == placements[i - 1].cellZ;
+			if (!sameCell || merged.vertices.size() + meshData.vertices.size() > m_maxChunkVertices)
+				flush();
+
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.model)));
+			unsigned int firstVertex = (unsigned int)merged.vertices.size();
+			for (const ew::Vertex& v : meshData.vertices)
+			{
+				ew::Vertex world;
+				world.pos = glm::vec3(instance.model * glm::vec4(v.pos, 1.0f));
+				world.normal = glm::normalize(normalMatrix * v.normal);
+				world.uv = v.uv;
+				if (merged.vertices.empty()) {
+					chunk.boundsMin = chunk.boundsMax = world.pos;
+				}
+				chunk.boundsMin = glm::min(chunk.boundsMin, world.pos);
+				chunk.boundsMax = glm::max(chunk.boundsMax, world.pos);
+				merged.vertices.push_back(world);
+			}
+			//Mirroring transforms flip the winding, swap two corners so culling still sees front faces
+			bool mirrored = glm::determinant(glm::mat3(instance.model)) < 0.0f;
+			for (size_t j = 0; j + 2 < meshData.indices.size(); j += 3)
+			{
+				merged.indices.push_back(firstVertex + meshData.indices[j]);
+				merged.indices.push_back(firstVertex + meshData.indices[j + (mirrored ? 2 : 1)]);
+				merged.indices.push_back(firstVertex + meshData.indices[j + (mirrored ? 1 : 2)]);
+			}
+			chunk.material = instance.material;
+			chunk.instanceCount++;
+			m_instanceCount++;
+		}
+		flush();
+
+		m_instances.clear();
+		m_instances.shrink_to_fit();
+	}
+
+	void StaticBatch::clear(GeometryPool& pool)
+	{
+		for (const StaticChunk& chunk : m_chunks)
+		{
+			pool.remove(chunk.mesh);
+		}
+		m_chunks.clear();
+		m_instanceCount = 0;
+	}
+
+	void StaticBatch::writeDrawData(GPUDrawData* draws)const
+	{
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			draws[i] = { glm::mat4(1.0f), glm::vec4(1), m_chunks[i].material };
+		}
+	}
+
+	void StaticBatch::addDraws(DrawList& drawList, int baseInstance)const
+	{
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			drawList.add(m_chunks[i].mesh, baseInstance + (int)i);
+		}
+	}
+
+	void StaticBatch::cull(const Frustum& frustum, std::vector<int>& visible)const
+	{
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			if (frustum.intersectsAABB(m_chunks[i].boundsMin, m_chunks[i].boundsMax))
+				visible.push_back((int)i);
+		}
+	}
+}
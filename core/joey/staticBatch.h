@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include "frustum.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace joey
+{
+	class GeometryPool;
+	class DrawList;
+	struct GPUDrawData;
+
+	// Instances of one material in one grid cell, merged into a single world space pool mesh
+	struct StaticChunk {
+		int mesh = -1;
+		int material = 0;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		int instanceCount = 0;
+		unsigned int vertexCount = 0;
+	};
+
+	// Bakes instances of meshes that never move into a few merged meshes at scene build time, so static
+	// scenery costs one draw per chunk however many instances it has. Instances are grouped by material
+	// and by the XZ cell of chunkSize their bounds' center falls in. A cell past maxChunkVertices is
+	// split, which keeps chunks small enough to cull and the build's temporary mesh bounded.
+	// Chunks are already in world space and draw with an identity model matrix (see writeDrawData)
+	class StaticBatch {
+	public:
+		StaticBatch(float chunkSize, unsigned int maxChunkVertices = 16 * 1024);
+
+		// meshData is only read by build(), it has to outlive that
+		void add(const ew::MeshData& meshData, const glm::mat4& model, int material);
+		// Transforms and merges the added instances into the pool, then forgets them.
+		// Chunks of an earlier build are removed from the pool first
+		void build(GeometryPool& pool);
+		void clear(GeometryPool& pool);
+
+		// Chunk i's draw data goes to draws[i]
+		void writeDrawData(GPUDrawData* draws)const;
+		// Chunk i draws with baseInstance + i
+		void addDraws(DrawList& drawList, int baseInstance)const;
+		// Appends the indices of the chunks whose bounds touch the frustum
+		void cull(const Frustum& frustum, std::vector<int>& visible)const;
+
+		inline const std::vector<StaticChunk>& getChunks()const { return m_chunks; }
+		inline int getChunkCount()const { return (int)m_chunks.size(); }
+		// Instances baked into the current chunks
+		inline int getInstanceCount()const { return m_instanceCount; }
+	private:
+		struct Instance {
+			const ew::MeshData* meshData;
+			glm::mat4 model;
+			int material;
+		};
+		float m_chunkSize;
+		unsigned int m_maxChunkVertices;
+		std::vector<Instance> m_instances;
+		std::vector<StaticChunk> m_chunks;
+		int m_instanceCount = 0;
+	};
+}
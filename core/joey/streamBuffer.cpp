@@ -0,0 +1,86 @@
+#include "streamBuffer.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+namespace joey
+{
+	static const int MAX_REGIONS = 8;
+
+	StreamBuffer::StreamBuffer(size_t bytesPerFrame, int framesInFlight)
+	{
+		int ssboAlignment = 0, uboAlignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+		m_alignment = (size_t)std::max(std::max(ssboAlignment, uboAlignment), 16);
+
+		m_regionCount = std::min(std::max(framesInFlight, 1), MAX_REGIONS);
+		//Regions start aligned too
+		m_regionBytes = (bytesPerFrame + m_alignment - 1) / m_alignment * m_alignment;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &m_buffer);
+		glNamedBufferStorage(m_buffer, m_regionBytes * m_regionCount, NULL, flags);
+		m_mapped = (unsigned char*)glMapNamedBufferRange(m_buffer, 0, m_regionBytes * m_regionCount, flags);
+		if (!m_mapped)
+			printf("StreamBuffer failed to map %zu bytes\n", m_regionBytes * m_regionCount);
+	}
+
+	StreamBuffer::~StreamBuffer()
+	{
+		for (void* fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync((GLsync)fence);
+		}
+		glUnmapNamedBuffer(m_buffer);
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	void StreamBuffer::beginFrame()
+	{
+		m_head = 0;
+		GLsync fence = (GLsync)m_fences[m_region];
+		if (!fence)
+			return;
+		//Usually signaled long ago, only block when the GPU is framesInFlight behind
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			auto start = std::chrono::steady_clock::now();
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+			m_stallCount++;
+			m_lastStallMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fence);
+		m_fences[m_region] = nullptr;
+	}
+
+	void StreamBuffer::endFrame()
+	{
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_lastBytesUsed = m_head;
+		m_region = (m_region + 1) % m_regionCount;
+	}
+
+	void* StreamBuffer::allocate(size_t bytes, size_t* offset)
+	{
+		size_t start = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+		if (!m_mapped || start + bytes > m_regionBytes) {
+			if (!m_reportedOverflow)
+				printf("StreamBuffer out of space, %zu of %zu bytes per frame used\n", m_head, m_regionBytes);
+			m_reportedOverflow = true;
+			return nullptr;
+		}
+		m_head = start + bytes;
+		*offset = m_region * m_regionBytes + start;
+		return m_mapped + *offset;
+	}
+
+	void StreamBuffer::bindRange(unsigned int target, int binding, size_t offset, size_t bytes)
+	{
+		glBindBufferRange(target, binding, m_buffer, offset, bytes);
+	}
+}
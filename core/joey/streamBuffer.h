@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+
+namespace joey
+{
+	//std430 layout of DrawData in drawData.glsl
+	struct GPUDrawData {
+		glm::mat4 model;
+		glm::vec4 color;
+		int materialIndex;
+		int padding[3];
+	};
+
+	// Persistently mapped, coherent buffer for data written every frame.
+	// Split into one region per frame in flight, each guarded by a fence, so the CPU writes
+	// straight into memory the GPU is not reading. beginFrame() waits if the GPU is still on
+	// the region it hands out next, and counts that as a stall
+	class StreamBuffer {
+	public:
+		static const int DRAW_DATA_BINDING = 5; //std430 DrawDataBuffer in drawData.glsl
+
+		StreamBuffer(size_t bytesPerFrame, int framesInFlight = 3);
+		~StreamBuffer();
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+		void beginFrame();
+		// Fences everything allocated since beginFrame()
+		void endFrame();
+
+		// Mapped memory for bytes, write only. offset is its position in getBuffer(), for binding.
+		// Aligned for SSBO/UBO ranges. nullptr once the frame's region is full
+		void* allocate(size_t bytes, size_t* offset);
+		template<typename T>
+		inline T* allocate(int count, size_t* offset) { return (T*)allocate(sizeof(T) * count, offset); }
+		// glBindBufferRange on this buffer
+		void bindRange(unsigned int target, int binding, size_t offset, size_t bytes);
+
+		inline unsigned int getBuffer()const { return m_buffer; }
+		inline size_t getBytesPerFrame()const { return m_regionBytes; }
+		// Bytes allocated in the last finished frame
+		inline size_t getLastBytesUsed()const { return m_lastBytesUsed; }
+		// Frames that had to wait on the GPU, in total and how long the last one waited
+		inline int getStallCount()const { return m_stallCount; }
+		inline float getLastStallMs()const { return m_lastStallMs; }
+	private:
+		unsigned int m_buffer = 0;
+		unsigned char* m_mapped = nullptr;
+		size_t m_regionBytes;
+		size_t m_alignment = 256;
+		int m_regionCount;
+		int m_region = 0;
+		size_t m_head = 0; //Bytes used in the current region
+		size_t m_lastBytesUsed = 0;
+		void* m_fences[8] = {};
+		int m_stallCount = 0;
+		float m_lastStallMs = 0.0f;
+		bool m_reportedOverflow = false;
+	};
+}
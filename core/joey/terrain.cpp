@@ -0,0 +1,297 @@
+#include "terrain.h"
+#include "jobSystem.h"
+#include "streamBuffer.h"
+#include "renderStats.h"
+#include "cpuProfiler.h"
+#include "../ew/procGen.h"
+#include "../ew/external/glad.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace joey
+{
+	Terrain::Terrain(const TerrainSettings& settings, const float* heights, int heightmapSize)
+		: m_settings(settings), m_heightmapSize(heightmapSize)
+	{
+		//4^10 finest nodes is already 8 MB of height ranges
+		m_settings.maxDepth = std::min(std::max(m_settings.maxDepth, 0), 10);
+		m_settings.patchResolution = std::max(m_settings.patchResolution & ~1, 2);
+
+		//Finest nodes take the range of every sample they cover, edges included, coarser ones merge their children
+		m_heightRanges.resize(m_settings.maxDepth + 1);
+		int finest = 1 << m_settings.maxDepth;
+		int last = heightmapSize - 1;
+		std::vector<glm::vec2>& leaves = m_heightRanges[m_settings.maxDepth];
+		leaves.resize((size_t)finest * finest);
+		for (int z = 0; z < finest; z++)
+		{
+			int z0 = z * last / finest, z1 = ((z + 1) * last + finest - 1) / finest;
+			for (int x = 0; x < finest; x++)
+			{
+				int x0 = x * last / finest, x1 = ((x + 1) * last + finest - 1) / finest;
+				glm::vec2 range = glm::vec2(heights[z0 * heightmapSize + x0]);
+				for (int sz = z0; sz <= z1; sz++)
+				{
+					for (int sx = x0; sx <= x1; sx++)
+					{
+						float height = heights[sz * heightmapSize + sx];
+						range = glm::vec2(std::min(range.x, height), std::max(range.y, height));
+					}
+				}
+				leaves[(z << m_settings.maxDepth) + x] = range;
+			}
+		}
+		for (int depth = m_settings.maxDepth - 1; depth >= 0; depth--)
+		{
+			int count = 1 << depth;
+			const std::vector<glm::vec2>& children = m_heightRanges[depth + 1];
+			m_heightRanges[depth].resize((size_t)count * count);
+			for (int z = 0; z < count; z++)
+			{
+				for (int x = 0; x < count; x++)
+				{
+					glm::vec2 range = children[((z * 2) << (depth + 1)) + x * 2];
+					for (int i = 1; i < 4; i++)
+					{
+						glm::vec2 child = children[((z * 2 + (i >> 1)) << (depth + 1)) + x * 2 + (i & 1)];
+						range = glm::vec2(std::min(range.x, child.x), std::max(range.y, child.y));
+					}
+					m_heightRanges[depth][(z << depth) + x] = range;
+				}
+			}
+		}
+
+		//Geometric error per level: the heightmap against the bilinear surface through the level's grid vertices,
+		//sampled the way terrain.glsl samples them. Grids at least as fine as the heightmap have none
+		m_levelErrors.assign(m_settings.maxDepth + 1, 0.0f);
+		for (int depth = 0; depth <= m_settings.maxDepth; depth++)
+		{
+			int cells = m_settings.patchResolution << depth;
+			float step = (float)last / cells;
+			if (step <= 1.0f)
+				break;
+			auto sample = [&](float sx, float sz) {
+				int x0 = std::min((int)sx, last - 1), z0 = std::min((int)sz, last - 1);
+				float fx = sx - x0, fz = sz - z0;
+				const float* row = heights + (size_t)z0 * heightmapSize + x0;
+				return glm::mix(glm::mix(row[0], row[1], fx), glm::mix(row[heightmapSize], row[heightmapSize + 1], fx), fz);
+			};
+			std::vector<float> grid((size_t)(cells + 1) * (cells + 1));
+			for (int z = 0; z <= cells; z++)
+			{
+				for (int x = 0; x <= cells; x++)
+				{
+					grid[(size_t)z * (cells + 1) + x] = sample(x * step, z * step);
+				}
+			}
+			float error = 0.0f;
+			for (int sz = 0; sz < heightmapSize; sz++)
+			{
+				int cz = std::min((int)(sz / step), cells - 1);
+				float fz = sz / step - cz;
+				const float* row = grid.data() + (size_t)cz * (cells + 1);
+				for (int sx = 0; sx < heightmapSize; sx++)
+				{
+					int cx = std::min((int)(sx / step), cells - 1);
+					float fx = sx / step - cx;
+					float coarse = glm::mix(glm::mix(row[cx], row[cx + 1], fx), glm::mix(row[cx + cells + 1], row[cx + cells + 2], fx), fz);
+					error = std::max(error, fabsf(heights[(size_t)sz * heightmapSize + sx] - coarse));
+				}
+			}
+			m_levelErrors[depth] = error * m_settings.heightScale;
+		}
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_heightmap);
+		glTextureStorage2D(m_heightmap, 1, GL_R32F, heightmapSize, heightmapSize);
+		glTextureSubImage2D(m_heightmap, 0, 0, 0, heightmapSize, heightmapSize, GL_RED, GL_FLOAT, heights);
+		glTextureParameteri(m_heightmap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_heightmap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_heightmap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_heightmap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		//Every patch draws this grid, the vertex shader only needs where each vertex sits in it
+		ew::PositionMeshData grid = ew::createPositionStream(ew::createPlane(1.0f, 1.0f, m_settings.patchResolution));
+		m_indexCount = (int)grid.indices.size();
+		glCreateBuffers(1, &m_vbo);
+		glNamedBufferStorage(m_vbo, sizeof(glm::vec3) * grid.positions.size(), grid.positions.data(), 0);
+		glCreateBuffers(1, &m_ebo);
+		glNamedBufferStorage(m_ebo, sizeof(unsigned int) * grid.indices.size(), grid.indices.data(), 0);
+		glCreateVertexArrays(1, &m_vao);
+		glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(m_vao, 0, 0);
+		glEnableVertexArrayAttrib(m_vao, 0);
+		glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(glm::vec3));
+		glVertexArrayElementBuffer(m_vao, m_ebo);
+	}
+
+	Terrain::~Terrain()
+	{
+		glDeleteTextures(1, &m_heightmap);
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+	}
+
+	void Terrain::select(const ew::Camera& camera, float viewportHeight)
+	{
+		JOEY_CPU_ZONE("Terrain::select");
+		m_eye = camera.position;
+		m_frustum = Frustum::fromMatrix(camera.projectionMatrix() * camera.viewMatrix());
+		//Pixels covered by one world unit at distance 1
+		float projection = viewportHeight / (2.0f * tanf(glm::radians(camera.fov) * 0.5f));
+
+		//Over budget, the whole tree is selected again with twice the error until it fits.
+		//Coarsening every level together keeps neighbours within one level of each other
+		float errorScale = 1.0f;
+		m_ranges.resize(m_settings.maxDepth + 1);
+		for (int attempt = 0; attempt < 8; attempt++)
+		{
+			m_stats = TerrainStats();
+			m_stats.pixelError = m_settings.pixelError * errorScale;
+			m_patches.clear();
+			//Projected error is error * projection / distance, a level splits closer than where that reaches pixelError.
+			//Each range at least doubles the next finer one and is never under 2.5 nodes, so a split node's
+			//neighbours are at most one level coarser. A level without error never splits, nor do finer ones
+			float finer = 0.0f;
+			for (int depth = m_settings.maxDepth; depth >= 0; depth--)
+			{
+				float nodeSize = m_settings.size / (float)(1 << depth);
+				float range = std::max(m_levelErrors[depth] * projection / m_stats.pixelError, finer * 2.0f);
+				m_ranges[depth] = range > 0.0f ? std::max(range, nodeSize * 2.5f) : 0.0f;
+				finer = m_ranges[depth];
+			}
+			if (selectNode(0, 0, 0))
+				break;
+			errorScale *= 2.0f;
+		}
+		m_stats.patches = (int)m_patches.size();
+		m_stats.triangles = (unsigned int)m_patches.size() * m_settings.patchResolution * m_settings.patchResolution * 2;
+	}
+
+	bool Terrain::selectNode(int depth, int x, int z)
+	{
+		m_stats.nodesVisited++;
+		float nodeSize = m_settings.size / (float)(1 << depth);
+		glm::vec2 heights = m_heightRanges[depth][(z << depth) + x] * m_settings.heightScale + m_settings.center.y;
+		glm::vec3 boundsMin = glm::vec3(m_settings.center.x - m_settings.size * 0.5f + x * nodeSize, heights.x,
+			m_settings.center.z - m_settings.size * 0.5f + z * nodeSize);
+		glm::vec3 boundsMax = glm::vec3(boundsMin.x + nodeSize, heights.y, boundsMin.z + nodeSize);
+		if (!m_frustum.intersectsAABB(boundsMin, boundsMax)) {
+			m_stats.nodesCulled++;
+			return true;
+		}
+
+		float distance = glm::length(glm::clamp(m_eye, boundsMin, boundsMax) - m_eye);
+		if (depth < m_settings.maxDepth && distance < m_ranges[depth]) {
+			for (int i = 0; i < 4; i++)
+			{
+				if (!selectNode(depth + 1, x * 2 + (i & 1), z * 2 + (i >> 1)))
+					return false;
+			}
+			return true;
+		}
+
+		if ((int)m_patches.size() >= m_settings.maxPatches)
+			return false;
+		GPUPatch patch;
+		patch.placement = glm::vec4(boundsMin.x, boundsMin.z, nodeSize, 0.0f);
+		//Fully morphed by the distance the parent level stops splitting, the root has no parent to morph into
+		if (depth > 0) {
+			float end = m_ranges[depth - 1];
+			patch.morph = glm::vec4(end - (end - m_ranges[depth]) * m_settings.morphRegion, end, 0.0f, 0.0f);
+		}
+		else
+			patch.morph = glm::vec4(1e30f, 2e30f, 0.0f, 0.0f);
+		m_patches.push_back(patch);
+		return true;
+	}
+
+	void Terrain::upload(StreamBuffer& stream)
+	{
+		m_stream = &stream;
+		m_uploadedPatches = 0;
+		if (m_patches.empty())
+			return;
+		GPUPatch* patches = stream.allocate<GPUPatch>((int)m_patches.size(), &m_patchOffset);
+		if (!patches)
+			return;
+		memcpy(patches, m_patches.data(), sizeof(GPUPatch) * m_patches.size());
+		m_uploadedPatches = (int)m_patches.size();
+	}
+
+	void Terrain::draw(const ew::Shader& shader, int textureUnit)const
+	{
+		if (m_uploadedPatches == 0)
+			return;
+		shader.setInt("_TerrainHeightmap", textureUnit);
+		shader.setVec3("_TerrainCenter", m_settings.center);
+		shader.setFloat("_TerrainSize", m_settings.size);
+		shader.setFloat("_TerrainHeightScale", m_settings.heightScale);
+		shader.setInt("_TerrainResolution", m_settings.patchResolution);
+		shader.setVec3("_TerrainEye", m_eye);
+		bindTextureUnit(textureUnit, m_heightmap);
+		m_stream->bindRange(GL_SHADER_STORAGE_BUFFER, PATCH_BINDING, m_patchOffset, sizeof(GPUPatch) * m_uploadedPatches);
+
+		bindVertexArray(m_vao);
+		renderStatsDraw(GL_TRIANGLES, m_indexCount * m_uploadedPatches);
+		glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, NULL, m_uploadedPatches);
+	}
+
+	//Lattice value in [0, 1], from an integer hash
+	static float latticeValue(int x, int z, unsigned int seed)
+	{
+		unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u + seed * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		h ^= h >> 16;
+		return (h & 0xFFFFFF) / (float)0xFFFFFF;
+	}
+
+	static float valueNoise(float x, float z, unsigned int seed)
+	{
+		int ix = (int)floorf(x), iz = (int)floorf(z);
+		float fx = x - ix, fz = z - iz;
+		//Smoothstep, so the slopes don't crease along lattice lines
+		fx = fx * fx * (3.0f - 2.0f * fx);
+		fz = fz * fz * (3.0f - 2.0f * fz);
+		float a = latticeValue(ix, iz, seed), b = latticeValue(ix + 1, iz, seed);
+		float c = latticeValue(ix, iz + 1, seed), d = latticeValue(ix + 1, iz + 1, seed);
+		return glm::mix(glm::mix(a, b, fx), glm::mix(c, d, fx), fz);
+	}
+
+	std::vector<float> Terrain::generateHeightmap(int size, unsigned int seed, JobSystem* jobs)
+	{
+		const int OCTAVES = 8;
+		std::vector<float> heights((size_t)size * size);
+		auto rows = [&](int begin, int end) {
+			for (int z = begin; z < end; z++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					//Four hills across at the lowest octave
+					float frequency = 4.0f / size, amplitude = 1.0f, height = 0.0f;
+					for (int octave = 0; octave < OCTAVES; octave++)
+					{
+						height += valueNoise(x * frequency, z * frequency, seed + octave) * amplitude;
+						frequency *= 2.0f;
+						amplitude *= 0.5f;
+					}
+					heights[(size_t)z * size + x] = height;
+				}
+			}
+		};
+		if (jobs)
+			jobs->parallelFor(size, 16, rows);
+		else
+			rows(0, size);
+
+		//Stretch to the full [0, 1] range
+		auto range = std::minmax_element(heights.begin(), heights.end());
+		float low = *range.first, scale = *range.second > low ? 1.0f / (*range.second - low) : 0.0f;
+		for (float& height : heights)
+		{
+			height = (height - low) * scale;
+		}
+		return heights;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../ew/camera.h"
+#include "../ew/shader.h"
+#include "frustum.h"
+#include <glm/glm.hpp>
+#include <stddef.h>
+#include <vector>
+
+namespace joey
+{
+	class JobSystem;
+	class StreamBuffer;
+
+	struct TerrainSettings {
+		glm::vec3 center = glm::vec3(0); //Middle of the terrain at height 0
+		float size = 1024.0f; //World units along x and z
+		float heightScale = 64.0f; //Height of a heightmap value of 1
+		int patchResolution = 32; //Quads along each side of a patch
+		int maxDepth = 6; //The finest patches are size / 2^maxDepth across
+		float pixelError = 2.0f; //Largest projected height error before a patch splits
+		float morphRegion = 0.3f; //Part of each level's distance range spent morphing into its parent
+		int maxPatches = 512; //Triangle budget, patchResolution^2 * 2 triangles each
+	};
+
+	struct TerrainStats {
+		int patches = 0;
+		int nodesVisited = 0;
+		int nodesCulled = 0;
+		unsigned int triangles = 0;
+		float pixelError = 0.0f; //Error actually used, above the setting when the budget forced coarser levels
+	};
+
+	// Heightmapped terrain as a quadtree of patches that all draw the same createPlane grid.
+	// select() walks the tree from the camera: nodes outside the frustum are dropped and the rest split
+	// while their geometric error, how far the heightmap strays from the level's coarser grid, would cover
+	// more than pixelError pixels on screen. The error is the worst of each level, so every level splits at
+	// one distance, which the morphing and the one-level rule between neighbours need. terrain.glsl places each patch,
+	// displaces it by the heightmap and morphs vertices near the next level's range onto the parent grid,
+	// so neighbours of different levels meet without cracks or popping. One instanced draw per pass
+	class Terrain {
+	public:
+		static const int PATCH_BINDING = 6; //std430 TerrainPatchBuffer in terrain.glsl
+
+		// heights are heightmapSize^2 values in [0, 1], row z * heightmapSize + x, spanning the whole terrain
+		Terrain(const TerrainSettings& settings, const float* heights, int heightmapSize);
+		~Terrain();
+		Terrain(const Terrain&) = delete;
+		Terrain& operator=(const Terrain&) = delete;
+
+		// Picks this frame's patches for a perspective camera and a viewport viewportHeight pixels tall
+		void select(const ew::Camera& camera, float viewportHeight);
+		// Writes the selected patches for this frame's draws, after select()
+		void upload(StreamBuffer& stream);
+		// Sets terrain.glsl's uniforms, binds the heightmap to textureUnit and draws every uploaded patch
+		void draw(const ew::Shader& shader, int textureUnit)const;
+
+		inline const TerrainSettings& getSettings()const { return m_settings; }
+		inline void setPixelError(float pixelError) { m_settings.pixelError = pixelError; }
+		inline const TerrainStats& getStats()const { return m_stats; }
+		inline unsigned int getHeightmap()const { return m_heightmap; }
+
+		// Fractal value noise in [0, 1], size^2 values laid out like the constructor's heights
+		static std::vector<float> generateHeightmap(int size, unsigned int seed, JobSystem* jobs = nullptr);
+	private:
+		//std430 TerrainPatch in terrain.glsl
+		struct GPUPatch {
+			glm::vec4 placement; //xy = min corner in world xz, z = size
+			glm::vec4 morph; //x = distance morphing starts, y = distance it's complete
+		};
+
+		//False once the patch budget is full
+		bool selectNode(int depth, int x, int z);
+
+		TerrainSettings m_settings;
+		//Height range of every node, level d holds 4^d of them, (z << d) + x
+		std::vector<std::vector<glm::vec2>> m_heightRanges;
+		std::vector<float> m_levelErrors; //Largest height error of drawing each level's grid, in world units
+		std::vector<float> m_ranges; //Distance under which a level splits, per level
+		std::vector<GPUPatch> m_patches;
+		glm::vec3 m_eye = glm::vec3(0);
+		Frustum m_frustum;
+		TerrainStats m_stats;
+		int m_heightmapSize;
+		unsigned int m_heightmap = 0;
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		int m_indexCount = 0;
+		size_t m_patchOffset = 0;
+		int m_uploadedPatches = 0;
+		StreamBuffer* m_stream = nullptr;
+	};
+}